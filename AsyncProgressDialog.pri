@@ -0,0 +1,74 @@
+# The library sources, shared by the demo application and the benchmarks
+
+QT       += core gui concurrent charts
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+CONFIG += c++17
+
+INCLUDEPATH += $$PWD/include/apd
+
+SOURCES += \
+    $$PWD/src/AsyncProgressDialog.cpp \
+    $$PWD/src/ProgressBar.cpp \
+    $$PWD/src/ProgressEstimate.cpp \
+    $$PWD/src/ProgressLabel.cpp \
+    $$PWD/src/ProgressLogView.cpp \
+    $$PWD/src/ProgressMetrics.cpp \
+    $$PWD/src/ProgressOutput.cpp \
+    $$PWD/src/ProgressVelocityPlot.cpp \
+    $$PWD/src/ProgressWidget.cpp \
+    $$PWD/src/ProgressWidgetContainer.cpp \
+    $$PWD/src/ProgressWidgetFactory.cpp \
+    $$PWD/src/TaskThread.cpp \
+    $$PWD/src/TaskPool.cpp \
+    $$PWD/src/TaskFuture.cpp \
+    $$PWD/src/Pipeline.cpp \
+    $$PWD/src/CoroutineReactor.cpp \
+    $$PWD/src/CoroutineTaskThread.cpp \
+    $$PWD/src/ThreadScheduling.cpp \
+    $$PWD/src/TaskListModel.cpp \
+    $$PWD/src/TaskItemDelegate.cpp \
+    $$PWD/src/DurationFormatter.cpp \
+    $$PWD/src/RemainingTimeEstimator.cpp \
+    $$PWD/src/RenderClock.cpp \
+    $$PWD/src/TraceRecorder.cpp \
+    $$PWD/src/OutputLog.cpp \
+    $$PWD/src/MappedLog.cpp \
+    $$PWD/src/LogViewport.cpp
+
+HEADERS += \
+    $$PWD/include/apd/AsyncProgressDialog.h \
+    $$PWD/include/apd/FunctionThread.h \
+    $$PWD/include/apd/ParallelFor.h \
+    $$PWD/include/apd/ProgressBar.h \
+    $$PWD/include/apd/ProgressEstimate.h \
+    $$PWD/include/apd/ProgressLabel.h \
+    $$PWD/include/apd/ProgressLogView.h \
+    $$PWD/include/apd/ProgressMetrics.h \
+    $$PWD/include/apd/ProgressOutput.h \
+    $$PWD/include/apd/ProgressVelocityPlot.h \
+    $$PWD/include/apd/ProgressWidget.h \
+    $$PWD/include/apd/ProgressWidgetContainer.h \
+    $$PWD/include/apd/ProgressWidgetFactory.h \
+    $$PWD/include/apd/RemainingTimeEstimator.h \
+    $$PWD/include/apd/TaskThread.h \
+    $$PWD/include/apd/TaskPool.h \
+    $$PWD/include/apd/TaskFuture.h \
+    $$PWD/include/apd/Pipeline.h \
+    $$PWD/include/apd/SpscQueue.h \
+    $$PWD/include/apd/Coroutine.h \
+    $$PWD/include/apd/CoroutineReactor.h \
+    $$PWD/include/apd/CoroutineTaskThread.h \
+    $$PWD/include/apd/TaskState.h \
+    $$PWD/include/apd/TimeStamp.h \
+    $$PWD/include/apd/TraceRecorder.h \
+    $$PWD/src/LatestValue.h \
+    $$PWD/src/ThreadScheduling.h \
+    $$PWD/src/TaskListModel.h \
+    $$PWD/src/TaskItemDelegate.h \
+    $$PWD/src/DurationFormatter.h \
+    $$PWD/src/RenderClock.h \
+    $$PWD/src/OutputLog.h \
+    $$PWD/src/MappedLog.h \
+    $$PWD/src/LogViewport.h
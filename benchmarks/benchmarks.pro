@@ -0,0 +1,9 @@
+# Headless benchmarks of the library, run them with the offscreen platform:
+#   QT_QPA_PLATFORM=offscreen ./signalpath --output results.json
+
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    estimators \
+    signalpath \
+    widgetpaint
@@ -0,0 +1,172 @@
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    std::atomic<qint64> s_allocationCount { 0 };
+    std::atomic<qint64> s_liveBytes { 0 };
+}
+
+/*!
+    Returns the number of allocations made so far. A realloc() counts as an allocation.
+*/
+qint64 AllocationCounter::allocationCount()
+{
+    return s_allocationCount.load(std::memory_order_relaxed);
+}
+
+/*!
+    Returns the number of bytes allocated and not freed yet. With glibc, the blocks count
+    by their usable size, which may be a little larger than the requested one.
+*/
+qint64 AllocationCounter::liveBytes()
+{
+    return s_liveBytes.load(std::memory_order_relaxed);
+}
+
+#ifdef __GLIBC__
+
+#include <malloc.h>
+
+// the allocator of glibc behind its public functions, which are replaced below
+extern "C"
+{
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t count, size_t size);
+    void* __libc_realloc(void* pointer, size_t size);
+    void* __libc_memalign(size_t alignment, size_t size);
+    void __libc_free(void* pointer);
+}
+
+namespace
+{
+    // malloc_usable_size() doesn't allocate, so it's safe to call from within the allocator
+    void* counted(void* pointer) noexcept
+    {
+        if (pointer)
+        {
+            s_allocationCount.fetch_add(1, std::memory_order_relaxed);
+            s_liveBytes.fetch_add(static_cast<qint64>(malloc_usable_size(pointer)), std::memory_order_relaxed);
+        }
+        return pointer;
+    }
+
+    void uncount(void* pointer) noexcept
+    {
+        if (pointer)
+            s_liveBytes.fetch_sub(static_cast<qint64>(malloc_usable_size(pointer)), std::memory_order_relaxed);
+    }
+}
+
+// operator new of libstdc++ calls malloc(), so it needn't be replaced
+extern "C"
+{
+
+void* malloc(size_t size)
+{
+    return counted(__libc_malloc(size));
+}
+
+void* calloc(size_t count, size_t size)
+{
+    return counted(__libc_calloc(count, size));
+}
+
+void* realloc(void* pointer, size_t size)
+{
+    // the block is freed, unless the reallocation fails
+    uncount(pointer);
+    auto result = __libc_realloc(pointer, size);
+    if (result)
+        return counted(result);
+    if (pointer && size > 0)
+        s_liveBytes.fetch_add(static_cast<qint64>(malloc_usable_size(pointer)), std::memory_order_relaxed);
+    return nullptr;
+}
+
+void* memalign(size_t alignment, size_t size)
+{
+    return counted(__libc_memalign(alignment, size));
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+    return counted(__libc_memalign(alignment, size));
+}
+
+int posix_memalign(void** pointer, size_t alignment, size_t size)
+{
+    if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0)
+        return EINVAL;
+
+    auto result = counted(__libc_memalign(alignment, size));
+    if (!result)
+        return ENOMEM;
+
+    *pointer = result;
+    return 0;
+}
+
+void free(void* pointer)
+{
+    uncount(pointer);
+    __libc_free(pointer);
+}
+
+}
+
+#else
+
+namespace
+{
+    // the size is kept in front of each block, the header keeps the alignment of malloc()
+    constexpr size_t s_headerSize = 16;
+
+    void* allocate(size_t size) noexcept
+    {
+        auto block = static_cast<char*>(std::malloc(size + s_headerSize));
+        if (!block)
+            return nullptr;
+
+        *reinterpret_cast<size_t*>(block) = size;
+        s_allocationCount.fetch_add(1, std::memory_order_relaxed);
+        s_liveBytes.fetch_add(static_cast<qint64>(size), std::memory_order_relaxed);
+        return block + s_headerSize;
+    }
+
+    void deallocate(void* pointer) noexcept
+    {
+        if (!pointer)
+            return;
+
+        auto block = static_cast<char*>(pointer) - s_headerSize;
+        s_liveBytes.fetch_sub(static_cast<qint64>(*reinterpret_cast<size_t*>(block)), std::memory_order_relaxed);
+        std::free(block);
+    }
+
+    void* allocateOrThrow(size_t size)
+    {
+        auto pointer = allocate(size);
+        if (!pointer)
+            throw std::bad_alloc();
+        return pointer;
+    }
+}
+
+void* operator new(size_t size) { return allocateOrThrow(size); }
+void* operator new[](size_t size) { return allocateOrThrow(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+
+void operator delete(void* pointer) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer) noexcept { deallocate(pointer); }
+void operator delete(void* pointer, size_t) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { deallocate(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { deallocate(pointer); }
+
+#endif
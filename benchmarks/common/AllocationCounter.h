@@ -0,0 +1,13 @@
+#pragma once
+
+#include <QtGlobal>
+
+// Counts the heap allocations of the whole program. With glibc, linking AllocationCounter.cpp
+// replaces malloc(), calloc(), realloc(), the aligned allocations and free(), so the blocks
+// of Qt containers and image pixels are counted as well as those of operator new. Elsewhere,
+// only the global operators new and delete are replaced and the counts cover them only.
+namespace AllocationCounter
+{
+    qint64 allocationCount();
+    qint64 liveBytes();
+}
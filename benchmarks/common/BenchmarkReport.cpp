@@ -0,0 +1,92 @@
+#include "BenchmarkReport.h"
+
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSysInfo>
+#include <QTextStream>
+#include <QThread>
+
+#include <algorithm>
+#include <cmath>
+
+/*!
+    \class BenchmarkReport
+    \brief Collects benchmark results and writes them as JSON, so results of releases can be compared.
+
+    Each result is a named value with a unit and the number of concurrent tasks it was
+    measured with. The results are also printed in a readable form to the standard error,
+    while the JSON goes to the file given by the \c --output argument or to the standard output.
+*/
+
+/*!
+    Constructs a report of the benchmark \a suite.
+*/
+BenchmarkReport::BenchmarkReport(const QString& suite)
+    : m_suite(suite)
+{
+}
+
+/*!
+    Adds a result called \a name measured with \a taskCount concurrent tasks,
+    with the \a value in \a unit.
+*/
+void BenchmarkReport::add(const QString& name, int taskCount, double value, const QString& unit)
+{
+    m_results.append(QJsonObject{ { "name", name }, { "tasks", taskCount }, { "value", value }, { "unit", unit } });
+
+    QTextStream(stderr) << QString("%1 [%2 tasks]: %3 %4\n").arg(name, -40).arg(taskCount, 4).arg(value, 0, 'g', 4).arg(unit);
+}
+
+/*!
+    Writes the report to the file given by the \c --output option of \a arguments,
+    or to the standard output. Returns false if the file can't be written.
+*/
+bool BenchmarkReport::write(const QStringList& arguments) const
+{
+    QJsonObject report {
+        { "suite", m_suite },
+        { "qtVersion", QString(qVersion()) },
+        { "cpu", QSysInfo::currentCpuArchitecture() },
+        { "os", QSysInfo::prettyProductName() },
+        { "idealThreadCount", QThread::idealThreadCount() },
+        { "results", m_results },
+    };
+    auto json = QJsonDocument(report).toJson();
+
+    auto index = arguments.indexOf("--output");
+    QFile file;
+    if (index >= 0 && index + 1 < arguments.size())
+    {
+        file.setFileName(arguments[index + 1]);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            return false;
+    }
+    else if (!file.open(stdout, QIODevice::WriteOnly))
+        return false;
+
+    return file.write(json) == json.size();
+}
+
+/*!
+    Selects the offscreen platform plugin, unless a platform is set explicitly.
+    Must be called before QApplication is constructed.
+*/
+void BenchmarkReport::useOffscreenPlatform()
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+}
+
+/*!
+    Returns the value below which the \a fraction of \a samples lies, e.g. 0.99 for p99.
+*/
+double BenchmarkReport::percentile(std::vector<double> samples, double fraction)
+{
+    if (samples.empty())
+        return 0;
+
+    auto index = std::min(samples.size() - 1, static_cast<size_t>(std::ceil(fraction * samples.size())) - (fraction > 0 ? 1 : 0));
+    std::nth_element(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(index), samples.end());
+    return samples[index];
+}
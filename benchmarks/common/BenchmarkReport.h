@@ -0,0 +1,23 @@
+#pragma once
+
+#include <QJsonArray>
+#include <QString>
+#include <QStringList>
+
+#include <vector>
+
+class BenchmarkReport
+{
+public:
+    explicit BenchmarkReport(const QString& suite);
+
+    void add(const QString& name, int taskCount, double value, const QString& unit);
+    bool write(const QStringList& arguments) const;
+
+    static void useOffscreenPlatform();
+    static double percentile(std::vector<double> samples, double fraction);
+
+private:
+    QString m_suite;
+    QJsonArray m_results;
+};
@@ -0,0 +1,14 @@
+# Shared by all benchmarks: the library and the result reporting
+
+include($$PWD/../../AsyncProgressDialog.pri)
+
+CONFIG += console
+CONFIG -= app_bundle
+
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/BenchmarkReport.cpp
+
+HEADERS += \
+    $$PWD/BenchmarkReport.h
@@ -0,0 +1,7 @@
+TARGET = estimators
+TEMPLATE = app
+
+include(../common/common.pri)
+
+SOURCES += \
+    main.cpp
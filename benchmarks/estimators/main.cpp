@@ -0,0 +1,175 @@
+#include "BenchmarkReport.h"
+
+#include "RemainingTimeEstimator.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QRandomGenerator>
+#include <QTextStream>
+
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Replays progress traces through the remaining time estimators and measures how far
+// their estimates are from the actual remaining time:
+//  - the median and the p90 relative error of the estimate between 10% and 90% of the task,
+//  - the part of the estimates, whose confidence band contains the actual remaining time.
+//
+// Besides the built-in synthetic traces, recorded traces are replayed when given by
+// the --trace option, e.g. --trace copy.csv --trace build.csv. A trace file has a line
+// "milliseconds,value" for each progress update, the last line is the finish of the task.
+
+namespace
+{
+
+struct Sample
+{
+    qint64 m_milliseconds;
+    qint64 m_value;
+};
+
+struct Trace
+{
+    QString m_name;
+    std::vector<Sample> m_samples;
+};
+
+struct EstimatorCase
+{
+    const char* m_name;
+    std::function<std::unique_ptr<APD::RemainingTimeEstimator>()> m_create;
+};
+
+// a task of 10000 steps updating progress every 50 ms, at the rate given by the time in seconds
+Trace syntheticTrace(const QString& name, const std::function<double(double)>& rate)
+{
+    const qint64 maximum = 10000;
+    const qint64 interval = 50;
+
+    Trace trace { name, {} };
+    double value = 0;
+    for (qint64 ms = 0; value < maximum; ms += interval)
+    {
+        trace.m_samples.push_back({ ms, static_cast<qint64>(value) });
+        value += std::max(0.0, rate(ms / 1000.0)) * interval / 1000.0;
+    }
+    trace.m_samples.push_back({ trace.m_samples.back().m_milliseconds + interval, maximum });
+    return trace;
+}
+
+std::vector<Trace> syntheticTraces()
+{
+    // the generator is seeded, so the traces are the same in every run
+    auto random = std::make_shared<QRandomGenerator>(42);
+    auto noise = [random](double amplitude) { return 1 + amplitude * (2 * random->generateDouble() - 1); };
+
+    return {
+        syntheticTrace("constant", [](double) { return 100.0; }),
+        syntheticTrace("noisy", [noise](double) { return 100.0 * noise(0.5); }),
+        syntheticTrace("slow start", [](double t) { return t < 10 ? 20.0 : 150.0; }),
+        syntheticTrace("slowing down", [](double t) { return 200.0 / (1 + t / 20); }),
+        syntheticTrace("speeding up", [](double t) { return 40.0 + 4 * t; }),
+        syntheticTrace("stalls", [](double t) { return std::fmod(t, 15) < 3 ? 0.0 : 120.0; }),
+    };
+}
+
+bool readTrace(const QString& fileName, Trace& trace)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+
+    trace = { QFileInfo(fileName).completeBaseName(), {} };
+    QTextStream stream(&file);
+    while (!stream.atEnd())
+    {
+        auto fields = stream.readLine().split(',');
+        bool msOk = false;
+        bool valueOk = false;
+        if (fields.size() == 2)
+        {
+            Sample sample { fields[0].trimmed().toLongLong(&msOk), fields[1].trimmed().toLongLong(&valueOk) };
+            if (msOk && valueOk)
+                trace.m_samples.push_back(sample);
+        }
+    }
+    return trace.m_samples.size() >= 2;
+}
+
+void replay(BenchmarkReport& report, const Trace& trace, const EstimatorCase& estimatorCase)
+{
+    auto estimator = estimatorCase.m_create();
+    const auto& first = trace.m_samples.front();
+    const auto& last = trace.m_samples.back();
+    const auto start = APD::TimeStamp();
+
+    std::vector<double> errors;
+    int estimates = 0;
+    int covered = 0;
+    for (const auto& sample : trace.m_samples)
+    {
+        estimator->addSample(sample.m_value, start + std::chrono::milliseconds(sample.m_milliseconds));
+
+        // the estimates right after the start and close to the end tell little
+        auto progress = static_cast<double>(sample.m_value - first.m_value) / static_cast<double>(last.m_value - first.m_value);
+        if (progress < 0.1 || progress > 0.9)
+            continue;
+
+        auto actual = static_cast<double>(last.m_milliseconds - sample.m_milliseconds);
+        auto estimate = estimator->estimate(last.m_value);
+        if (actual <= 0)
+            continue;
+
+        // no estimate counts as completely wrong
+        errors.push_back(estimate ? std::abs(static_cast<double>(estimate->m_remaining.count()) - actual) / actual : 1.0);
+        if (estimate && estimate->m_hasConfidence)
+        {
+            ++estimates;
+            if (estimate->m_lower.count() <= actual && actual <= estimate->m_upper.count())
+                ++covered;
+        }
+    }
+
+    auto name = QString("eta/%1/%2").arg(trace.m_name, estimatorCase.m_name);
+    report.add(name + "/p50 error", 1, 100 * BenchmarkReport::percentile(errors, 0.5), "%");
+    report.add(name + "/p90 error", 1, 100 * BenchmarkReport::percentile(errors, 0.9), "%");
+    if (estimates > 0)
+        report.add(name + "/band coverage", 1, 100.0 * covered / estimates, "%");
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    const std::vector<EstimatorCase> estimators {
+        { "Average", []() { return std::make_unique<APD::AverageRateEstimator>(); } },
+        { "MovingRate", []() { return std::make_unique<APD::MovingRateEstimator>(); } },
+        { "WindowRegression", []() { return std::make_unique<APD::WindowRegressionEstimator>(); } },
+        { "AlphaBeta", []() { return std::make_unique<APD::AlphaBetaEstimator>(); } },
+    };
+
+    auto traces = syntheticTraces();
+    auto arguments = app.arguments();
+    for (int i = arguments.indexOf("--trace"); i >= 0 && i + 1 < arguments.size(); i = arguments.indexOf("--trace", i + 2))
+    {
+        Trace trace;
+        if (!readTrace(arguments[i + 1], trace))
+        {
+            qWarning("estimators: cannot read the trace %s", qPrintable(arguments[i + 1]));
+            return 1;
+        }
+        traces.push_back(std::move(trace));
+    }
+
+    BenchmarkReport report("estimators");
+    for (const auto& trace : traces)
+        for (const auto& estimatorCase : estimators)
+            replay(report, trace, estimatorCase);
+
+    return report.write(arguments) ? 0 : 1;
+}
@@ -0,0 +1,550 @@
+#include "BenchmarkReport.h"
+
+#include "AsyncProgressDialog.h"
+#include "FunctionThread.h"
+#include "Pipeline.h"
+#include "ProgressBar.h"
+#include "ProgressEstimate.h"
+#include "ProgressLabel.h"
+#include "ProgressLogView.h"
+#include "ProgressOutput.h"
+#include "ProgressVelocityPlot.h"
+
+#include <QApplication>
+#include <QEventLoop>
+#include <QTimer>
+
+#include <atomic>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Measures the cost of the progress signal path:
+//  - the cost of reporting progress in the worker thread,
+//  - the throughput of a worker against the frequency of its updates,
+//  - the cost of reporting items of one task from many producer threads,
+//  - the latency of the delivery to the GUI thread,
+//  - the cost of the progress widget slots in the GUI thread,
+//  - the CPU time of the GUI thread against the number of tasks,
+//  - the highest rate of updates and of output lines the GUI thread keeps up with,
+//  - the throughput of a pipeline, which must complete under the concurrency limits.
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+const int s_taskCounts[] = { 1, 4, 16, 64, 256, 1024 };
+
+struct Metrics
+{
+    qint64 bytes;
+    qint64 items;
+};
+
+const APD::MetricsLayout s_metricsLayout {
+    APD::metricsField<&Metrics::bytes>("bytes"),
+    APD::metricsField<&Metrics::items>("items"),
+};
+
+double nanosecondsSince(Clock::time_point start)
+{
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+}
+
+// runs the threads to completion and processes the events they have posted
+void runThreads(const std::vector<std::unique_ptr<APD::TaskThread>>& threads)
+{
+    for (auto& thread : threads)
+        thread->start();
+    for (auto& thread : threads)
+        thread->wait();
+    QCoreApplication::processEvents();
+}
+
+struct EmitCase
+{
+    const char* m_name;
+    APD::TaskThread::UpdateMode m_mode;
+    std::function<void(APD::TaskThread*, int)> m_update;
+};
+
+void benchmarkEmitCost(BenchmarkReport& report)
+{
+    const std::vector<EmitCase> cases {
+        { "emit/setValue/immediate", APD::TaskThread::Immediate, [](APD::TaskThread* t, int i) { t->setValue(i); } },
+        { "emit/setValue+QVariant/immediate", APD::TaskThread::Immediate, [](APD::TaskThread* t, int i) { t->setValue(i, 1.5 * i); } },
+        { "emit/setValue/coalesced", APD::TaskThread::Coalesced, [](APD::TaskThread* t, int i) { t->setValue(i); } },
+        { "emit/setValue+QVariant/coalesced", APD::TaskThread::Coalesced, [](APD::TaskThread* t, int i) { t->setValue(i, 1.5 * i); } },
+        { "emit/setMetrics", APD::TaskThread::Immediate,
+          [](APD::TaskThread* t, int i) { t->setMetrics(i, Metrics{ 4096 * i, i }, s_metricsLayout); } },
+        { "emit/advance", APD::TaskThread::Immediate, [](APD::TaskThread* t, int) { t->advance(); } },
+        { "emit/setRange/immediate", APD::TaskThread::Immediate, [](APD::TaskThread* t, int i) { t->setRange(0, i); } },
+        { "emit/setText/immediate", APD::TaskThread::Immediate, [](APD::TaskThread* t, int) { t->setText(QStringLiteral("Processing item")); } },
+        { "emit/setText/coalesced", APD::TaskThread::Coalesced, [](APD::TaskThread* t, int) { t->setText(QStringLiteral("Processing item")); } },
+    };
+
+    QObject receiver;
+    for (const auto& emitCase : cases)
+        for (auto taskCount : s_taskCounts)
+        {
+            auto iterations = std::max(1000, 200000 / taskCount);
+            std::vector<double> costs(static_cast<size_t>(taskCount));
+
+            std::vector<std::unique_ptr<APD::TaskThread>> threads;
+            for (int task = 0; task < taskCount; ++task)
+            {
+                auto cost = &costs[static_cast<size_t>(task)];
+                auto thread = std::make_unique<APD::FunctionThread<void>>([&emitCase, iterations, cost](APD::TaskThread* t) {
+                    auto start = Clock::now();
+                    for (int i = 0; i < iterations; ++i)
+                        emitCase.m_update(t, i);
+                    *cost = nanosecondsSince(start) / iterations;
+                });
+                thread->setTextBufferCapacity(iterations + 1);
+                thread->setUpdateMode(emitCase.m_mode);
+
+                // the receiver lives in the GUI thread, so the signals are queued as in the dialog
+                QObject::connect(thread.get(), &APD::TaskThread::valueChanged, &receiver, []() {});
+                QObject::connect(thread.get(), &APD::TaskThread::rangeChanged, &receiver, []() {});
+                QObject::connect(thread.get(), &APD::TaskThread::textChanged, &receiver, []() {});
+                QObject::connect(thread.get(), &APD::TaskThread::updatesPending, &receiver, []() {});
+                threads.push_back(std::move(thread));
+            }
+
+            runThreads(threads);
+            for (auto& thread : threads)
+                thread->flushUpdates();
+
+            report.add(emitCase.m_name, taskCount, BenchmarkReport::percentile(costs, 0.5), "ns/op");
+        }
+}
+
+// the work of an item, some arithmetic the compiler can't drop
+quint64 processItem(quint64 seed)
+{
+    for (int i = 0; i < 64; ++i)
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    return seed;
+}
+
+void benchmarkWorkerThroughput(BenchmarkReport& report)
+{
+    const int items = 500000;
+
+    for (auto mode : { APD::TaskThread::Immediate, APD::TaskThread::Coalesced })
+        for (int itemsPerUpdate : { 10000, 1000, 100, 10, 1 })
+        {
+            APD::AsyncProgressDialog dialog;
+            dialog.setUpdateMode(mode);
+
+            // the dialog delivers the updates meanwhile, as it does for a real task
+            double seconds = 0;
+            dialog.addTask([&seconds, itemsPerUpdate, items](APD::TaskThread* t) {
+                t->setRange(0, items);
+                quint64 seed = 0;
+                auto start = Clock::now();
+                for (int i = 1; i <= items; ++i)
+                {
+                    seed = processItem(seed);
+                    if (i % itemsPerUpdate == 0)
+                        t->setValue(i);
+                }
+                seconds = nanosecondsSince(start) / 1e9;
+                return seed;
+            });
+            dialog.exec();
+
+            auto name = QString("throughput/%1/%2 items per update")
+                    .arg(mode == APD::TaskThread::Immediate ? "immediate" : "coalesced").arg(itemsPerUpdate);
+            report.add(name, 1, items / seconds, "items/s");
+        }
+}
+
+struct ProducerCase
+{
+    const char* m_name;
+    std::function<void(APD::TaskThread*, std::atomic<qint64>&)> m_update;
+};
+
+void benchmarkProducers(BenchmarkReport& report)
+{
+    // setValue() needs a counter shared by the producers, advance() counts by itself
+    const std::vector<ProducerCase> cases {
+        { "producers/setValue per item", [](APD::TaskThread* t, std::atomic<qint64>& done) {
+              t->setValue(done.fetch_add(1, std::memory_order_relaxed) + 1);
+          } },
+        { "producers/advance", [](APD::TaskThread* t, std::atomic<qint64>&) { t->advance(); } },
+    };
+
+    const qint64 items = 800000;
+    QObject receiver;
+    for (const auto& producerCase : cases)
+        for (int producers : { 1, 8, 64 })
+        {
+            double cost = 0;
+            std::vector<std::unique_ptr<APD::TaskThread>> threads;
+            threads.push_back(std::make_unique<APD::FunctionThread<void>>([&producerCase, &cost, producers, items](APD::TaskThread* t) {
+                std::atomic<qint64> done { 0 };
+                std::vector<std::thread> workers;
+                auto start = Clock::now();
+                for (int producer = 0; producer < producers; ++producer)
+                    workers.emplace_back([&producerCase, &done, t, producers, items]() {
+                        for (qint64 i = 0; i < items / producers; ++i)
+                            producerCase.m_update(t, done);
+                    });
+                for (auto& worker : workers)
+                    worker.join();
+
+                // the wall time of the task per item, as seen by the user
+                cost = nanosecondsSince(start) / items;
+            }));
+
+            auto thread = threads.back().get();
+            thread->setRange(0, items);
+            QObject::connect(thread, &APD::TaskThread::valueChanged, &receiver, []() {});
+            QObject::connect(thread, &APD::TaskThread::updatesPending, &receiver, []() {});
+
+            runThreads(threads);
+            thread->flushUpdates();
+
+            report.add(QString("%1/%2 producers").arg(producerCase.m_name).arg(producers), 1, cost, "ns/item");
+        }
+}
+
+void benchmarkDeliveryLatency(BenchmarkReport& report)
+{
+    for (auto mode : { APD::TaskThread::Immediate, APD::TaskThread::Coalesced })
+        for (auto taskCount : s_taskCounts)
+        {
+            const int updates = std::max(20, 2000 / taskCount);
+            std::vector<double> latencies;
+            latencies.reserve(static_cast<size_t>(updates * taskCount));
+
+            QObject receiver;
+            QEventLoop loop;
+            int finished = 0;
+
+            std::vector<std::unique_ptr<APD::TaskThread>> threads;
+            for (int task = 0; task < taskCount; ++task)
+            {
+                auto thread = std::make_unique<APD::FunctionThread<void>>([updates](APD::TaskThread* t) {
+                    for (int i = 0; i < updates; ++i)
+                    {
+                        t->setValue(i);
+                        QThread::usleep(500);
+                    }
+                });
+                thread->setUpdateMode(mode);
+
+                // the time stamp is taken by setValue() in the worker
+                QObject::connect(thread.get(), &APD::TaskThread::valueChanged, &receiver,
+                        [&latencies](qint64, const QVariant&, const APD::TimeStamp& timeStamp) {
+                            latencies.push_back(nanosecondsSince(timeStamp) / 1000);
+                        });
+                auto raw = thread.get();
+                QObject::connect(thread.get(), &APD::TaskThread::updatesPending, &receiver, [raw]() { raw->flushUpdates(); });
+                QObject::connect(thread.get(), &QThread::finished, &receiver, [&]() {
+                    if (++finished == taskCount)
+                        loop.quit();
+                });
+                threads.push_back(std::move(thread));
+            }
+
+            for (auto& thread : threads)
+                thread->start();
+            loop.exec();
+            for (auto& thread : threads)
+                thread->wait();
+
+            auto name = QString("latency/%1").arg(mode == APD::TaskThread::Immediate ? "immediate" : "coalesced");
+            report.add(name + "/p50", taskCount, BenchmarkReport::percentile(latencies, 0.5), "us");
+            report.add(name + "/p99", taskCount, BenchmarkReport::percentile(latencies, 0.99), "us");
+        }
+}
+
+struct SlotCase
+{
+    const char* m_name;
+    std::function<APD::ProgressWidget*()> m_create;
+    std::function<void(APD::ProgressWidget*, int, const APD::TimeStamp&)> m_update;
+};
+
+void benchmarkSlotCost(BenchmarkReport& report)
+{
+    auto setValue = [](APD::ProgressWidget* w, int i, const APD::TimeStamp& ts) { w->setValue(i, QVariant(), ts); };
+    auto setQuantity = [](APD::ProgressWidget* w, int i, const APD::TimeStamp& ts) { w->setValue(i, 4096.0, ts); };
+    auto setMetrics = [](APD::ProgressWidget* w, int i, const APD::TimeStamp& ts) {
+        w->setMetrics(i, APD::ProgressMetrics(Metrics{ 4096 * i, i }, s_metricsLayout), ts);
+    };
+    auto setText = [](APD::ProgressWidget* w, int i, const APD::TimeStamp&) { w->setText(QString("Processing item %1").arg(i)); };
+
+    const std::vector<SlotCase> cases {
+        { "ProgressBar", []() { return new APD::ProgressBar(); }, setValue },
+        { "ProgressEstimate", []() { return new APD::ProgressEstimate(); }, setValue },
+        { "ProgressLabel", []() { return new APD::ProgressLabel(); }, setText },
+        { "ProgressOutput", []() { return new APD::ProgressOutput(); }, setText },
+        { "ProgressLogView", []() { return new APD::ProgressLogView(); }, setText },
+        { "ProgressVelocityPlot+QVariant", []() { return new APD::ProgressVelocityPlot(); }, setQuantity },
+        { "ProgressVelocityPlot+metrics", []() {
+              auto plot = new APD::ProgressVelocityPlot();
+              plot->setQuantityField("bytes");
+              return plot;
+          }, setMetrics },
+    };
+
+    const int iterations = 2000;
+    for (const auto& slotCase : cases)
+    {
+        // outside of a dialog, each update renders right away
+        {
+            std::unique_ptr<APD::ProgressWidget> widget(slotCase.m_create());
+            widget->setRange(0, iterations);
+            widget->show();
+
+            auto start = Clock::now();
+            for (int i = 0; i < iterations; ++i)
+                slotCase.m_update(widget.get(), i, start + std::chrono::milliseconds(i));
+            report.add(QString("slot/%1/unpaced").arg(slotCase.m_name), 1, nanosecondsSince(start) / iterations, "ns/op");
+        }
+
+        // inside of a dialog, the slots only store the state until the next frame
+        {
+            APD::AsyncProgressDialog dialog;
+            std::atomic<bool> done { false };
+            auto widget = slotCase.m_create();
+            dialog.addTask([&done](APD::TaskThread*) { while (!done) QThread::msleep(1); }, widget);
+            widget->setRange(0, iterations);
+            dialog.show();
+
+            auto start = Clock::now();
+            for (int i = 0; i < iterations; ++i)
+                slotCase.m_update(widget, i, start + std::chrono::milliseconds(i));
+            report.add(QString("slot/%1/paced").arg(slotCase.m_name), 1, nanosecondsSince(start) / iterations, "ns/op");
+
+            done = true;
+            dialog.threadAt(0)->wait();
+            QCoreApplication::processEvents();
+        }
+    }
+}
+
+struct RateCase
+{
+    const char* m_name;
+    const char* m_unit;
+    APD::TaskThread::UpdateMode m_mode;
+    std::vector<int> m_taskCounts;
+    std::function<void(APD::TaskThread*, qint64)> m_update;
+    std::function<APD::ProgressWidget*()> m_createWidget;
+};
+
+double threadCpuSeconds()
+{
+#ifdef Q_OS_UNIX
+    timespec time;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_nsec) / 1e9;
+#else
+    // the whole process, which includes the workers
+    return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+#endif
+}
+
+void benchmarkGuiCpu(BenchmarkReport& report)
+{
+    const auto duration = std::chrono::milliseconds(1000);
+    const auto interval = std::chrono::milliseconds(10);
+
+    for (auto taskCount : s_taskCounts)
+    {
+        APD::AsyncProgressDialog dialog;
+        for (int task = 0; task < taskCount; ++task)
+            dialog.addTask([duration, interval](APD::TaskThread* t) {
+                t->setRange(0, duration / interval);
+                auto start = Clock::now();
+                auto next = start;
+                qint64 value = 0;
+                while (Clock::now() - start < duration)
+                {
+                    t->setValue(++value);
+                    next += interval;
+                    std::this_thread::sleep_until(next);
+                }
+            });
+
+        // the tasks and their widgets are created already, only the updates are measured
+        auto cpuStart = threadCpuSeconds();
+        auto start = Clock::now();
+        dialog.exec();
+        auto cpu = threadCpuSeconds() - cpuStart;
+
+        report.add("gui cpu/setValue at 100 Hz per task", taskCount, 100 * cpu / (nanosecondsSince(start) / 1e9), "% of a core");
+    }
+}
+
+// Returns true if the GUI thread has drained the updates of taskCount tasks sending
+// totalRate updates per second within 50 ms after the tasks have stopped.
+bool isRateSustained(const RateCase& rateCase, int taskCount, qint64 totalRate)
+{
+    const auto duration = std::chrono::milliseconds(300);
+    const auto maximumDrainTime = std::chrono::milliseconds(50);
+    const auto perTaskPerMillisecond = std::max<qint64>(1, totalRate / taskCount / 1000);
+
+    std::atomic<qint64> emitted { 0 };
+    std::atomic<int> running { taskCount };
+    std::atomic<Clock::rep> lastStop { 0 };
+    qint64 delivered = 0;
+
+    APD::AsyncProgressDialog dialog;
+    dialog.setUpdateMode(rateCase.m_mode);
+    QObject receiver;
+    QEventLoop loop;
+
+    auto checkDone = [&]() {
+        if (running == 0 && delivered == emitted)
+            loop.quit();
+    };
+
+    for (int task = 0; task < taskCount; ++task)
+    {
+        auto thread = new APD::FunctionThread<void>([&, perTaskPerMillisecond, duration](APD::TaskThread* t) {
+            auto start = Clock::now();
+            auto next = start;
+            qint64 value = 0;
+            while (Clock::now() - start < duration)
+            {
+                // a burst of updates every millisecond keeps the rate without busy waiting
+                for (qint64 i = 0; i < perTaskPerMillisecond; ++i)
+                    rateCase.m_update(t, ++value);
+                emitted += perTaskPerMillisecond;
+                next += std::chrono::milliseconds(1);
+                std::this_thread::sleep_until(next);
+            }
+
+            auto stop = Clock::now().time_since_epoch().count();
+            auto last = lastStop.load();
+            while (stop > last && !lastStop.compare_exchange_weak(last, stop)) {}
+            --running;
+        }, &dialog);
+
+        // coalesced texts arrive in batches, the other updates one by one
+        QObject::connect(thread, &APD::TaskThread::valueChanged, &receiver, [&]() {
+            ++delivered;
+            checkDone();
+        });
+        QObject::connect(thread, &APD::TaskThread::textChanged, &receiver, [&]() {
+            ++delivered;
+            checkDone();
+        });
+        QObject::connect(thread, &APD::TaskThread::textBatchChanged, &receiver, [&](const QStringList& texts) {
+            delivered += texts.size();
+            checkDone();
+        });
+        dialog.addTask(thread, rateCase.m_createWidget());
+    }
+
+    QTimer timer;
+    QObject::connect(&timer, &QTimer::timeout, &receiver, checkDone);
+    timer.start(5);
+
+    // give up on a backlog, which would take too long to drain
+    QTimer::singleShot(std::chrono::milliseconds(10000), &loop, &QEventLoop::quit);
+    loop.exec();
+
+    auto drained = running == 0 && delivered == emitted;
+    auto drainTime = Clock::now() - Clock::time_point(Clock::duration(lastStop.load()));
+    for (int i = 0; i < dialog.threadCount(); ++i)
+        dialog.threadAt(i)->wait();
+    return drained && drainTime < maximumDrainTime;
+}
+
+void benchmarkSustainedRate(BenchmarkReport& report)
+{
+    const std::vector<RateCase> cases {
+        { "sustained/setValue/immediate", "updates/s", APD::TaskThread::Immediate,
+          std::vector<int>(std::begin(s_taskCounts), std::end(s_taskCounts)),
+          [](APD::TaskThread* t, qint64 i) { t->setValue(i); },
+          []() { return APD::ProgressWidgetFactory::createProgressBar(); } },
+        // the ceiling of lines per second a build log style task can print
+        { "sustained/setText/ProgressOutput", "lines/s", APD::TaskThread::Coalesced, { 1, 4, 16 },
+          [](APD::TaskThread* t, qint64) { t->setText(QStringLiteral("Compiling src/ProgressOutput.cpp")); },
+          []() { return new APD::ProgressOutput(); } },
+    };
+
+    for (const auto& rateCase : cases)
+        for (auto taskCount : rateCase.m_taskCounts)
+        {
+            qint64 sustained = 0;
+            for (qint64 rate = std::max<qint64>(1000, 1000 * taskCount); rate <= 16 * 1024 * 1024; rate *= 2)
+            {
+                if (!isRateSustained(rateCase, taskCount, rate))
+                    break;
+                sustained = rate;
+            }
+            report.add(rateCase.m_name, taskCount, static_cast<double>(sustained), rateCase.m_unit);
+        }
+}
+
+// Returns false if a pipeline of three stages doesn't complete in a dialog running
+// one task at a time, i.e. if the stages are held back by the concurrency limit.
+void benchmarkPipeline(BenchmarkReport& report)
+{
+    const qint64 items = 1000000;
+
+    APD::AsyncProgressDialog dialog;
+    dialog.setMaximumConcurrency(1);
+    dialog.setAutoClose(true);
+
+    APD::Pipeline pipeline(&dialog, 256);
+    auto numbers = pipeline.addSource<qint64>("Generate", [items](APD::TaskThread*, APD::PipelineQueue<qint64>& output) {
+        for (qint64 i = 0; i < items; ++i)
+            if (!output.push(i))
+                return;
+    });
+    auto squares = pipeline.addStage<qint64>("Square", numbers,
+            [](APD::TaskThread*, APD::PipelineQueue<qint64>& input, APD::PipelineQueue<qint64>& output) {
+        while (auto number = input.pop())
+            if (!output.push(*number * *number))
+                return;
+    });
+    std::atomic<qint64> received { 0 };
+    pipeline.addSink("Sum", squares, [&received](APD::TaskThread*, APD::PipelineQueue<qint64>& input) {
+        while (input.pop())
+            ++received;
+    });
+
+    auto start = Clock::now();
+    QTimer::singleShot(std::chrono::milliseconds(10000), &dialog, &APD::AsyncProgressDialog::reject);
+    dialog.exec();
+    auto seconds = nanosecondsSince(start) / 1e9;
+
+    for (int i = 0; i < dialog.threadCount(); ++i)
+        dialog.threadAt(i)->wait();
+
+    // a pipeline stalled by the concurrency limit shows as less than 100% completed
+    report.add("pipeline/3 stages/maximumConcurrency 1", 3, static_cast<double>(received) / seconds, "items/s");
+    report.add("pipeline/3 stages/maximumConcurrency 1/completed", 3, 100.0 * received / items, "%");
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    BenchmarkReport::useOffscreenPlatform();
+    QApplication app(argc, argv);
+
+    BenchmarkReport report("signalpath");
+    benchmarkEmitCost(report);
+    benchmarkWorkerThroughput(report);
+    benchmarkProducers(report);
+    benchmarkDeliveryLatency(report);
+    benchmarkSlotCost(report);
+    benchmarkGuiCpu(report);
+    benchmarkSustainedRate(report);
+    benchmarkPipeline(report);
+
+    return report.write(app.arguments()) ? 0 : 1;
+}
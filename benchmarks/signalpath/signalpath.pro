@@ -0,0 +1,7 @@
+TARGET = signalpath
+TEMPLATE = app
+
+include(../common/common.pri)
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,164 @@
+#include "AllocationCounter.h"
+#include "BenchmarkReport.h"
+
+#include "ProgressBar.h"
+#include "ProgressEstimate.h"
+#include "ProgressLabel.h"
+#include "ProgressLogView.h"
+#include "ProgressOutput.h"
+#include "ProgressVelocityPlot.h"
+#include "ProgressWidgetFactory.h"
+
+#include <QApplication>
+#include <QImage>
+#include <QLayout>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Measures the cost of a frame of each progress widget and of the compositions made
+// by ProgressWidgetFactory:
+//  - the p50 and p99 time of applying an update and rendering the widget into an image,
+//  - the number of allocations per frame,
+//  - the heap memory held by a widget instance after a number of frames.
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+const int s_warmUpFrames = 60;
+const int s_frames = 1000;
+const int s_instances = 16;
+const QSize s_size(480, 24);
+
+struct PaintCase
+{
+    const char* m_name;
+    std::function<APD::ProgressWidget*()> m_create;
+};
+
+// the widget isn't shown, so it's only painted by the explicit render into the image
+void prepare(APD::ProgressWidget* widget, QImage& image)
+{
+    widget->ensurePolished();
+    if (auto layout = widget->layout())
+        layout->activate();
+
+    auto size = s_size.expandedTo(widget->sizeHint());
+    widget->resize(size);
+    image = QImage(size, QImage::Format_ARGB32_Premultiplied);
+    widget->setRange(0, s_warmUpFrames + s_frames);
+}
+
+// one frame of a synthetic task: the state coalesced since the previous frame, then the paint
+void renderFrame(APD::ProgressWidget* widget, QImage& image, int frame, Clock::time_point start)
+{
+    auto timeStamp = start + std::chrono::milliseconds(16 * frame);
+    auto quantity = 4096.0 * (1 + frame % 7);
+
+    widget->setValue(frame, quantity, timeStamp);
+    widget->setText(QString("Processing item %1").arg(frame));
+    image.fill(Qt::white);
+    widget->render(&image);
+}
+
+void benchmarkFrames(BenchmarkReport& report, const PaintCase& paintCase)
+{
+    std::unique_ptr<APD::ProgressWidget> widget(paintCase.m_create());
+    QImage image;
+    prepare(widget.get(), image);
+
+    auto start = Clock::now();
+    for (int frame = 0; frame < s_warmUpFrames; ++frame)
+        renderFrame(widget.get(), image, frame, start);
+
+    std::vector<double> frameTimes;
+    frameTimes.reserve(s_frames);
+    auto allocations = AllocationCounter::allocationCount();
+
+    for (int frame = s_warmUpFrames; frame < s_warmUpFrames + s_frames; ++frame)
+    {
+        auto frameStart = Clock::now();
+        renderFrame(widget.get(), image, frame, start);
+        frameTimes.push_back(std::chrono::duration<double, std::micro>(Clock::now() - frameStart).count());
+    }
+
+    // reserved above, so the samples don't add to the count
+    allocations = AllocationCounter::allocationCount() - allocations;
+
+    report.add(QString("frame/%1/p50").arg(paintCase.m_name), 1, BenchmarkReport::percentile(frameTimes, 0.5), "us");
+    report.add(QString("frame/%1/p99").arg(paintCase.m_name), 1, BenchmarkReport::percentile(frameTimes, 0.99), "us");
+    report.add(QString("frame/%1/allocations").arg(paintCase.m_name), 1,
+               static_cast<double>(allocations) / s_frames, "allocations/frame");
+}
+
+void benchmarkMemory(BenchmarkReport& report, const PaintCase& paintCase)
+{
+    std::vector<QImage> images(s_instances);
+    std::vector<std::unique_ptr<APD::ProgressWidget>> widgets;
+    widgets.reserve(s_instances);
+
+    auto before = AllocationCounter::liveBytes();
+    auto start = Clock::now();
+    for (auto& image : images)
+    {
+        widgets.emplace_back(paintCase.m_create());
+        prepare(widgets.back().get(), image);
+        for (int frame = 0; frame < s_warmUpFrames; ++frame)
+            renderFrame(widgets.back().get(), image, frame, start);
+    }
+
+    QCoreApplication::processEvents();
+
+    // the pixels of the images are counted too, but they don't belong to the widgets
+    auto bytes = AllocationCounter::liveBytes() - before;
+    for (const auto& image : images)
+        bytes -= image.sizeInBytes();
+    report.add(QString("memory/%1").arg(paintCase.m_name), s_instances,
+               static_cast<double>(bytes) / s_instances / 1024, "KiB/instance");
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    BenchmarkReport::useOffscreenPlatform();
+    QApplication app(argc, argv);
+
+    using APD::AdditionalWidget;
+    using APD::ProgressWidgetFactory;
+
+    const std::vector<PaintCase> cases {
+        { "ProgressBar", []() { return new APD::ProgressBar(); } },
+        { "ProgressEstimate", []() { return new APD::ProgressEstimate(); } },
+        { "ProgressLabel", []() { return new APD::ProgressLabel(); } },
+        { "ProgressOutput", []() { return new APD::ProgressOutput(); } },
+        { "ProgressLogView", []() { return new APD::ProgressLogView(); } },
+        { "ProgressVelocityPlot", []() { return new APD::ProgressVelocityPlot(); } },
+        { "createProgressBar(Estimate|Label)", []() {
+              return ProgressWidgetFactory::createProgressBar(AdditionalWidget::Estimate | AdditionalWidget::Label);
+          } },
+        { "createProgressBar(Estimate|Output)", []() {
+              return ProgressWidgetFactory::createProgressBar(AdditionalWidget::Estimate | AdditionalWidget::Output);
+          } },
+        { "createVelocityBar", []() { return ProgressWidgetFactory::createVelocityBar(); } },
+        { "createVelocityBar(Estimate|Output)", []() {
+              return ProgressWidgetFactory::createVelocityBar(AdditionalWidget::Estimate | AdditionalWidget::Output);
+          } },
+        { "createVelocityBar(Estimate|LogView)", []() {
+              return ProgressWidgetFactory::createVelocityBar(AdditionalWidget::Estimate | AdditionalWidget::LogView);
+          } },
+    };
+
+    BenchmarkReport report("widgetpaint");
+    for (const auto& paintCase : cases)
+    {
+        benchmarkFrames(report, paintCase);
+        benchmarkMemory(report, paintCase);
+    }
+
+    return report.write(app.arguments()) ? 0 : 1;
+}
@@ -0,0 +1,12 @@
+TARGET = widgetpaint
+TEMPLATE = app
+
+include(../common/common.pri)
+
+# replaces malloc() and the global operator new, so it's linked into this benchmark only
+SOURCES += \
+    main.cpp \
+    ../common/AllocationCounter.cpp
+
+HEADERS += \
+    ../common/AllocationCounter.h
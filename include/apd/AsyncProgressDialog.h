@@ -5,6 +5,7 @@
 #include "FunctionThread.h"
 
 #include <QDialog>
+#include <QVector>
 
 #include <functional>
 
@@ -13,6 +14,9 @@ namespace APD
 {
 
 class TaskThread;
+class TaskPool;
+class TraceRecorder;
+class RenderClock;
 class ProgressWidget;
 
 class AsyncProgressDialog : public QDialog
@@ -23,7 +27,17 @@ public:
     explicit AsyncProgressDialog(QWidget *parent = nullptr, Qt::WindowFlags flags = Qt::WindowFlags());
     ~AsyncProgressDialog() override;
 
+    enum ViewMode
+    {
+        WidgetView,
+        ListView,
+    };
+
+    using WidgetFactory = std::function<ProgressWidget*()>;
+
     void addTask(TaskThread* thread, ProgressWidget* widget);
+    void addTask(TaskThread* thread, WidgetFactory factory);
+    void addTask(TaskThread* thread, const QVector<TaskThread*>& prerequisites, ProgressWidget* widget = nullptr);
 
     /*!
         Add task defined by a function \a func and the associated progress \a widget.
@@ -31,30 +45,105 @@ public:
         progress as reported by the function thread. The thread object is returned by
         this method.
 
-        The ownership of \a widget is transferred to the dialog.
+        The ownership of \a widget is transferred to the dialog. If \a widget is nullptr,
+        a default progress bar is created in the WidgetView mode. In the ListView mode,
+        \a widget must be nullptr, see addTask(TaskThread*, ProgressWidget*).
 
         The ownership of the function thread object is set to this dialog and is deleted
         in the destructor of the dialog.
+
+        If \a func returns a Coroutine (see Coroutine.h), a CoroutineThread is created
+        instead and the coroutine runs on CoroutineReactor::globalInstance().
     */
     template <typename F>
-    auto addTask(F func, ProgressWidget* widget = ProgressWidgetFactory::createProgressBar())
-        -> FunctionThread<decltype(func(static_cast<TaskThread*>(nullptr)))>*
+    auto addTask(F func, ProgressWidget* widget = nullptr)
+        -> typename TaskThreadFor<decltype(func(static_cast<TaskThread*>(nullptr)))>::Type*
     {
-        using ResultType = decltype(func(static_cast<TaskThread*>(nullptr)));
-        auto thread = new FunctionThread<ResultType>(std::move(func), this);
+        using ThreadType = typename TaskThreadFor<decltype(func(static_cast<TaskThread*>(nullptr)))>::Type;
+        auto thread = new ThreadType(std::move(func), this);
         addTask(thread, widget);
         return thread;
     }
 
+    /*!
+        Add task defined by a function \a func, whose progress widget is created by
+        \a factory only when the task starts or reports progress. The method creates
+        a FunctionThread, or a CoroutineThread for a coroutine, internally and returns it.
+
+        \sa addTask(TaskThread*, WidgetFactory)
+    */
+    template <typename F>
+    auto addTask(F func, WidgetFactory factory)
+        -> typename TaskThreadFor<decltype(func(static_cast<TaskThread*>(nullptr)))>::Type*
+    {
+        using ThreadType = typename TaskThreadFor<decltype(func(static_cast<TaskThread*>(nullptr)))>::Type;
+        auto thread = new ThreadType(std::move(func), this);
+        addTask(thread, std::move(factory));
+        return thread;
+    }
+
+    /*!
+        Add task defined by a function \a func, which starts as soon as all its \a prerequisites
+        finish, and the associated progress \a widget. The method creates a FunctionThread
+        object internally and returns it, so it can be a prerequisite of the following tasks.
+
+        \sa addTask(TaskThread*, const QVector<TaskThread*>&, ProgressWidget*)
+    */
+    template <typename F>
+    auto addTask(F func, const QVector<TaskThread*>& prerequisites, ProgressWidget* widget = nullptr)
+        -> typename TaskThreadFor<decltype(func(static_cast<TaskThread*>(nullptr)))>::Type*
+    {
+        using ThreadType = typename TaskThreadFor<decltype(func(static_cast<TaskThread*>(nullptr)))>::Type;
+        auto thread = new ThreadType(std::move(func), this);
+        addTask(thread, prerequisites, widget);
+        return thread;
+    }
+
     void setAutoClose(bool close);
     bool autoClose() const;
 
     void setOverallProgress(bool enabled);
     bool hasOverallProgress() const;
+    qint64 remainingTime() const;
 
     void setLabelText(const QString& labelText);
     QString labelText() const;
 
+    void setViewMode(ViewMode mode);
+    ViewMode viewMode() const;
+
+    void setUpdateMode(TaskThread::UpdateMode mode);
+    TaskThread::UpdateMode updateMode() const;
+
+    void setRefreshInterval(int msec);
+    int refreshInterval() const;
+
+    void setFrameInterval(int msec);
+    int frameInterval() const;
+
+    void setMinimumDuration(int msec);
+    int minimumDuration() const;
+
+    void setTaskPool(TaskPool* pool);
+    TaskPool* taskPool() const;
+
+    void setGuiCoreReserved(bool reserved);
+    bool isGuiCoreReserved() const;
+
+    void setMaximumConcurrency(int count);
+    int maximumConcurrency() const;
+
+    void setResourceLimit(const QString& resource, int count);
+    int resourceLimit(const QString& resource) const;
+
+    void setTaskPriority(TaskThread* thread, int priority);
+    int taskPriority(TaskThread* thread) const;
+
+    void setTracingEnabled(bool enabled);
+    bool isTracingEnabled() const;
+    TraceRecorder* traceRecorder() const;
+    bool exportTrace(const QString& fileName) const;
+
     int threadCount() const;
     TaskThread* threadAt(int index) const;
 
@@ -64,12 +153,23 @@ public:
     void setAutoHideWidget(int index, bool autoHide);
     bool autoHideWidget(int index) const;
 
+    void setVisible(bool visible) override;
+
 public slots:
     void reject() override;
 
+protected:
+    void contextMenuEvent(QContextMenuEvent* event) override;
+
 private:
     Q_DISABLE_COPY(AsyncProgressDialog)
 
+    friend class RenderClock;
+    RenderClock* renderClock() const;
+
+    friend class Pipeline;
+    void addPipelineStage(TaskThread* thread, ProgressWidget* widget);
+
     class Impl;
     std::unique_ptr<Impl> m_impl;
 };
@@ -0,0 +1,434 @@
+#pragma once
+
+#include "CoroutineTaskThread.h"
+#include "TaskFuture.h"
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <utility>
+
+namespace APD
+{
+
+template <class ResultType>
+class Coroutine;
+
+template <class ResultType>
+class CoroutineThread;
+
+/*!
+    \brief The part of the promise type of Coroutine, which doesn't depend on the result type.
+
+    The coroutine is created suspended and started by the reactor. \c co_yield \a value
+    sets the progress value of the task and lets other coroutines run on the thread.
+    When the coroutine returns, its frame is destroyed and the task finishes.
+    An exception escaping the coroutine terminates the program.
+*/
+class CoroutinePromiseBase
+{
+public:
+    class FinalAwaiter
+    {
+    public:
+        bool await_ready() const noexcept { return false; }
+
+        template <class Promise>
+        void await_suspend(std::coroutine_handle<Promise> handle) const noexcept
+        {
+            auto task = handle.promise().m_task;
+            handle.destroy();
+            task->finishCoroutine();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    class YieldAwaiter
+    {
+    public:
+        explicit YieldAwaiter(CoroutineTaskThread* task) : m_task(task) {}
+
+        bool await_ready() const noexcept { return false; }
+
+        // the coroutine may run in another thread before resumeSoon() returns
+        void await_suspend(std::coroutine_handle<>) const { m_task->resumeSoon(); }
+
+        void await_resume() const noexcept {}
+
+    private:
+        CoroutineTaskThread* m_task;
+    };
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+
+    YieldAwaiter yield_value(qint64 value)
+    {
+        m_task->setValue(value);
+        return YieldAwaiter(m_task);
+    }
+
+    void unhandled_exception() const noexcept { std::terminate(); }
+
+    static void resumeFrame(void* frame) { std::coroutine_handle<>::from_address(frame).resume(); }
+    static void destroyFrame(void* frame) { std::coroutine_handle<>::from_address(frame).destroy(); }
+
+    CoroutineTaskThread* m_task = nullptr;
+};
+
+/*!
+    \brief The promise type of Coroutine, which stores the returned value into the task.
+*/
+template <class ResultType>
+class CoroutinePromise : public CoroutinePromiseBase
+{
+public:
+    Coroutine<ResultType> get_return_object()
+    {
+        return Coroutine<ResultType>(std::coroutine_handle<CoroutinePromise>::from_promise(*this));
+    }
+
+    void return_value(ResultType value)
+    {
+        static_cast<CoroutineThread<ResultType>*>(m_task)->setResult(std::move(value));
+    }
+};
+
+/*!
+    \brief The promise type of Coroutine returning no value.
+*/
+template <>
+class CoroutinePromise<void> : public CoroutinePromiseBase
+{
+public:
+    Coroutine<void> get_return_object();
+
+    void return_void();
+};
+
+/*!
+    \brief The return type of a coroutine executed as a task by CoroutineThread.
+
+    The coroutine receives the task as its parameter, the same way as the function
+    of FunctionThread does, and reports its progress by \c co_yield of the progress
+    value or by the methods of TaskThread. Besides \c co_yield, it may suspend by
+    \c co_await of sleepFor(), readable() and writable(). Awaiting other coroutines
+    or awaitables is not supported.
+
+    \code
+    dialog.addTask([](TaskThread* task) -> Coroutine<int> {
+        task->setRange(0, 100);
+        for (int i = 0; i <= 100 && !task->isCanceled(); ++i)
+        {
+            co_await sleepFor(std::chrono::milliseconds(20));
+            co_yield i;
+        }
+        co_return 42;
+    });
+    \endcode
+
+    The header requires C++20 and declares nothing if the compiler doesn't support coroutines.
+*/
+template <class ResultType>
+class Coroutine
+{
+public:
+    using promise_type = CoroutinePromise<ResultType>;
+
+    //! The task class executing the coroutine, used by AsyncProgressDialog::addTask()
+    using CoroutineThreadType = CoroutineThread<ResultType>;
+
+    Coroutine(Coroutine&& other) noexcept
+        : m_handle(std::exchange(other.m_handle, nullptr))
+    {}
+
+    Coroutine& operator=(Coroutine&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (m_handle)
+                m_handle.destroy();
+            m_handle = std::exchange(other.m_handle, nullptr);
+        }
+        return *this;
+    }
+
+    ~Coroutine()
+    {
+        if (m_handle)
+            m_handle.destroy();
+    }
+
+    /*!
+        Releases the ownership of the coroutine frame and returns its handle.
+    */
+    std::coroutine_handle<promise_type> release()
+    {
+        return std::exchange(m_handle, nullptr);
+    }
+
+private:
+    friend promise_type;
+
+    explicit Coroutine(std::coroutine_handle<promise_type> handle)
+        : m_handle(handle)
+    {}
+
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+inline Coroutine<void> CoroutinePromise<void>::get_return_object()
+{
+    return Coroutine<void>(std::coroutine_handle<CoroutinePromise>::from_promise(*this));
+}
+
+/*!
+    \brief A task executing the coroutine returned by the function provided in the
+    constructor of this class on a CoroutineReactor.
+
+    \tparam ResultType
+        The value returned by \c co_return can be accessed using result() method,
+        moved out by takeResult() or passed to a continuation by future().
+        Note that the result is not ready until the task finishes.
+
+    When the task is canceled, its coroutine is destroyed at the next suspension point
+    and the future is canceled, see TaskFuture.
+*/
+template <class ResultType>
+class CoroutineThread : public CoroutineTaskThread
+{
+public:
+    //! Definition of a function to be passed to constructor of this class
+    using Function = std::function<Coroutine<ResultType>(TaskThread*)>;
+
+    /*!
+        Construct a new coroutine task. Function \a func is expected to accept one
+        parameter - a pointer to TaskThread object - and to return the coroutine.
+        The function is kept alive by the task, so the coroutine may refer to its captures.
+    */
+    CoroutineThread(Function func, QObject* parent = nullptr)
+        : CoroutineTaskThread(parent)
+        , m_func(std::move(func))
+    {}
+
+    /*!
+        Destroy the task. The future of a coroutine, which hasn't returned, is canceled.
+    */
+    ~CoroutineThread() override
+    {
+        destroyCoroutine();
+    }
+
+    /*!
+        Return the value returned by the coroutine, or std::nullopt if the task has
+        not finished yet or has been canceled.
+    */
+    std::optional<ResultType> result() const
+    {
+        return m_state->result();
+    }
+
+    /*!
+        Move the value returned by the coroutine out of the task, or return std::nullopt
+        if the task has not finished yet or the result has been taken.
+    */
+    std::optional<ResultType> takeResult()
+    {
+        return m_state->takeResult();
+    }
+
+    /*!
+        Return a future sharing the result with this task.
+    */
+    TaskFuture<ResultType> future() const
+    {
+        return TaskFuture<ResultType>(m_state);
+    }
+
+protected:
+    /*!
+        Reimplementation of CoroutineTaskThread::createCoroutine()
+    */
+    void createCoroutine() override
+    {
+        auto handle = m_func(this).release();
+        handle.promise().m_task = this;
+        setCoroutine(handle.address(), &CoroutinePromiseBase::resumeFrame, &CoroutinePromiseBase::destroyFrame);
+    }
+
+    /*!
+        Reimplementation of CoroutineTaskThread::coroutineDestroyed(), the future
+        finishes without a result.
+    */
+    void coroutineDestroyed() override
+    {
+        m_state->cancel();
+    }
+
+private:
+    Q_DISABLE_COPY(CoroutineThread)
+
+    friend class CoroutinePromise<ResultType>;
+
+    void setResult(ResultType result)
+    {
+        m_state->setResult(std::move(result));
+    }
+
+    Function m_func;
+    std::shared_ptr<TaskResultState<ResultType>> m_state = std::make_shared<TaskResultState<ResultType>>();
+};
+
+/*!
+    \brief A task executing the coroutine returned by the function provided in the
+    constructor of this class on a CoroutineReactor.
+
+    When the task is canceled, its coroutine is destroyed at the next suspension point
+    and the future is canceled, see TaskFuture.
+*/
+template <>
+class CoroutineThread<void> : public CoroutineTaskThread
+{
+public:
+    //! Definition of a function to be passed to constructor of this class
+    using Function = std::function<Coroutine<void>(TaskThread*)>;
+
+    /*!
+        Construct a new coroutine task. Function \a func is expected to accept one
+        parameter - a pointer to TaskThread object - and to return the coroutine.
+    */
+    CoroutineThread(Function func, QObject* parent = nullptr)
+        : CoroutineTaskThread(parent)
+        , m_func(std::move(func))
+    {}
+
+    /*!
+        Destroy the task. The future of a coroutine, which hasn't returned, is canceled.
+    */
+    ~CoroutineThread() override
+    {
+        destroyCoroutine();
+    }
+
+    /*!
+        Return a future, which finishes as soon as the coroutine returns.
+    */
+    TaskFuture<void> future() const
+    {
+        return TaskFuture<void>(m_state);
+    }
+
+protected:
+    /*!
+        Reimplementation of CoroutineTaskThread::createCoroutine()
+    */
+    void createCoroutine() override
+    {
+        auto handle = m_func(this).release();
+        handle.promise().m_task = this;
+        setCoroutine(handle.address(), &CoroutinePromiseBase::resumeFrame, &CoroutinePromiseBase::destroyFrame);
+    }
+
+    /*!
+        Reimplementation of CoroutineTaskThread::coroutineDestroyed(), the future
+        finishes without a result.
+    */
+    void coroutineDestroyed() override
+    {
+        m_state->cancel();
+    }
+
+private:
+    Q_DISABLE_COPY(CoroutineThread)
+
+    friend class CoroutinePromise<void>;
+
+    Function m_func;
+    std::shared_ptr<TaskResultState<void>> m_state = std::make_shared<TaskResultState<void>>();
+};
+
+inline void CoroutinePromise<void>::return_void()
+{
+    static_cast<CoroutineThread<void>*>(m_task)->m_state->finish();
+}
+
+/*!
+    \brief An awaitable suspending the coroutine of a CoroutineThread for a duration.
+*/
+class SleepAwaiter
+{
+public:
+    explicit SleepAwaiter(std::chrono::steady_clock::duration delay) : m_delay(delay) {}
+
+    bool await_ready() const noexcept { return m_delay <= std::chrono::steady_clock::duration::zero(); }
+
+    template <class Promise>
+    void await_suspend(std::coroutine_handle<Promise> handle) const
+    {
+        handle.promise().m_task->resumeAfter(m_delay);
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+    std::chrono::steady_clock::duration m_delay;
+};
+
+/*!
+    \brief An awaitable suspending the coroutine of a CoroutineThread until a file
+    descriptor is ready.
+*/
+class FileDescriptorAwaiter
+{
+public:
+    FileDescriptorAwaiter(int fd, bool write) : m_fd(fd), m_write(write) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    template <class Promise>
+    void await_suspend(std::coroutine_handle<Promise> handle) const
+    {
+        handle.promise().m_task->resumeWhenReady(m_fd, m_write);
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+    int m_fd;
+    bool m_write;
+};
+
+/*!
+    Returns an awaitable resuming the coroutine after \a delay. If the task is canceled
+    meanwhile, the coroutine is destroyed without being resumed.
+*/
+inline SleepAwaiter sleepFor(std::chrono::steady_clock::duration delay)
+{
+    return SleepAwaiter(delay);
+}
+
+/*!
+    Returns an awaitable resuming the coroutine when \a fd is ready for reading.
+    If the task is canceled meanwhile, the coroutine is destroyed without being resumed.
+*/
+inline FileDescriptorAwaiter readable(int fd)
+{
+    return FileDescriptorAwaiter(fd, false);
+}
+
+/*!
+    Returns an awaitable resuming the coroutine when \a fd is ready for writing.
+    If the task is canceled meanwhile, the coroutine is destroyed without being resumed.
+*/
+inline FileDescriptorAwaiter writable(int fd)
+{
+    return FileDescriptorAwaiter(fd, true);
+}
+
+}
+
+#endif
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <QtGlobal>
+
+#include <chrono>
+#include <memory>
+
+namespace APD
+{
+
+class CoroutineTaskThread;
+
+class CoroutineReactor
+{
+public:
+    explicit CoroutineReactor(int threadCount = 0);
+    ~CoroutineReactor();
+
+    static CoroutineReactor* globalInstance();
+
+    int threadCount() const;
+    int activeTaskCount() const;
+
+private:
+    Q_DISABLE_COPY(CoroutineReactor)
+
+    friend class CoroutineTaskThread;
+    void start(CoroutineTaskThread* task);
+    void post(CoroutineTaskThread* task);
+    void postAfter(CoroutineTaskThread* task, std::chrono::steady_clock::duration delay);
+    void postWhenReady(CoroutineTaskThread* task, int fd, bool write);
+    void finish(CoroutineTaskThread* task);
+
+    void workerLoop();
+    void resume(CoroutineTaskThread* task);
+
+    class Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+}
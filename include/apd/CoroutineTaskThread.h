@@ -0,0 +1,50 @@
+#pragma once
+
+#include "TaskThread.h"
+
+#include <chrono>
+#include <memory>
+
+namespace APD
+{
+
+class CoroutineReactor;
+
+class CoroutineTaskThread : public TaskThread
+{
+    Q_OBJECT
+
+public:
+    explicit CoroutineTaskThread(QObject* parent = nullptr);
+    ~CoroutineTaskThread() override;
+
+    void start(CoroutineReactor* reactor);
+    CoroutineReactor* reactor() const;
+
+    // called by the awaitables of Coroutine from within the suspending coroutine
+    void resumeSoon();
+    void resumeAfter(std::chrono::steady_clock::duration delay);
+    void resumeWhenReady(int fd, bool write);
+    void finishCoroutine();
+
+protected:
+    using CoroutineFunction = void (*)(void* coroutine);
+
+    virtual void createCoroutine() = 0;
+    virtual void coroutineDestroyed();
+    void setCoroutine(void* coroutine, CoroutineFunction resume, CoroutineFunction destroy);
+    void destroyCoroutine();
+
+    void run() override;
+
+private:
+    Q_DISABLE_COPY(CoroutineTaskThread)
+
+    friend class CoroutineReactor;
+    void resumeCoroutine();
+
+    class Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+}
@@ -1,11 +1,13 @@
 #pragma once
 
 #include "TaskThread.h"
+#include "TaskFuture.h"
 
 #include <QThread>
 #include <QVariant>
 
 #include <optional>
+#include <type_traits>
 
 namespace APD
 {
@@ -15,7 +17,8 @@ namespace APD
     of this class as soon as the thread is started.
 
     \tparam ResultType
-        The return value of the function can be accessed using result() method.
+        The return value of the function can be accessed using result() method,
+        moved out by takeResult() or passed to a continuation by future().
         Note that the result is not ready until the thread finishes.
 */
 template <class ResultType>
@@ -35,14 +38,42 @@ public:
         , m_func(std::move(func))
     {}
 
+    /*!
+        Destroy the thread. The future of a function, which has never run, e.g. a task
+        still waiting to be started when its dialog is destroyed, is canceled.
+    */
+    ~FunctionThread() override
+    {
+        if (!m_state->isFinished())
+            m_state->cancel();
+    }
+
     /*!
         Return an object, which has been previously returned by the function passed
         in the constructor, or std::nullopt if the thread has not finished yet.
     */
     std::optional<ResultType> result() const
     {
-        std::lock_guard<std::mutex> lck (m_resultMutex);
-        return m_result;
+        return m_state->result();
+    }
+
+    /*!
+        Move the object returned by the function out of the thread, or return
+        std::nullopt if the thread has not finished yet or the result has been taken.
+        Unlike result(), the result is not copied.
+    */
+    std::optional<ResultType> takeResult()
+    {
+        return m_state->takeResult();
+    }
+
+    /*!
+        Return a future sharing the result with this thread. The future finishes as
+        soon as the function returns and stays valid after the thread is deleted.
+    */
+    TaskFuture<ResultType> future() const
+    {
+        return TaskFuture<ResultType>(m_state);
     }
 
 protected:
@@ -52,17 +83,14 @@ protected:
     */
     void run() override
     {
-        auto result = m_func(this);
-        std::lock_guard<std::mutex> lck (m_resultMutex);
-        m_result = std::move(result);
+        m_state->setResult(m_func(this));
     }
 
 private:
     Q_DISABLE_COPY(FunctionThread)
 
     Function m_func;
-    std::optional<ResultType> m_result;
-    mutable std::mutex m_resultMutex;
+    std::shared_ptr<TaskResultState<ResultType>> m_state = std::make_shared<TaskResultState<ResultType>>();
 };
 
 /*!
@@ -87,6 +115,24 @@ public:
         , m_func(std::move(func))
     {}
 
+    /*!
+        Destroy the thread. The future of a function, which has never run, e.g. a task
+        still waiting to be started when its dialog is destroyed, is canceled.
+    */
+    ~FunctionThread() override
+    {
+        if (!m_state->isFinished())
+            m_state->cancel();
+    }
+
+    /*!
+        Return a future, which finishes as soon as the function returns.
+    */
+    TaskFuture<void> future() const
+    {
+        return TaskFuture<void>(m_state);
+    }
+
 protected:
     /*!
         Reimplementation of QThread::run()
@@ -94,12 +140,32 @@ protected:
     void run() override
     {
         m_func(this);
+        m_state->finish();
     }
 
 private:
     Q_DISABLE_COPY(FunctionThread<void>)
 
     Function m_func;
+    std::shared_ptr<TaskResultState<void>> m_state = std::make_shared<TaskResultState<void>>();
+};
+
+/*!
+    \brief Selects the task class executing a function, which returns \a ResultType.
+
+    A function is executed by FunctionThread, unless its result type names the task
+    class by \c CoroutineThreadType, as Coroutine does.
+*/
+template <class ResultType, class = void>
+struct TaskThreadFor
+{
+    using Type = FunctionThread<ResultType>;
+};
+
+template <class ResultType>
+struct TaskThreadFor<ResultType, std::void_t<typename ResultType::CoroutineThreadType>>
+{
+    using Type = typename ResultType::CoroutineThreadType;
 };
 
 
@@ -0,0 +1,175 @@
+#pragma once
+
+#include "TaskThread.h"
+#include "TaskPool.h"
+
+#include <QThread>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+
+namespace APD
+{
+
+/*!
+    Specifies how parallelFor() distributes the iterations among worker threads.
+*/
+enum class Schedule
+{
+    //! Each worker processes one contiguous block of the range of the same size.
+    Static,
+    //! Workers repeatedly take the next chunk of the range until the range is exhausted.
+    Dynamic,
+};
+
+/*!
+    Calls \a body for each index in the range [\a begin, \a end) using all available cores.
+    The function is meant to be called from within a task \a thread, it blocks until all
+    iterations finish and returns true if the whole range has been processed, or false if
+    the task has been canceled.
+
+    The range is split into chunks of \a chunkSize iterations, which are distributed among
+    QThread::idealThreadCount() workers according to \a schedule. If \a chunkSize is not
+    positive, a chunk size giving each worker about sixteen chunks is used.
+    TaskThread::isCanceled() is checked between chunks.
+
+    The calling thread is one of the workers, the other ones run on TaskPool::globalInstance(),
+    so the call doesn't create any thread. The workers take the chunks, or the blocks of
+    Schedule::Static, one by one, so the whole range is processed even if the pool is busy,
+    e.g. by tasks of a dialog using the same pool. The calling thread then does more of the work.
+
+    The progress range of \a thread is set to [\a begin, \a end]. Workers report finished
+    chunks by TaskThread::advance(), which increments a counter shard owned by the worker.
+    The loop is therefore displayed by the single progress widget of the task and the
+    workers never contend for a shared counter.
+
+    If \a body throws an exception, the remaining chunks are skipped and the first
+    exception is rethrown in the calling thread.
+
+    \snippet mainwindow.cpp ParallelForExample
+*/
+template <class Body>
+bool parallelFor(TaskThread* thread, qint64 begin, qint64 end, Body body,
+                 Schedule schedule = Schedule::Dynamic, int chunkSize = 0)
+{
+    assert(thread);
+    if (end <= begin)
+        return !thread->isCanceled();
+
+    const qint64 count = end - begin;
+    const int threadCount = static_cast<int>(std::min<qint64>(std::max(QThread::idealThreadCount(), 1), count));
+    const qint64 chunk = chunkSize > 0 ? chunkSize : std::max<qint64>(1, count / (threadCount * 16));
+
+    // a unit of work is a block of the range in the static schedule and a chunk in the dynamic one
+    const qint64 unitCount = schedule == Schedule::Static ? threadCount : (count + chunk - 1) / chunk;
+
+    thread->setRange(begin, end);
+    thread->setValue(begin);
+
+    // a pool thread may pick up a worker after the call has returned, so it shares the state
+    struct State
+    {
+        std::atomic<qint64> m_nextUnit { 0 };
+        std::atomic<qint64> m_doneCount { 0 };
+        std::atomic<bool> m_failed { false };
+        std::atomic<int> m_activeWorkers { 0 };
+        std::exception_ptr m_error;
+        std::mutex m_mutex;
+        std::condition_variable m_workersDone;
+    };
+    auto state = std::make_shared<State>();
+
+    auto processChunk = [&](qint64 first, qint64 last, qint64& done)
+    {
+        for (auto i = first; i < last; ++i)
+            body(i);
+
+        thread->advance(last - first);
+        done += last - first;
+    };
+
+    auto stopRequested = [&]()
+    {
+        return thread->isCanceled() || state->m_failed.load(std::memory_order_relaxed);
+    };
+
+    auto work = [&](qint64 unit)
+    {
+        qint64 done = 0;
+        try
+        {
+            for (; unit < unitCount && !stopRequested(); unit = state->m_nextUnit.fetch_add(1))
+            {
+                if (schedule == Schedule::Static)
+                {
+                    auto blockBegin = begin + (count * unit) / threadCount;
+                    auto blockEnd = begin + (count * (unit + 1)) / threadCount;
+                    for (auto first = blockBegin; first < blockEnd && !stopRequested(); first += chunk)
+                        processChunk(first, std::min(first + chunk, blockEnd), done);
+                }
+                else
+                {
+                    auto first = begin + unit * chunk;
+                    processChunk(first, std::min(first + chunk, end), done);
+                }
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lck(state->m_mutex);
+            if (!state->m_error)
+                state->m_error = std::current_exception();
+            state->m_failed = true;
+        }
+
+        state->m_doneCount.fetch_add(done, std::memory_order_relaxed);
+    };
+
+    // A worker touches the stack of the call only after taking a unit. Once the units are
+    // exhausted or closed, a late worker takes none and the call doesn't wait for it.
+    auto worker = [state, unitCount, &work]()
+    {
+        state->m_activeWorkers.fetch_add(1);
+        auto unit = state->m_nextUnit.fetch_add(1);
+        if (unit < unitCount)
+            work(unit);
+
+        if (state->m_activeWorkers.fetch_sub(1) == 1)
+        {
+            std::lock_guard<std::mutex> lck(state->m_mutex);
+            state->m_workersDone.notify_all();
+        }
+    };
+
+    // the calling thread processes the range alone if no worker can be queued
+    try
+    {
+        for (int i = 1; i < threadCount; ++i)
+            TaskPool::globalInstance()->run(worker);
+    }
+    catch (...)
+    {
+    }
+
+    work(state->m_nextUnit.fetch_add(1));
+
+    // close the units, so only the workers, which have already taken one, are waited for
+    state->m_nextUnit.store(unitCount);
+    {
+        std::unique_lock<std::mutex> lck(state->m_mutex);
+        state->m_workersDone.wait(lck, [&state]() { return state->m_activeWorkers.load() == 0; });
+    }
+
+    if (state->m_error)
+        std::rethrow_exception(state->m_error);
+
+    auto done = state->m_doneCount.load();
+    thread->setValue(begin + done);
+    return done == count;
+}
+
+}
@@ -0,0 +1,250 @@
+#pragma once
+
+#include "AsyncProgressDialog.h"
+#include "FunctionThread.h"
+#include "SpscQueue.h"
+
+#include <QObject>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+
+namespace APD
+{
+
+class TaskThread;
+
+class PipelineQueueBase
+{
+public:
+    explicit PipelineQueueBase(std::size_t capacity);
+    virtual ~PipelineQueueBase();
+
+    std::size_t capacity() const;
+    std::size_t size() const;
+    double fillLevel() const;
+
+    qint64 pushedCount() const;
+    qint64 poppedCount() const;
+    qint64 producerWaitTime() const;
+    qint64 consumerWaitTime() const;
+
+    void close();
+    bool isClosed() const;
+    void abandon();
+    bool isAbandoned() const;
+
+    void setProducer(TaskThread* thread);
+    void setConsumer(TaskThread* thread);
+
+protected:
+    using Clock = std::chrono::steady_clock;
+
+    bool isProducerCanceled() const;
+    bool isConsumerCanceled() const;
+    static void backoff(int round);
+    static Clock::time_point beginWait(std::atomic<qint64>& waitStart);
+    static void endWait(std::atomic<qint64>& waitStart, std::atomic<qint64>& waitTime, Clock::time_point start);
+
+    std::atomic<qint64> m_pushed { 0 };
+    std::atomic<qint64> m_popped { 0 };
+    std::atomic<qint64> m_producerWaitTime { 0 };   // in ns, spent waiting for a free slot
+    std::atomic<qint64> m_consumerWaitTime { 0 };   // in ns, spent waiting for an item
+
+    // in ns of Clock, when the ongoing wait started, 0 if not waiting
+    std::atomic<qint64> m_producerWaitStart { 0 };
+    std::atomic<qint64> m_consumerWaitStart { 0 };
+
+private:
+    Q_DISABLE_COPY(PipelineQueueBase)
+
+    std::size_t m_capacity;
+    std::atomic<bool> m_closed { false };
+    std::atomic<bool> m_abandoned { false };
+    TaskThread* m_producer = nullptr;
+    TaskThread* m_consumer = nullptr;
+};
+
+/*!
+    \brief A bounded lock-free queue connecting two stages of a Pipeline.
+
+    The producer stage appends items by push(), which waits while the queue is full, so
+    a slow stage holds back the stages before it rather than letting the queue grow.
+    The consumer stage takes the items by pop(), which waits while the queue is empty.
+    Both sides wait by yielding and then by sleeping for increasing periods up to 1 ms.
+
+    The queue is closed by the producer when it finishes, pop() then returns the remaining
+    items and std::nullopt afterwards. The queue is abandoned by the consumer when it
+    finishes, push() then returns false, so the producer can stop early. Canceling
+    the task of a side stops its waiting too.
+
+    \tparam T
+        The type of the items, which must be default constructible and movable.
+*/
+template <class T>
+class PipelineQueue : public PipelineQueueBase
+{
+public:
+    /*!
+        Constructs a queue, which holds up to \a capacity items.
+    */
+    explicit PipelineQueue(std::size_t capacity)
+        : PipelineQueueBase(capacity)
+        , m_queue(capacity)
+    {}
+
+    /*!
+        Appends \a value to the queue, waiting while the queue is full. Returns false if
+        the consumer has abandoned the queue or the producer task has been canceled.
+        Must be called from the producer stage only.
+    */
+    bool push(T value)
+    {
+        auto start = Clock::time_point();
+        for (int round = 0; ; ++round)
+        {
+            if (m_queue.tryPush(std::move(value)))
+                break;
+            if (round == 0)
+                start = beginWait(m_producerWaitStart);
+            if (isAbandoned() || isProducerCanceled())
+            {
+                endWait(m_producerWaitStart, m_producerWaitTime, start);
+                return false;
+            }
+            backoff(round);
+        }
+
+        if (start != Clock::time_point())
+            endWait(m_producerWaitStart, m_producerWaitTime, start);
+        m_pushed.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /*!
+        Takes the oldest item, waiting while the queue is empty. Returns std::nullopt once
+        the producer has closed the queue and all items have been taken, or if the consumer
+        task has been canceled. Must be called from the consumer stage only.
+    */
+    std::optional<T> pop()
+    {
+        T value;
+        auto start = Clock::time_point();
+        for (int round = 0; ; ++round)
+        {
+            if (m_queue.tryPop(value))
+                break;
+            if (round == 0)
+                start = beginWait(m_consumerWaitStart);
+
+            // the items pushed before closing are visible once the close is, one more try takes them
+            bool closed = isClosed();
+            if (isConsumerCanceled() || (closed && !m_queue.tryPop(value)))
+            {
+                endWait(m_consumerWaitStart, m_consumerWaitTime, start);
+                return std::nullopt;
+            }
+            if (closed)
+                break;
+            backoff(round);
+        }
+
+        if (start != Clock::time_point())
+            endWait(m_consumerWaitStart, m_consumerWaitTime, start);
+        m_popped.fetch_add(1, std::memory_order_relaxed);
+        return std::optional<T>(std::move(value));
+    }
+
+private:
+    SpscQueue<T> m_queue;
+};
+
+class Pipeline : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Pipeline(AsyncProgressDialog* dialog, std::size_t queueCapacity = 1024);
+    ~Pipeline() override;
+
+    std::size_t queueCapacity() const;
+    void setQueueCapacity(std::size_t capacity);
+
+    /*!
+        Adds the first stage of the pipeline, named \a name, executing \a func. The function
+        is called as \c func(TaskThread*, PipelineQueue<Out>& output) and pushes the items
+        to the output queue, which is closed when the function returns. The queue is
+        returned to be passed to the next stage.
+    */
+    template <class Out, class F>
+    std::shared_ptr<PipelineQueue<Out>> addSource(const QString& name, F func)
+    {
+        auto output = std::make_shared<PipelineQueue<Out>>(queueCapacity());
+        auto thread = new FunctionThread<void>([func = std::move(func), output](TaskThread* thread) mutable {
+            func(thread, *output);
+            output->close();
+        }, dialog());
+        output->setProducer(thread);
+        addStageThread(name, thread, nullptr, output);
+        return output;
+    }
+
+    /*!
+        Adds a stage, named \a name, executing \a func, which takes the items of \a input
+        and pushes its items to the returned output queue. The function is called as
+        \c func(TaskThread*, PipelineQueue<In>& input, PipelineQueue<Out>& output).
+        When the function returns, the output queue is closed and the input queue abandoned.
+    */
+    template <class Out, class In, class F>
+    std::shared_ptr<PipelineQueue<Out>> addStage(const QString& name, std::shared_ptr<PipelineQueue<In>> input, F func)
+    {
+        auto output = std::make_shared<PipelineQueue<Out>>(queueCapacity());
+        auto thread = new FunctionThread<void>([func = std::move(func), input, output](TaskThread* thread) mutable {
+            func(thread, *input, *output);
+            output->close();
+            input->abandon();
+        }, dialog());
+        input->setConsumer(thread);
+        output->setProducer(thread);
+        addStageThread(name, thread, input, output);
+        return output;
+    }
+
+    /*!
+        Adds the last stage of the pipeline, named \a name, executing \a func, which takes
+        the items of \a input. The function is called as \c func(TaskThread*, PipelineQueue<In>& input).
+        The task thread of the stage is returned, e.g. to be a prerequisite of other tasks.
+    */
+    template <class In, class F>
+    TaskThread* addSink(const QString& name, std::shared_ptr<PipelineQueue<In>> input, F func)
+    {
+        auto thread = new FunctionThread<void>([func = std::move(func), input](TaskThread* thread) mutable {
+            func(thread, *input);
+            input->abandon();
+        }, dialog());
+        input->setConsumer(thread);
+        addStageThread(name, thread, input, nullptr);
+        return thread;
+    }
+
+    int stageCount() const;
+    TaskThread* stageThread(int stage) const;
+    double throughput(int stage) const;
+    double utilization(int stage) const;
+    int bottleneck() const;
+
+private:
+    Q_DISABLE_COPY(Pipeline)
+
+    AsyncProgressDialog* dialog() const;
+    void addStageThread(const QString& name, TaskThread* thread,
+                        std::shared_ptr<PipelineQueueBase> input, std::shared_ptr<PipelineQueueBase> output);
+    void updateStatistics();
+
+    class Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+}
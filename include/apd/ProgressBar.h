@@ -19,8 +19,12 @@ public:
     QProgressBar* progressBar() const;
 
 public slots:
-    void setValue(int value, const QVariant&, const TimeStamp&) override;
-    void setRange(int minimum, int maximum) override;
+    void setValue(qint64 value, const QVariant&, const TimeStamp&) override;
+    void setRange(qint64 minimum, qint64 maximum) override;
+    void setState(TaskState state) override;
+
+protected:
+    void renderPendingState() override;
 
 private:
     Q_DISABLE_COPY(ProgressBar)
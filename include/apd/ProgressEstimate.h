@@ -1,6 +1,7 @@
 #pragma once
 
 #include "ProgressWidget.h"
+#include "RemainingTimeEstimator.h"
 
 #include <memory>
 
@@ -38,9 +39,15 @@ public:
     TimeFormat elapsedTimeFormat() const;
     void setElapsedTimeFormat(TimeFormat format) const;
 
+    RemainingTimeEstimator* estimator() const;
+    void setEstimator(RemainingTimeEstimator* estimator);
+
 public slots:
-    void setValue(int value, const QVariant&, const TimeStamp& timeStamp) override;
-    void setRange(int minimum, int maximum) override;
+    void setValue(qint64 value, const QVariant&, const TimeStamp& timeStamp) override;
+    void setRange(qint64 minimum, qint64 maximum) override;
+
+protected:
+    void renderPendingState() override;
 
 private:
     Q_DISABLE_COPY(ProgressEstimate)
@@ -21,6 +21,10 @@ public:
 
 public slots:
     void setText(const QString& text) override;
+    void setTextBatch(const QStringList& texts) override;
+
+protected:
+    void renderPendingState() override;
 
 private:
     Q_DISABLE_COPY(ProgressLabel)
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "ProgressWidget.h"
+
+#include <memory>
+
+namespace APD
+{
+
+class ProgressLogView : public ProgressWidget
+{
+    Q_OBJECT
+
+public:
+    enum FindOption
+    {
+        NoFindOption = 0x00,
+        CaseInsensitive = 0x01,
+        RegularExpression = 0x02,
+    };
+    Q_DECLARE_FLAGS(FindOptions, FindOption)
+
+    explicit ProgressLogView(QWidget *parent = nullptr);
+    ~ProgressLogView() override;
+
+    QString logFileName() const;
+    void setLogFileName(const QString& fileName);
+
+    qint64 lineCount() const;
+    QString line(qint64 line) const;
+    void scrollToLine(qint64 line);
+
+    void find(const QString& pattern, FindOptions options = NoFindOption);
+    void cancelFind();
+    bool isFinding() const;
+    qint64 matchCount() const;
+
+public slots:
+    void setText(const QString& text) override;
+    void setTextBatch(const QStringList& texts) override;
+
+    void findNext();
+    void findPrevious();
+
+signals:
+    void findFinished(qint64 matchCount);
+
+protected:
+    void renderPendingState() override;
+
+private:
+    Q_DISABLE_COPY(ProgressLogView)
+
+    class Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(ProgressLogView::FindOptions)
+
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <QMetaType>
+#include <QString>
+
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <type_traits>
+#include <vector>
+
+namespace APD
+{
+
+class MetricsLayout
+{
+public:
+    struct Field
+    {
+        QString m_name;
+        double (*m_read)(const void* data);
+        const void* m_typeTag;
+    };
+
+    MetricsLayout(std::initializer_list<Field> fields);
+
+    int fieldCount() const;
+    QString fieldName(int index) const;
+    int indexOf(const QString& name) const;
+    double read(int index, const void* data) const { return m_fields[static_cast<size_t>(index)].m_read(data); }
+
+    const void* typeTag() const { return m_typeTag; }
+
+    //! Returns a unique tag of the metrics struct \a T
+    template <class T>
+    static const void* typeTagOf()
+    {
+        static const char s_tag = 0;
+        return &s_tag;
+    }
+
+private:
+    Q_DISABLE_COPY(MetricsLayout)
+
+    std::vector<Field> m_fields;
+    const void* m_typeTag = nullptr;
+};
+
+template <class Member>
+struct MetricsMemberTraits;
+
+template <class Class, class Type>
+struct MetricsMemberTraits<Type Class::*>
+{
+    using StructType = Class;
+    using FieldType = Type;
+};
+
+/*!
+    Returns a description of the data member \a Member of a metrics struct, which can
+    be bound to progress widgets by \a name.
+
+    \sa MetricsLayout
+*/
+template <auto Member>
+MetricsLayout::Field metricsField(const QString& name)
+{
+    using Traits = MetricsMemberTraits<decltype(Member)>;
+    using StructType = typename Traits::StructType;
+    static_assert(std::is_arithmetic<typename Traits::FieldType>::value, "Metrics fields must be arithmetic");
+
+    return { name,
+             [](const void* data) { return static_cast<double>(static_cast<const StructType*>(data)->*Member); },
+             MetricsLayout::typeTagOf<StructType>() };
+}
+
+class ProgressMetrics
+{
+public:
+    //! The maximum size of a metrics struct in bytes
+    static constexpr size_t s_capacity = 64;
+
+    ProgressMetrics() = default;
+
+    /*!
+        Constructs a copy of \a metrics described by \a layout. The struct is copied
+        bytewise, so it must be trivially copyable and fit into s_capacity bytes.
+    */
+    template <class T>
+    ProgressMetrics(const T& metrics, const MetricsLayout& layout)
+        : m_layout(&layout)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Metrics must be trivially copyable");
+        static_assert(sizeof(T) <= s_capacity, "Metrics don't fit into ProgressMetrics::s_capacity");
+        static_assert(alignof(T) <= alignof(std::max_align_t), "Metrics are overaligned");
+        assert(layout.typeTag() == MetricsLayout::typeTagOf<T>());
+        std::memcpy(m_data, &metrics, sizeof(T));
+    }
+
+    bool isNull() const { return m_layout == nullptr; }
+    const MetricsLayout* layout() const { return m_layout; }
+
+    //! Returns the field at \a index of the layout converted to double
+    double field(int index) const { return m_layout->read(index, m_data); }
+
+    //! Returns the metrics struct, or nullptr if the metrics hold another type than \a T
+    template <class T>
+    const T* as() const
+    {
+        if (!m_layout || m_layout->typeTag() != MetricsLayout::typeTagOf<T>())
+            return nullptr;
+        return reinterpret_cast<const T*>(m_data);
+    }
+
+private:
+    const MetricsLayout* m_layout = nullptr;
+    alignas(std::max_align_t) unsigned char m_data[s_capacity];
+};
+
+}
+
+Q_DECLARE_METATYPE(APD::ProgressMetrics)
@@ -19,8 +19,23 @@ public:
 
     QPlainTextEdit* plainTextEdit() const;
 
+    int maximumLineCount() const;
+    void setMaximumLineCount(int count);
+
+    QString spillFileName() const;
+    void setSpillFileName(const QString& fileName);
+
+    bool isSpillCompressed() const;
+    void setSpillCompressed(bool compressed);
+
+    bool exportText(const QString& fileName) const;
+
 public slots:
     void setText(const QString& text) override;
+    void setTextBatch(const QStringList& texts) override;
+
+protected:
+    void renderPendingState() override;
 
 private:
     Q_DISABLE_COPY(ProgressOutput)
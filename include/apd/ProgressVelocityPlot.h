@@ -22,6 +22,9 @@ public:
     QString quantityUnits() const;
     void setQuantityUnits(const QString& quantityUnits);
 
+    QString quantityField() const;
+    void setQuantityField(const QString& name);
+
     bool isProgressHidden() const;
     void setProgressHidden(bool hide);
     bool isVelocityHistoryHidden() const;
@@ -40,8 +43,12 @@ public:
     void setVelocityHistoryBrush(const QBrush& brush);
 
 public slots:
-    void setValue(int value, const QVariant& userData, const TimeStamp& timeStamp) override;
-    void setRange(int minimum, int maximum) override;
+    void setValue(qint64 value, const QVariant& userData, const TimeStamp& timeStamp) override;
+    void setMetrics(qint64 value, const ProgressMetrics& metrics, const TimeStamp& timeStamp) override;
+    void setRange(qint64 minimum, qint64 maximum) override;
+
+protected:
+    void renderPendingState() override;
 
 private:
     Q_DISABLE_COPY(ProgressVelocityPlot)
@@ -1,12 +1,17 @@
 #pragma once
 
 #include "TimeStamp.h"
+#include "TaskState.h"
+#include "ProgressMetrics.h"
 
 #include <QWidget>
+#include <QStringList>
 
 namespace APD
 {
 
+class RenderClock;
+
 class ProgressWidget : public QWidget
 {
     Q_OBJECT
@@ -17,12 +22,22 @@ public:
     {}
 
 public slots:
-    virtual void setValue(int /*value*/, const QVariant& /*userValue*/, const TimeStamp& /*timeStamp*/) {}
-    virtual void setRange(int /*minimum*/, int /*maximum*/) {}
+    virtual void setValue(qint64 /*value*/, const QVariant& /*userValue*/, const TimeStamp& /*timeStamp*/) {}
+    virtual void setMetrics(qint64 value, const ProgressMetrics& /*metrics*/, const TimeStamp& timeStamp) { setValue(value, QVariant(), timeStamp); }
+    virtual void setRange(qint64 /*minimum*/, qint64 /*maximum*/) {}
     virtual void setText(const QString& /*text*/) {}
+    virtual void setTextBatch(const QStringList& texts) { for (const auto& text : texts) setText(text); }
+    virtual void setState(TaskState /*state*/) {}
+
+protected:
+    void requestRender();
+    virtual void renderPendingState() {}
 
 private:
     Q_DISABLE_COPY(ProgressWidget)
+
+    friend class RenderClock;
+    bool m_renderPending = false;
 };
 
 }
@@ -24,9 +24,12 @@ public:
     QGridLayout* gridLayout() const;
 
 public slots:
-    void setValue(int value, const QVariant& userData, const TimeStamp& timeStamp) override;
-    void setRange(int minimum, int maximum) override;
+    void setValue(qint64 value, const QVariant& userData, const TimeStamp& timeStamp) override;
+    void setMetrics(qint64 value, const ProgressMetrics& metrics, const TimeStamp& timeStamp) override;
+    void setRange(qint64 minimum, qint64 maximum) override;
     void setText(const QString& text) override;
+    void setTextBatch(const QStringList& texts) override;
+    void setState(TaskState state) override;
 
 private:
     Q_DISABLE_COPY(ProgressWidgetContainer)
@@ -13,6 +13,7 @@ enum class AdditionalWidget
     Estimate = 0x01,
     Label = 0x02,
     Output = 0x04,
+    LogView = 0x08,
 };
 Q_DECLARE_FLAGS(AdditionalWidgets, AdditionalWidget)
 Q_DECLARE_OPERATORS_FOR_FLAGS(AdditionalWidgets)
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "TimeStamp.h"
+
+#include <QtGlobal>
+
+#include <optional>
+#include <vector>
+
+namespace APD
+{
+
+class RemainingTimeEstimator
+{
+public:
+    struct Estimate
+    {
+        std::chrono::milliseconds m_remaining { 0 };
+        std::chrono::milliseconds m_lower { 0 };
+        std::chrono::milliseconds m_upper { 0 };
+        bool m_hasConfidence = false;
+    };
+
+    RemainingTimeEstimator() = default;
+    virtual ~RemainingTimeEstimator();
+
+    void reset();
+    void addSample(qint64 value, const TimeStamp& timeStamp);
+    std::optional<Estimate> estimate(qint64 maximum) const;
+
+protected:
+    virtual void resetRate() = 0;
+    virtual void updateRate(double value, double seconds) = 0;
+    virtual bool rate(double& perSecond, double& deviation) const = 0;
+
+private:
+    Q_DISABLE_COPY(RemainingTimeEstimator)
+
+    TimeStamp m_firstTimeStamp;
+    qint64 m_firstValue = 0;
+    qint64 m_lastValue = 0;
+    bool m_started = false;
+};
+
+class AverageRateEstimator : public RemainingTimeEstimator
+{
+protected:
+    void resetRate() override;
+    void updateRate(double value, double seconds) override;
+    bool rate(double& perSecond, double& deviation) const override;
+
+private:
+    double m_value = 0;
+    double m_seconds = 0;
+};
+
+class MovingRateEstimator : public RemainingTimeEstimator
+{
+public:
+    explicit MovingRateEstimator(double halfLife = 10);
+
+    double halfLife() const { return m_halfLife; }
+
+protected:
+    void resetRate() override;
+    void updateRate(double value, double seconds) override;
+    bool rate(double& perSecond, double& deviation) const override;
+
+private:
+    double m_halfLife;
+    double m_lastValue = 0;
+    double m_lastSeconds = 0;
+    double m_mean = 0;
+    double m_variance = 0;
+    bool m_initialized = false;
+};
+
+class WindowRegressionEstimator : public RemainingTimeEstimator
+{
+public:
+    explicit WindowRegressionEstimator(int windowSize = 64);
+
+    int windowSize() const { return static_cast<int>(m_window.size()); }
+
+protected:
+    void resetRate() override;
+    void updateRate(double value, double seconds) override;
+    bool rate(double& perSecond, double& deviation) const override;
+
+private:
+    void recomputeSums();
+
+    struct Sample
+    {
+        double m_seconds;
+        double m_value;
+    };
+
+    std::vector<Sample> m_window;
+    size_t m_next = 0;
+    size_t m_count = 0;
+
+    // running sums over the samples in the window
+    double m_sumT = 0;
+    double m_sumV = 0;
+    double m_sumTT = 0;
+    double m_sumTV = 0;
+    double m_sumVV = 0;
+};
+
+class AlphaBetaEstimator : public RemainingTimeEstimator
+{
+public:
+    explicit AlphaBetaEstimator(double alpha = 0.5, double beta = 0.1);
+
+    double alpha() const { return m_alpha; }
+    double beta() const { return m_beta; }
+
+protected:
+    void resetRate() override;
+    void updateRate(double value, double seconds) override;
+    bool rate(double& perSecond, double& deviation) const override;
+
+private:
+    double m_alpha;
+    double m_beta;
+    double m_value = 0;
+    double m_rate = 0;
+    double m_variance = 0;
+    double m_lastSeconds = 0;
+    int m_samples = 0;
+};
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace APD
+{
+
+/*!
+    \class SpscQueue
+    \brief A bounded lock-free queue for exactly one producer thread and one consumer thread.
+
+    The queue is a ring buffer with a fixed capacity set in the constructor. Each side keeps
+    a cached copy of the other side's index, so the shared indices are only read when the
+    cached one indicates a full or an empty queue.
+*/
+template <class T>
+class SpscQueue
+{
+public:
+    /*!
+        Constructs a queue, which can hold up to \a capacity items.
+    */
+    explicit SpscQueue(std::size_t capacity)
+        : m_buffer(capacity + 1)
+    {}
+
+    /*!
+        Returns the maximum number of items in the queue.
+    */
+    std::size_t capacity() const { return m_buffer.size() - 1; }
+
+    /*!
+        Appends \a value to the queue and returns true, or returns false if the queue is full.
+        The \a value is left untouched if the queue is full. Must be called from the producer
+        thread only.
+    */
+    template <class U>
+    bool tryPush(U&& value)
+    {
+        auto tail = m_tail.load(std::memory_order_relaxed);
+        auto next = increment(tail);
+        if (next == m_cachedHead)
+        {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            if (next == m_cachedHead)
+                return false;
+        }
+
+        m_buffer[tail] = std::forward<U>(value);
+        m_tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    /*!
+        Moves the oldest item into \a value and returns true, or returns false if the queue
+        is empty. Must be called from the consumer thread only.
+    */
+    bool tryPop(T& value)
+    {
+        auto head = m_head.load(std::memory_order_relaxed);
+        if (head == m_cachedTail)
+        {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            if (head == m_cachedTail)
+                return false;
+        }
+
+        value = std::move(m_buffer[head]);
+        m_head.store(increment(head), std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::size_t increment(std::size_t index) const
+    {
+        return index + 1 == m_buffer.size() ? 0 : index + 1;
+    }
+
+    std::vector<T> m_buffer;
+
+    alignas(64) std::atomic<std::size_t> m_head { 0 };     // written by the consumer
+    std::size_t m_cachedTail = 0;                           // owned by the consumer
+
+    alignas(64) std::atomic<std::size_t> m_tail { 0 };     // written by the producer
+    std::size_t m_cachedHead = 0;                           // owned by the producer
+};
+
+}
@@ -0,0 +1,274 @@
+#pragma once
+
+#include <QtGlobal>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+class QObject;
+
+namespace APD
+{
+
+class TaskPool;
+
+/*!
+    \brief The state shared by a task and the TaskFuture objects referring to it.
+
+    Continuations added by onFinished() are called once, in the thread calling finish(),
+    or immediately if the state has already finished. A state finished by cancel()
+    never gets a result.
+*/
+class TaskFutureState
+{
+public:
+    TaskFutureState() = default;
+    virtual ~TaskFutureState() = default;
+
+    bool isFinished() const;
+    bool isCanceled() const;
+    void finish();
+    void cancel();
+    void onFinished(std::function<void()> continuation);
+
+protected:
+    mutable std::mutex m_mutex;
+
+private:
+    Q_DISABLE_COPY(TaskFutureState)
+
+    bool m_finished = false;
+    bool m_canceled = false;
+    std::vector<std::function<void()>> m_continuations;
+};
+
+/*!
+    \brief The shared state of a task returning \a ResultType, which holds the result.
+*/
+template <class ResultType>
+class TaskResultState : public TaskFutureState
+{
+public:
+    /*!
+        Stores \a result and finishes the state.
+    */
+    void setResult(ResultType result)
+    {
+        {
+            std::lock_guard<std::mutex> lck (m_mutex);
+            m_result = std::move(result);
+        }
+        finish();
+    }
+
+    /*!
+        Returns a copy of the result, or std::nullopt if the task has not finished yet
+        or the result has been taken.
+    */
+    std::optional<ResultType> result() const
+    {
+        std::lock_guard<std::mutex> lck (m_mutex);
+        return m_result;
+    }
+
+    /*!
+        Moves the result out of the state, or returns std::nullopt if the task has not
+        finished yet or the result has been taken already.
+    */
+    std::optional<ResultType> takeResult()
+    {
+        std::lock_guard<std::mutex> lck (m_mutex);
+        return std::exchange(m_result, std::nullopt);
+    }
+
+private:
+    std::optional<ResultType> m_result;
+};
+
+/*!
+    \brief The shared state of a task returning no value.
+*/
+template <>
+class TaskResultState<void> : public TaskFutureState
+{
+};
+
+/*!
+    \brief Specifies where the continuations of TaskFuture::then() are executed.
+
+    An executor is implicitly constructed from a QObject, which executes the continuation
+    in the thread of the object by a queued call (e.g. the dialog for the GUI thread),
+    or from a TaskPool, which executes the continuation by one of its threads.
+*/
+class TaskExecutor
+{
+public:
+    using Work = std::function<void()>;
+
+    TaskExecutor(QObject* context);
+    TaskExecutor(TaskPool* pool);
+
+    static TaskExecutor immediate();
+
+    void execute(Work work) const;
+
+private:
+    explicit TaskExecutor(std::function<void(Work)> execute);
+
+    std::function<void(Work)> m_execute;
+};
+
+template <class ResultType>
+class TaskFuture;
+
+/*!
+    \brief The part of TaskFuture, which doesn't depend on the result type.
+
+    Futures of different result types can be passed together to whenAll() and whenAny().
+*/
+class TaskFutureBase
+{
+public:
+    TaskFutureBase() = default;
+    explicit TaskFutureBase(std::shared_ptr<TaskFutureState> state);
+
+    bool isValid() const;
+    bool isFinished() const;
+    bool isCanceled() const;
+
+    void onFinished(TaskExecutor executor, std::function<void()> continuation) const;
+
+protected:
+    std::shared_ptr<TaskFutureState> m_state;
+};
+
+/*!
+    \brief A handle to the result of a task, returned by FunctionThread::future().
+
+    The future shares the result with the task, so it stays valid after the task
+    object has been deleted. takeResult() moves the result out of the shared state,
+    so a large result is never copied. then() schedules a continuation on an executor
+    as soon as the task function returns, without waiting for the other tasks of the
+    dialog.
+
+    The result can be consumed once, either by takeResult() or by a continuation
+    of then(). Further calls see no result.
+
+    A task, which is canceled before it returns, e.g. a CoroutineThread whose coroutine
+    is destroyed at a suspension point, or a task destroyed without having run, finishes
+    the future without a result and isCanceled() returns true. The futures of whenAll() and whenAny() count it as finished.
+
+    \code
+    auto thread = dialog.addTask([](TaskThread*) { return loadRecords(); });
+    auto count = thread->future().then(TaskPool::globalInstance(), [](std::vector<Record> records) {
+        return index(std::move(records));
+    });
+    \endcode
+
+    \sa whenAll(), whenAny()
+*/
+template <class ResultType>
+class TaskFuture : public TaskFutureBase
+{
+public:
+    TaskFuture() = default;
+
+    explicit TaskFuture(std::shared_ptr<TaskResultState<ResultType>> state)
+        : TaskFutureBase(state)
+    {}
+
+    /*!
+        Returns a copy of the result, or std::nullopt if the task has not finished yet
+        or the result has been taken.
+    */
+    template <class R = ResultType, class = std::enable_if_t<!std::is_void_v<R>>>
+    std::optional<R> result() const
+    {
+        return resultState()->result();
+    }
+
+    /*!
+        Moves the result out of the future, or returns std::nullopt if the task has not
+        finished yet or the result has been taken already.
+    */
+    template <class R = ResultType, class = std::enable_if_t<!std::is_void_v<R>>>
+    std::optional<R> takeResult()
+    {
+        return resultState()->takeResult();
+    }
+
+    /*!
+        Calls \a func by \a executor as soon as the task finishes. The result is moved
+        into \a func, which returns the result of the returned future. For a task
+        returning no value, \a func takes no parameter.
+
+        If there is no result to pass, i.e. the task has been canceled or the result
+        has been taken already, \a func is not called and the returned future is
+        canceled as well.
+    */
+    template <class F>
+    auto then(TaskExecutor executor, F func) const
+    {
+        using NextType = typename ContinuationResult<F>::Type;
+
+        auto source = resultState();
+        auto target = std::make_shared<TaskResultState<NextType>>();
+        onFinished(std::move(executor), [source, target, func = std::move(func)]() mutable {
+            if constexpr (std::is_void_v<ResultType>)
+            {
+                if (source->isCanceled())
+                    target->cancel();
+                else
+                    complete(*target, func);
+            }
+            else if (auto result = source->takeResult())
+                complete(*target, func, std::move(*result));
+            else
+                target->cancel();
+        });
+
+        return TaskFuture<NextType>(target);
+    }
+
+private:
+    template <class F, class R = ResultType>
+    struct ContinuationResult
+    {
+        using Type = std::invoke_result_t<F, R>;
+    };
+
+    template <class F>
+    struct ContinuationResult<F, void>
+    {
+        using Type = std::invoke_result_t<F>;
+    };
+
+    template <class NextType, class F, class... Args>
+    static void complete(TaskResultState<NextType>& target, F& func, Args&&... args)
+    {
+        if constexpr (std::is_void_v<NextType>)
+        {
+            func(std::forward<Args>(args)...);
+            target.finish();
+        }
+        else
+            target.setResult(func(std::forward<Args>(args)...));
+    }
+
+    std::shared_ptr<TaskResultState<ResultType>> resultState() const
+    {
+        assert(m_state);
+        return std::static_pointer_cast<TaskResultState<ResultType>>(m_state);
+    }
+};
+
+TaskFuture<void> whenAll(const std::vector<TaskFutureBase>& futures);
+TaskFuture<int> whenAny(const std::vector<TaskFutureBase>& futures);
+
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QObject>
+
+#include <functional>
+#include <memory>
+
+namespace APD
+{
+
+class TaskThread;
+
+class TaskPool : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TaskPool(QObject* parent = nullptr);
+    ~TaskPool() override;
+
+    static TaskPool* globalInstance();
+
+    int maxThreadCount() const;
+    void setMaxThreadCount(int maxThreadCount);
+
+    uint stackSize() const;
+    void setStackSize(uint stackSize);
+
+    int activeThreadCount() const;
+    int queuedTaskCount() const;
+
+    void start(TaskThread* thread);
+    void run(std::function<void()> function);
+    bool waitForDone(int msecs = -1);
+
+private:
+    Q_DISABLE_COPY(TaskPool)
+
+    class Runnable;
+    class FunctionRunnable;
+    void runTask(TaskThread* thread);
+
+    class Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <QMetaType>
+
+namespace APD
+{
+    enum class TaskState
+    {
+        NotStarted,
+        Queued,
+        Running,
+        Finished,
+    };
+}
@@ -1,40 +1,123 @@
 #pragma once
 
 #include "TimeStamp.h"
+#include "TaskState.h"
+#include "ProgressMetrics.h"
 
 #include <QThread>
 #include <QVariant>
+#include <QStringList>
+#include <QVector>
+
+#include <memory>
 
 namespace APD
 {
 
+class TraceRecorder;
+
 class TaskThread : public QThread
 {
     Q_OBJECT
 
 public:
+    enum UpdateMode
+    {
+        Immediate,
+        Coalesced,
+    };
+
+    enum SchedulingPolicy
+    {
+        DefaultScheduling,
+        BatchScheduling,
+        IdleScheduling,
+    };
+
     explicit TaskThread(QObject* parent = nullptr);
     ~TaskThread();
 
-    void setRange(int minimum, int maximum);
-    void setValue(int value, const QVariant& userValue = QVariant());
+    UpdateMode updateMode() const;
+    void setUpdateMode(UpdateMode mode);
+
+    int textBufferCapacity() const;
+    void setTextBufferCapacity(int capacity);
+
+    void setRange(qint64 minimum, qint64 maximum);
+    void setValue(qint64 value, const QVariant& userValue = QVariant());
+    template <class T>
+    void setMetrics(qint64 value, const T& metrics, const MetricsLayout& layout);
+    void advance(qint64 steps = 1);
     void setText(const QString& text);
 
     bool isCanceled() const;
+    TaskState state() const;
+
+    void setTraceRecorder(std::shared_ptr<TraceRecorder> recorder, int track);
+    TraceRecorder* traceRecorder() const;
+
+    Priority threadPriority() const;
+    void setThreadPriority(Priority priority);
+
+    SchedulingPolicy schedulingPolicy() const;
+    void setSchedulingPolicy(SchedulingPolicy policy);
+
+    int niceValue() const;
+    void setNiceValue(int nice);
+
+    QVector<int> cpuAffinity() const;
+    void setCpuAffinity(const QVector<int>& cpus);
+
+    int numaNode() const;
+    void setNumaNode(int node);
+
+    QString resourceClass() const;
+    void setResourceClass(const QString& resource);
 
 public slots:
     void cancel();
+    bool flushUpdates();
 
 signals:
-    void valueChanged(int value, const QVariant& userValue, const TimeStamp& timeStamp);
-    void rangeChanged(int minimum, int maximum);
+    void valueChanged(qint64 value, const QVariant& userValue, const TimeStamp& timeStamp);
+    void metricsChanged(qint64 value, const ProgressMetrics& metrics, const TimeStamp& timeStamp);
+    void rangeChanged(qint64 minimum, qint64 maximum);
     void textChanged(const QString& text);
+    void textBatchChanged(const QStringList& texts);
+    void stateChanged(TaskState state);
+    void updatesPending();
 
 private:
     Q_DISABLE_COPY(TaskThread)
 
+    friend class TaskPool;
+    friend class CoroutineReactor;
+    void setState(TaskState state);
+    void applyScheduling(bool reusedThread);
+    void restoreScheduling();
+    void storeMetrics(qint64 value, const ProgressMetrics& metrics);
+
     struct Impl;
     std::unique_ptr<Impl> m_impl;
 };
 
+/*!
+    Sets progress value to \a value together with \a metrics, a struct described by
+    \a layout. Unlike the user value of setValue(), the metrics are passed to the
+    progress widgets without any memory allocation or meta type lookup.
+
+    The metrics are always coalesced, regardless of updateMode(). The value and the
+    metrics are stored into a lock-free slot and flushUpdates() emits metricsChanged()
+    with the latest ones instead of valueChanged(). As the metrics of the updates in
+    between are dropped, a field should hold a cumulative total, e.g. the bytes copied
+    so far, rather than the increment since the previous update.
+
+    \sa ProgressMetrics, MetricsLayout, ProgressVelocityPlot::setQuantityField()
+*/
+template <class T>
+void TaskThread::setMetrics(qint64 value, const T& metrics, const MetricsLayout& layout)
+{
+    storeMetrics(value, ProgressMetrics(metrics, layout));
+}
+
 }
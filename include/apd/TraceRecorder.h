@@ -0,0 +1,114 @@
+#pragma once
+
+#include "TimeStamp.h"
+
+#include <QString>
+#include <QStringList>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class QIODevice;
+
+namespace APD
+{
+
+class TraceRecorder
+{
+public:
+    explicit TraceRecorder(int eventsPerThread = 65536);
+    ~TraceRecorder();
+
+    int eventsPerThread() const;
+
+    int addTrack(const QString& name);
+    QString trackName(int track) const;
+
+    void begin(int track, const char* name);
+    void end(int track, const char* name);
+    void instant(int track, const char* name, const QString& text = QString());
+    void counter(int track, const char* name, qint64 value);
+    void complete(int track, const char* name, const TimeStamp& start, const TimeStamp& end);
+
+    qint64 eventCount() const;
+    qint64 droppedEventCount() const;
+
+    bool exportChromeTrace(QIODevice* device) const;
+    bool exportChromeTrace(const QString& fileName) const;
+
+    //! The track of events recorded in the GUI thread
+    static constexpr int s_guiTrack = 0;
+
+private:
+    Q_DISABLE_COPY(TraceRecorder)
+
+    // an event fills one cache line, names are string literals and texts are truncated
+    struct Event
+    {
+        const char* m_name;
+        qint64 m_time;              // nanoseconds since the recorder was constructed
+        qint64 m_duration;
+        qint64 m_value;
+        qint32 m_track;
+        char m_phase;
+        char m_text[27];
+    };
+
+    struct ThreadBuffer
+    {
+        explicit ThreadBuffer(int capacity) : m_events(new Event[static_cast<size_t>(capacity)]) {}
+
+        std::unique_ptr<Event[]> m_events;
+        std::atomic<int> m_size { 0 };
+        std::atomic<qint64> m_dropped { 0 };
+    };
+
+    ThreadBuffer* threadBuffer();
+    void record(char phase, int track, const char* name, qint64 time, qint64 duration = 0, qint64 value = 0,
+                const QString& text = QString());
+    qint64 sinceStart(const TimeStamp& timeStamp) const;
+
+    const quint64 m_id;             // unique among all recorders, identifies the cached buffer of a thread
+    const int m_eventsPerThread;
+    const TimeStamp m_start;
+
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+    std::unordered_map<std::thread::id, ThreadBuffer*> m_threadBuffers;
+    QStringList m_tracks;
+};
+
+class TraceScope
+{
+public:
+    /*!
+        Starts measuring a slot called \a name, which is recorded into \a recorder
+        as a complete event on the GUI track. Does nothing if \a recorder is nullptr.
+    */
+    TraceScope(TraceRecorder* recorder, const char* name)
+        : m_recorder(recorder)
+        , m_name(name)
+    {
+        if (m_recorder)
+            m_start = std::chrono::steady_clock::now();
+    }
+
+    ~TraceScope()
+    {
+        if (m_recorder)
+            m_recorder->complete(TraceRecorder::s_guiTrack, m_name, m_start, std::chrono::steady_clock::now());
+    }
+
+private:
+    Q_DISABLE_COPY(TraceScope)
+
+    TraceRecorder* m_recorder;
+    const char* m_name;
+    TimeStamp m_start;
+};
+
+}
@@ -2,8 +2,11 @@
 #include "ui_mainwindow.h"
 
 #include "AsyncProgressDialog.h"
+#include "ParallelFor.h"
+#include "TaskPool.h"
 
 #include <cmath>
+#include <vector>
 
 #include <QProgressDialog>
 #include <QMessageBox>
@@ -164,6 +167,10 @@ void MainWindow::on_test5_clicked()
     //! [MultiProgressExample]
     APD::AsyncProgressDialog adlg;
 
+    // APD_TRACE=trace.json records a timeline of the tasks, which can be opened in Perfetto
+    auto traceFile = qEnvironmentVariable("APD_TRACE");
+    adlg.setTracingEnabled(!traceFile.isEmpty());
+
     adlg.addTask(new MyThread(10, 1000, &adlg), APD::ProgressWidgetFactory::createProgressBar("Progress 1"));
     adlg.addTask(new MyThread(20, 500, &adlg), APD::ProgressWidgetFactory::createProgressBar("Progress 2"));
     adlg.addTask(new MyThread(80, 100, &adlg), APD::ProgressWidgetFactory::createProgressBar("Progress 3"));
@@ -172,6 +179,9 @@ void MainWindow::on_test5_clicked()
 
     adlg.setOverallProgress(true);
     adlg.exec();
+
+    if (!traceFile.isEmpty())
+        adlg.exportTrace(traceFile);
     //! [MultiProgressExample]
 }
 
@@ -208,3 +218,51 @@ void MainWindow::on_pushButton_clicked()
     QMessageBox::information(this, QString("Resut"), QString("Result is %1").arg(*thread->result()));
     //! [TaskResultExample]
 }
+
+
+void MainWindow::on_test7_clicked()
+{
+    //! [ParallelForExample]
+    APD::AsyncProgressDialog adlg;
+
+    std::vector<double> values(100000);
+    adlg.addTask([&values](APD::TaskThread* thread) {
+        // the iterations are spread over all cores, the progress is shown by a single progress bar
+        APD::parallelFor(thread, 0, static_cast<qint64>(values.size()), [&values](qint64 i) {
+            double sum = 0;
+            for (int k = 0; k < 5000; k++)
+                sum += std::sin(i + k);     // do a CPU-bound operation
+            values[i] = sum;
+        });
+    });
+
+    adlg.exec();
+    //! [ParallelForExample]
+}
+
+
+void MainWindow::on_test8_clicked()
+{
+    //! [ListViewExample]
+    APD::AsyncProgressDialog adlg;
+    adlg.setViewMode(APD::AsyncProgressDialog::ListView);
+    adlg.setTaskPool(APD::TaskPool::globalInstance());
+    adlg.setOverallProgress(true);
+
+    // thousands of tasks are painted as rows of a list, no widgets are created per task
+    for (int t = 0; t < 10000; t++)
+    {
+        adlg.addTask([t](APD::TaskThread* thread) {
+            thread->setRange(0, 20);
+            for (int i = 0; i <= 20 && !thread->isCanceled(); i++)
+            {
+                thread->setText(QString("Task %1, step %2").arg(t).arg(i));
+                thread->setValue(i);
+                QThread::msleep(5);
+            }
+        });
+    }
+
+    adlg.exec();
+    //! [ListViewExample]
+}
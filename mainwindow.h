@@ -30,6 +30,10 @@ private slots:
 
     void on_pushButton_clicked();
 
+    void on_test7_clicked();
+
+    void on_test8_clicked();
+
 private:
     Ui::MainWindow *ui;
 };
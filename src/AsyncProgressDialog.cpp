@@ -1,10 +1,31 @@
 #include "AsyncProgressDialog.h"
 #include "ProgressWidget.h"
+#include "TaskPool.h"
+#include "CoroutineReactor.h"
+#include "CoroutineTaskThread.h"
+#include "TaskListModel.h"
+#include "TaskItemDelegate.h"
+#include "RenderClock.h"
+#include "TraceRecorder.h"
+#include "ThreadScheduling.h"
+#include "DurationFormatter.h"
 
 #include <QDialogButtonBox>
 #include <QVBoxLayout>
 #include <QPushButton>
 #include <QLabel>
+#include <QListView>
+#include <QMenu>
+#include <QContextMenuEvent>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QHash>
+
+#include <algorithm>
+#include <memory>
+#include <set>
+#include <unordered_map>
+#include <vector>
 
 namespace APD
 {
@@ -16,41 +37,165 @@ class AsyncProgressDialog::Impl : public QObject
 public:
     Impl(AsyncProgressDialog* parent);
 
-    void addTask(TaskThread* thread, ProgressWidget* widget);
+    void addTask(TaskThread* thread, ProgressWidget* widget, WidgetFactory factory = WidgetFactory(),
+                 const QVector<TaskThread*>& prerequisites = QVector<TaskThread*>(), bool ownThread = false);
 
     void setOverallProgress(bool enabled);
     bool hasOverallProgress() const { return m_overallProgressBar != nullptr; }
 
+    void setGuiCoreReserved(bool reserved);
     void cancelAllTasks();
+    void refresh();
+    void scheduleRefresh();
+
+    bool deferShow();
+    void cancelDeferredShow();
+    void createWidgets();
+    void startQueuedTasks();
+    bool showTaskMenu(QWidget* widget, const QPoint& globalPos);
 
 private:    // methods
     struct TaskData;
 
-    void taskFinished(TaskThread* thread);
+    void admitTask(TaskData& task);
+    bool hasFreeSlot(const TaskData& task) const;
+    void runTask(TaskData& task);
+    void startTask(TaskThread* thread);
+    void setTaskPriority(TaskData& task, int priority);
+    void showQueued(TaskData& task);
+    bool showTaskMenu(TaskData& task, const QPoint& globalPos);
+    void taskFinished(TaskData& task);
     void closeDialog();
     bool allTasksFinished() const;
     void updateOverallProgress();
-    void updateProgressValue(TaskThread* thread, int value);
-    void updateProgressRange(TaskThread* thread, int minimum, int maximum);
-    TaskData* findTask(TaskThread* thread);
+    void updateCriticalPath();
+    void setOverallValue(qint64 value);
+    qint64 flatOverallValue() const;
+    qint64 criticalPathLength() const;
+    qint64 estimatedDuration(const TaskData& task, qint64 now) const;
+    void updateProgressValue(TaskData& task, qint64 value);
+    void updateProgressRange(TaskData& task, qint64 minimum, qint64 maximum);
+    void updateTaskProgress(TaskData& task);
+    void addListRow(TaskData& task);
+    void connectWidget(TaskData& task);
+    void connectDeferredWidget(TaskData& task);
+    void insertWidget(TaskData& task);
+    ProgressWidget* ensureWidget(TaskData& task);
+    bool needsWidget(const TaskData& task) const;
+    void createWidgetIfNeeded(TaskData& task);
+    void createWidget(TaskData& task);
+    void destroyWidget(TaskData& task);
+    void showDeferred();
+    void showIfPredictedLong();
 
 private:    // data
+    // progress of a task is kept in fixed point, so the running sum doesn't drift
+    static constexpr qint64 s_progressUnit = 1000000;
+
+    // the latest state of a task reported before its widget is created
+    struct TaskSnapshot
+    {
+        QVariant m_userValue;
+        ProgressMetrics m_metrics;
+        TimeStamp m_timeStamp;
+        QString m_text;
+        TaskState m_state = TaskState::Queued;
+        bool m_hasValue = false;
+        bool m_hasMetrics = false;
+        bool m_hasRange = false;
+        bool m_hasState = false;
+    };
+
     struct TaskData
     {
         TaskThread* m_thread;
-        ProgressWidget* m_widget;
+        ProgressWidget* m_widget;       // nullptr in the ListView mode or if not created yet
+        int m_activeIndex;              // index in m_activeTasks or -1 if finished
         bool m_autoHide = false;
-        std::pair<int, int> m_range = {0, 0};
-        int m_value = 0;
+        bool m_hasRange = false;
+        std::pair<qint64, qint64> m_range = {0, 0};
+        qint64 m_value = 0;
+        qint64 m_progress = 0;          // in units of s_progressUnit
+        int m_row = -1;                 // row in m_listModel in the ListView mode
+        bool m_flushPending = false;
+        WidgetFactory m_factory;        // creates the widget on demand, if given
+        std::unique_ptr<TaskSnapshot> m_snapshot;   // set until the widget is inserted to the dialog
+        std::vector<int> m_prerequisites;           // indices in m_tasks, all lower than the task's own
+        std::vector<TaskData*> m_dependents;        // tasks waiting for this one
+        int m_waitingFor = 0;           // number of unfinished prerequisites
+        qint64 m_startTime = -1;        // in ms of m_durationTimer, when the task started running
+        qint64 m_finishTime = -1;
+        int m_index = 0;                // index in m_tasks
+        QString m_resource;             // resource class of the thread, empty if none
+        int m_priority = 0;             // tasks of higher priority leave m_readyQueue first
+        bool m_started = false;
+        bool m_ownThread = false;       // started in its own thread right away, regardless of the limits
     };
-    QList<TaskData> m_tasks;
+
+    // the order of m_readyQueue, by priority and then in the order of addition
+    struct ReadyOrder
+    {
+        bool operator()(const TaskData* a, const TaskData* b) const
+        {
+            return a->m_priority != b->m_priority ? a->m_priority > b->m_priority : a->m_index < b->m_index;
+        }
+    };
+
+    // running tasks and the limit of a resource class, 0 is no limit
+    struct ResourceSlots
+    {
+        int m_limit = 0;
+        int m_running = 0;
+    };
+
+    // tasks in the order of addition, each slot binds its TaskData when connected
+    std::vector<std::unique_ptr<TaskData>> m_tasks;
+    std::vector<TaskData*> m_activeTasks;
+    std::vector<TaskData*> m_pendingTasks;          // tasks announcing updates to flush
+    std::unordered_map<TaskThread*, int> m_taskIndices;     // indices in m_tasks
+
+    // running sums of all tasks, so an update of a single task costs O(1)
+    qint64 m_progressSum = 0;
+    int m_tasksWithoutRange = 0;
+    qint64 m_overallValue = -1;         // last shown percentage, -1 if nothing shown yet
+
+    // with dependencies, the overall progress follows the critical path of the task graph
+    bool m_hasDependencies = false;
+    QTimer* m_criticalPathTimer;
+    qint64 m_remainingTime = -1;        // length of the critical path in ms, -1 if unknown
+
+    // tasks without unfinished prerequisites wait here while the concurrency limits are reached
+    std::set<TaskData*, ReadyOrder> m_readyQueue;
+    int m_maximumConcurrency = 0;       // 0 is no limit
+    int m_runningTasks = 0;
+    QHash<QString, ResourceSlots> m_resourceSlots;
 
     AsyncProgressDialog* m_parent;
     QDialogButtonBox* m_buttonBox;
     ProgressWidget* m_overallProgressBar = nullptr;
     QLabel* m_label;
+    QTimer* m_refreshTimer;
+    RenderClock* m_renderClock;
+    TaskPool* m_taskPool = nullptr;
+    TaskThread::UpdateMode m_updateMode = TaskThread::Immediate;
+    ViewMode m_viewMode = WidgetView;
+    QListView* m_listView = nullptr;
+    TaskListModel* m_listModel = nullptr;
     bool m_autoClose = true;
     bool m_wasCanceled = false;
+    std::shared_ptr<TraceRecorder> m_traceRecorder;
+
+    // showing the dialog is postponed until the tasks run for m_minimumDuration
+    int m_minimumDuration = 0;
+    QElapsedTimer m_durationTimer;      // started by the first task or show request
+    QTimer* m_showTimer;
+    bool m_showDeferred = false;        // show() has been called, but the dialog is hidden yet
+    bool m_widgetsDeferred = false;     // the widgets aren't inserted to the dialog yet
+
+    // the GUI thread runs on m_guiCore alone, the tasks on m_taskCpus
+    int m_guiCore = -1;
+    QVector<int> m_taskCpus;
+    ThreadScheduling m_guiScheduling;
 
 };
 
@@ -70,59 +215,643 @@ AsyncProgressDialog::Impl::Impl(AsyncProgressDialog* parent)
     connect(m_buttonBox, &QDialogButtonBox::rejected, parent, &AsyncProgressDialog::reject);
     layout->addWidget(m_label);
     layout->addWidget(m_buttonBox);
+
+    // refresh at most about 30 times per second, the timer is started by pending updates only
+    m_refreshTimer = new QTimer(this);
+    m_refreshTimer->setSingleShot(true);
+    m_refreshTimer->setInterval(33);
+    connect(m_refreshTimer, &QTimer::timeout, this, &Impl::refresh);
+
+    m_renderClock = new RenderClock(parent);
+
+    m_showTimer = new QTimer(this);
+    m_showTimer->setSingleShot(true);
+    connect(m_showTimer, &QTimer::timeout, this, &Impl::showDeferred);
+
+    m_criticalPathTimer = new QTimer(this);
+    m_criticalPathTimer->setSingleShot(true);
+    m_criticalPathTimer->setInterval(100);
+    connect(m_criticalPathTimer, &QTimer::timeout, this, &Impl::updateCriticalPath);
 }
 
-void AsyncProgressDialog::Impl::addTask(TaskThread* thread, ProgressWidget* widget)
+void AsyncProgressDialog::Impl::addTask(TaskThread* thread, ProgressWidget* widget, WidgetFactory factory,
+                                        const QVector<TaskThread*>& prerequisites, bool ownThread)
 {
-    assert(thread && widget);
+    assert(thread);
+
+    if (m_viewMode == ListView)
+    {
+        // the rows are painted by the list view, the widget stays with the caller
+        if (widget)
+            qWarning("AsyncProgressDialog: cannot use a progress widget in the ListView mode, the widget is ignored");
+        widget = nullptr;
+        factory = nullptr;
+    }
+    else if (!widget && !factory && !m_widgetsDeferred)
+        widget = ProgressWidgetFactory::createProgressBar();
+
+    if (!m_durationTimer.isValid())
+        m_durationTimer.start();
+
+    if (m_guiCore >= 0)
+    {
+        // keep the task off the GUI core, unless it's restricted to that core only
+        auto cpus = thread->cpuAffinity();
+        if (cpus.isEmpty())
+            cpus = thread->numaNode() >= 0 ? ThreadScheduling::numaNodeCpus(thread->numaNode()) : m_taskCpus;
+        cpus.removeAll(m_guiCore);
+        if (!cpus.isEmpty())
+            thread->setCpuAffinity(cpus);
+    }
 
-    QObject::connect(thread, &QThread::finished, this,
-            [this, thread](){ this->taskFinished(thread); });
+    if (m_traceRecorder)
+        thread->setTraceRecorder(m_traceRecorder, m_traceRecorder->addTrack(tr("Task %1").arg(m_tasks.size() + 1)));
+
+    m_tasks.push_back(std::make_unique<TaskData>(TaskData{thread, widget, static_cast<int>(m_activeTasks.size())}));
+    auto task = m_tasks.back().get();
+    task->m_factory = std::move(factory);
+    task->m_index = static_cast<int>(m_tasks.size()) - 1;
+    task->m_resource = thread->resourceClass();
+    task->m_ownThread = ownThread;
+    m_activeTasks.push_back(task);
+    m_taskIndices[thread] = task->m_index;
+    ++m_tasksWithoutRange;
+
+    for (auto prerequisite : prerequisites)
+    {
+        // prerequisites added before the task can't form a cycle
+        auto it = m_taskIndices.find(prerequisite);
+        if (it == m_taskIndices.end() || m_tasks[static_cast<size_t>(it->second)].get() == task)
+        {
+            qWarning("AsyncProgressDialog: cannot depend on a task, which isn't added to the dialog before");
+            continue;
+        }
+
+        auto prerequisiteTask = m_tasks[static_cast<size_t>(it->second)].get();
+        task->m_prerequisites.push_back(it->second);
+        if (prerequisiteTask->m_activeIndex >= 0)
+        {
+            prerequisiteTask->m_dependents.push_back(task);
+            ++task->m_waitingFor;
+        }
+    }
+
+    if (!task->m_prerequisites.empty() && !m_hasDependencies)
+    {
+        m_hasDependencies = true;
+
+        // recreate the overall progress bar with the label of the remaining time
+        if (hasOverallProgress())
+        {
+            setOverallProgress(false);
+            setOverallProgress(true);
+        }
+    }
+
+    QObject::connect(thread, &TaskThread::stateChanged, this,
+            [this, task](TaskState state){
+                if (state == TaskState::Running)
+                    task->m_startTime = m_durationTimer.elapsed();
+                else if (state == TaskState::Finished)
+                    taskFinished(*task);
+            });
     QObject::connect(thread, &TaskThread::valueChanged, this,
-            [this, thread](int value){ updateProgressValue(thread, value); });
+            [this, task](qint64 value){ updateProgressValue(*task, value); });
+    QObject::connect(thread, &TaskThread::metricsChanged, this,
+            [this, task](qint64 value){ updateProgressValue(*task, value); });
     QObject::connect(thread, &TaskThread::rangeChanged, this,
-            [this, thread](int minimum, int maximum){ updateProgressRange(thread, minimum, maximum); });
+            [this, task](qint64 minimum, qint64 maximum){ updateProgressRange(*task, minimum, maximum); });
+    QObject::connect(thread, &TaskThread::updatesPending, this,
+            [this, task](){
+                if (task->m_flushPending)
+                    return;
+                task->m_flushPending = true;
+                m_pendingTasks.push_back(task);
+                scheduleRefresh();
+            });
+
+    if (m_viewMode == ListView)
+        addListRow(*task);
+    else if (m_widgetsDeferred || task->m_factory)
+    {
+        // the dialog owns the widget, but it's inserted to the layout when needed
+        if (widget)
+            widget->setParent(m_parent);
+        connectDeferredWidget(*task);
+    }
+    else
+    {
+        connectWidget(*task);
+        insertWidget(*task);
+    }
+
+    updateOverallProgress();
 
+    if (m_updateMode == TaskThread::Coalesced)
+        thread->setUpdateMode(TaskThread::Coalesced);
+
+    if (task->m_waitingFor == 0)
+        admitTask(*task);
+    if (!task->m_started)
+        showQueued(*task);
+}
+
+void AsyncProgressDialog::Impl::showQueued(TaskData& task)
+{
+    if (m_viewMode == ListView)
+        m_listModel->setState(task.m_row, TaskState::Queued);
+    else if (auto snapshot = task.m_snapshot.get())
+    {
+        snapshot->m_state = TaskState::Queued;
+        snapshot->m_hasState = true;
+    }
+    else
+        task.m_widget->setState(TaskState::Queued);
+}
+
+void AsyncProgressDialog::Impl::addListRow(TaskData& task)
+{
+    if (!m_listView)
+    {
+        m_listModel = new TaskListModel(this);
+        connect(m_listModel, &TaskListModel::changesPending, this, &Impl::scheduleRefresh);
+        m_listView = new QListView(m_parent);
+        m_listView->setModel(m_listModel);
+        m_listView->setItemDelegate(new TaskItemDelegate(m_listView));
+        // all rows have the same height, so the view never measures rows out of the viewport
+        m_listView->setUniformItemSizes(true);
+        m_listView->setSelectionMode(QAbstractItemView::NoSelection);
+        m_listView->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+        m_listView->setContextMenuPolicy(Qt::CustomContextMenu);
+        connect(m_listView, &QWidget::customContextMenuRequested, this, [this](const QPoint& pos){
+            auto row = m_listView->indexAt(pos).row();
+            auto it = std::find_if(m_tasks.begin(), m_tasks.end(),
+                                   [row](const std::unique_ptr<TaskData>& task) { return task->m_row == row; });
+            if (row >= 0 && it != m_tasks.end())
+                showTaskMenu(**it, m_listView->viewport()->mapToGlobal(pos));
+        });
+
+        auto boxLayout = qobject_cast<QVBoxLayout*>(m_parent->layout());
+        assert(boxLayout);
+        boxLayout->insertWidget(hasOverallProgress() ? 2 : 1, m_listView);
+    }
+
+    auto row = m_listModel->appendTask();
+    task.m_row = row;
+    auto model = m_listModel;
+    QObject::connect(task.m_thread, &TaskThread::valueChanged, model,
+            [model, row](qint64 value, const QVariant&, const TimeStamp& timeStamp){ model->setValue(row, value, timeStamp); });
+    QObject::connect(task.m_thread, &TaskThread::metricsChanged, model,
+            [model, row](qint64 value, const ProgressMetrics&, const TimeStamp& timeStamp){ model->setValue(row, value, timeStamp); });
+    QObject::connect(task.m_thread, &TaskThread::rangeChanged, model,
+            [model, row](qint64 minimum, qint64 maximum){ model->setRange(row, minimum, maximum); });
+    QObject::connect(task.m_thread, &TaskThread::textChanged, model,
+            [model, row](const QString& text){ model->setText(row, text); });
+    QObject::connect(task.m_thread, &TaskThread::textBatchChanged, model,
+            [model, row](const QStringList& texts){ if (!texts.isEmpty()) model->setText(row, texts.last()); });
+    QObject::connect(task.m_thread, &TaskThread::stateChanged, model,
+            [model, row](TaskState state){ model->setState(row, state); });
+}
+
+void AsyncProgressDialog::Impl::connectWidget(TaskData& task)
+{
+    auto thread = task.m_thread;
+    auto widget = task.m_widget;
     connect(thread, &TaskThread::valueChanged, widget, &ProgressWidget::setValue);
+    connect(thread, &TaskThread::metricsChanged, widget, &ProgressWidget::setMetrics);
     connect(thread, &TaskThread::rangeChanged, widget, &ProgressWidget::setRange);
     connect(thread, &TaskThread::textChanged, widget, &ProgressWidget::setText);
+    connect(thread, &TaskThread::textBatchChanged, widget, &ProgressWidget::setTextBatch);
+    connect(thread, &TaskThread::stateChanged, widget, &ProgressWidget::setState);
+}
 
-    // insert widget to the layout
-    widget->setParent(m_parent);
+void AsyncProgressDialog::Impl::connectDeferredWidget(TaskData& task)
+{
+    // The updates are stored in the snapshot until the widget is created and forwarded
+    // to the widget afterwards. A single connection for both keeps the updates queued
+    // before the widget is created in order.
+    task.m_snapshot = std::make_unique<TaskSnapshot>();
+    auto data = &task;
+
+    QObject::connect(task.m_thread, &TaskThread::valueChanged, this,
+            [this, data](qint64 value, const QVariant& userValue, const TimeStamp& timeStamp){
+                if (auto snapshot = data->m_snapshot.get())
+                {
+                    snapshot->m_userValue = userValue;
+                    snapshot->m_timeStamp = timeStamp;
+                    snapshot->m_hasValue = true;
+                    snapshot->m_hasMetrics = false;
+                    createWidgetIfNeeded(*data);
+                }
+                else
+                    data->m_widget->setValue(value, userValue, timeStamp);
+            });
+    QObject::connect(task.m_thread, &TaskThread::metricsChanged, this,
+            [this, data](qint64 value, const ProgressMetrics& metrics, const TimeStamp& timeStamp){
+                if (auto snapshot = data->m_snapshot.get())
+                {
+                    snapshot->m_metrics = metrics;
+                    snapshot->m_timeStamp = timeStamp;
+                    snapshot->m_hasValue = true;
+                    snapshot->m_hasMetrics = true;
+                    createWidgetIfNeeded(*data);
+                }
+                else
+                    data->m_widget->setMetrics(value, metrics, timeStamp);
+            });
+    QObject::connect(task.m_thread, &TaskThread::rangeChanged, this,
+            [this, data](qint64 minimum, qint64 maximum){
+                if (auto snapshot = data->m_snapshot.get())
+                {
+                    snapshot->m_hasRange = true;
+                    createWidgetIfNeeded(*data);
+                }
+                else
+                    data->m_widget->setRange(minimum, maximum);
+            });
+    QObject::connect(task.m_thread, &TaskThread::textChanged, this,
+            [this, data](const QString& text){
+                if (auto snapshot = data->m_snapshot.get())
+                {
+                    snapshot->m_text = text;
+                    createWidgetIfNeeded(*data);
+                }
+                else
+                    data->m_widget->setText(text);
+            });
+    QObject::connect(task.m_thread, &TaskThread::textBatchChanged, this,
+            [this, data](const QStringList& texts){
+                if (auto snapshot = data->m_snapshot.get())
+                {
+                    if (!texts.isEmpty())
+                        snapshot->m_text = texts.last();
+                    createWidgetIfNeeded(*data);
+                }
+                else
+                    data->m_widget->setTextBatch(texts);
+            });
+    QObject::connect(task.m_thread, &TaskThread::stateChanged, this,
+            [this, data](TaskState state){
+                if (auto snapshot = data->m_snapshot.get())
+                {
+                    snapshot->m_state = state;
+                    snapshot->m_hasState = true;
+                    createWidgetIfNeeded(*data);
+                }
+                else
+                    data->m_widget->setState(state);
+            });
+}
+
+void AsyncProgressDialog::Impl::insertWidget(TaskData& task)
+{
+    // the widgets follow the overall progress bar and the label in the order of the tasks,
+    // tasks without a widget in the layout are skipped
+    int position = 0;
+    for (auto it = m_tasks.begin(); it->get() != &task; ++it)
+        if ((*it)->m_widget && !(*it)->m_snapshot)
+            ++position;
+
+    task.m_widget->setParent(m_parent);
     auto boxLayout = qobject_cast<QVBoxLayout*>(m_parent->layout());
     assert(boxLayout);
-    boxLayout->insertWidget((hasOverallProgress() ? 2 : 1) + m_tasks.size(), widget);
+    boxLayout->insertWidget((hasOverallProgress() ? 1 : 0) + 1 + position, task.m_widget);
+}
+
+ProgressWidget* AsyncProgressDialog::Impl::ensureWidget(TaskData& task)
+{
+    // the widget of a hidden finished task would never be inserted nor updated again
+    if (!task.m_widget && task.m_factory && task.m_activeIndex < 0 && task.m_autoHide)
+        return nullptr;
+
+    if (!task.m_widget && m_viewMode == WidgetView)
+    {
+        task.m_widget = task.m_factory ? task.m_factory() : ProgressWidgetFactory::createProgressBar();
+        assert(task.m_widget);
+        task.m_widget->setParent(m_parent);
+    }
+    return task.m_widget;
+}
+
+bool AsyncProgressDialog::Impl::needsWidget(const TaskData& task) const
+{
+    // a widget given by the caller is shown right away, a factory is only called once
+    // the task has started or reported something, and never for a hidden finished task
+    if (!task.m_factory)
+        return true;
+    if (task.m_activeIndex < 0 && task.m_autoHide)
+        return false;
+
+    auto& snapshot = *task.m_snapshot;
+    return snapshot.m_hasValue || snapshot.m_hasRange || !snapshot.m_text.isEmpty()
+           || (snapshot.m_hasState && snapshot.m_state != TaskState::Queued);
+}
+
+void AsyncProgressDialog::Impl::createWidgetIfNeeded(TaskData& task)
+{
+    if (!m_widgetsDeferred && needsWidget(task))
+        createWidget(task);
+}
+
+void AsyncProgressDialog::Impl::createWidget(TaskData& task)
+{
+    TraceScope scope(m_traceRecorder.get(), "create widget");
+
+    auto snapshot = std::move(task.m_snapshot);
+    auto widget = ensureWidget(task);
+    if (snapshot->m_hasRange)
+        widget->setRange(task.m_range.first, task.m_range.second);
+    if (snapshot->m_hasValue)
+    {
+        if (snapshot->m_hasMetrics)
+            widget->setMetrics(task.m_value, snapshot->m_metrics, snapshot->m_timeStamp);
+        else
+            widget->setValue(task.m_value, snapshot->m_userValue, snapshot->m_timeStamp);
+    }
+    if (!snapshot->m_text.isEmpty())
+        widget->setText(snapshot->m_text);
+    if (snapshot->m_hasState)
+        widget->setState(snapshot->m_state);
+
+    insertWidget(task);
+    if (task.m_activeIndex < 0 && task.m_autoHide)
+        widget->hide();
+}
+
+void AsyncProgressDialog::Impl::destroyWidget(TaskData& task)
+{
+    // the range and the value stay in the task data, the snapshot takes any late updates
+    task.m_snapshot = std::make_unique<TaskSnapshot>();
+    task.m_snapshot->m_state = TaskState::Finished;
+    task.m_snapshot->m_hasState = true;
+
+    task.m_widget->hide();
+    task.m_widget->deleteLater();
+    task.m_widget = nullptr;
+}
+
+void AsyncProgressDialog::Impl::createWidgets()
+{
+    if (!m_widgetsDeferred)
+        return;
+
+    TraceScope scope(m_traceRecorder.get(), "create widgets");
+    m_widgetsDeferred = false;
+
+    for (auto& task : m_tasks)
+        if (task->m_snapshot && needsWidget(*task))
+            createWidget(*task);
+}
+
+bool AsyncProgressDialog::Impl::deferShow()
+{
+    if (!m_widgetsDeferred || m_showDeferred)
+        return m_showDeferred;
+
+    if (!m_durationTimer.isValid())
+        m_durationTimer.start();
+
+    auto remaining = m_minimumDuration - m_durationTimer.elapsed();
+    if (remaining <= 0 || (!m_tasks.empty() && allTasksFinished()))
+        return false;
+
+    m_showDeferred = true;
+    m_showTimer->start(static_cast<int>(remaining));
+    return true;
+}
+
+void AsyncProgressDialog::Impl::cancelDeferredShow()
+{
+    m_showDeferred = false;
+    m_showTimer->stop();
+}
+
+void AsyncProgressDialog::Impl::showDeferred()
+{
+    if (!m_showDeferred)
+        return;
+
+    cancelDeferredShow();
+    createWidgets();
+    m_parent->setVisible(true);
+}
+
+void AsyncProgressDialog::Impl::showIfPredictedLong()
+{
+    // the first progress values are too noisy to predict the duration, as in QProgressDialog
+    static constexpr qint64 minimumEstimateTime = 50;
+
+    auto elapsed = m_durationTimer.elapsed();
+    if (elapsed < minimumEstimateTime)
+        return;
+
+    if (m_hasDependencies && m_remainingTime >= 0)
+    {
+        if (elapsed + m_remainingTime >= m_minimumDuration)
+            showDeferred();
+        return;
+    }
+
+    if (m_tasksWithoutRange > 0 || m_progressSum <= 0)
+        return;
+
+    auto fraction = static_cast<double>(m_progressSum) / (s_progressUnit * static_cast<qint64>(m_tasks.size()));
+    if (elapsed / fraction >= m_minimumDuration)
+        showDeferred();
+}
 
-    m_tasks.push_back({thread, widget});
+void AsyncProgressDialog::Impl::admitTask(TaskData& task)
+{
+    // a task waiting for other tasks running at the same time mustn't wait for a slot
+    if (task.m_ownThread)
+    {
+        task.m_started = true;
+        task.m_thread->start();
+    }
+    // the queued tasks have no free slot, so only the new one may start right away
+    else if (hasFreeSlot(task))
+        runTask(task);
+    else
+        m_readyQueue.insert(&task);
+}
+
+bool AsyncProgressDialog::Impl::hasFreeSlot(const TaskData& task) const
+{
+    if (m_maximumConcurrency > 0 && m_runningTasks >= m_maximumConcurrency)
+        return false;
+    if (task.m_resource.isEmpty())
+        return true;
 
-    thread->start();
+    auto it = m_resourceSlots.constFind(task.m_resource);
+    return it == m_resourceSlots.cend() || it->m_limit <= 0 || it->m_running < it->m_limit;
 }
 
-void AsyncProgressDialog::Impl::taskFinished(TaskThread* thread)
+void AsyncProgressDialog::Impl::runTask(TaskData& task)
 {
-    if (auto task = findTask(thread); task && task->m_autoHide)
-        task->m_widget->hide();
+    task.m_started = true;
+    ++m_runningTasks;
+    if (!task.m_resource.isEmpty())
+        ++m_resourceSlots[task.m_resource].m_running;
+    startTask(task.m_thread);
+}
+
+void AsyncProgressDialog::Impl::startQueuedTasks()
+{
+    // a task held back by the limit of its resource class doesn't hold back the other classes
+    for (auto it = m_readyQueue.begin(); it != m_readyQueue.end(); )
+    {
+        if (m_maximumConcurrency > 0 && m_runningTasks >= m_maximumConcurrency)
+            break;
+
+        auto task = *it;
+        if (hasFreeSlot(*task))
+        {
+            it = m_readyQueue.erase(it);
+            runTask(*task);
+        }
+        else
+            ++it;
+    }
+}
+
+void AsyncProgressDialog::Impl::setTaskPriority(TaskData& task, int priority)
+{
+    // the position in the queue depends on the priority, the task is reinserted
+    bool queued = m_readyQueue.erase(&task) > 0;
+    task.m_priority = priority;
+    if (queued)
+        m_readyQueue.insert(&task);
+}
+
+bool AsyncProgressDialog::Impl::showTaskMenu(QWidget* widget, const QPoint& globalPos)
+{
+    for (; widget && widget != m_parent; widget = widget->parentWidget())
+        for (auto& task : m_tasks)
+            if (task->m_widget == widget)
+                return showTaskMenu(*task, globalPos);
+    return false;
+}
+
+bool AsyncProgressDialog::Impl::showTaskMenu(TaskData& task, const QPoint& globalPos)
+{
+    // only a task held back by the concurrency limits can be moved in the queue
+    if (m_readyQueue.count(&task) == 0)
+        return false;
+
+    QMenu menu(m_parent);
+    auto startNext = menu.addAction(tr("Start next"));
+    if (menu.exec(globalPos) != startNext || m_readyQueue.empty())
+        return true;
+
+    // the queue may have changed while the menu was open
+    auto first = *m_readyQueue.begin();
+    if (first != &task)
+        setTaskPriority(task, first->m_priority + 1);
+    return true;
+}
+
+void AsyncProgressDialog::Impl::startTask(TaskThread* thread)
+{
+    if (auto coroutineThread = qobject_cast<CoroutineTaskThread*>(thread))
+        coroutineThread->start(CoroutineReactor::globalInstance());
+    else if (m_taskPool)
+        m_taskPool->start(thread);
+    else
+        thread->start();
+}
+
+void AsyncProgressDialog::Impl::taskFinished(TaskData& task)
+{
+    if (task.m_activeIndex < 0)
+        return;
+
+    TraceScope scope(m_traceRecorder.get(), "task finished");
+
+    // deliver the last coalesced value
+    task.m_thread->flushUpdates();
+
+    // swap-remove the task from the active tasks
+    auto last = m_activeTasks.back();
+    m_activeTasks[task.m_activeIndex] = last;
+    last->m_activeIndex = task.m_activeIndex;
+    m_activeTasks.pop_back();
+    task.m_activeIndex = -1;
+    task.m_finishTime = m_durationTimer.elapsed();
+
+    if (task.m_started && !task.m_ownThread)
+    {
+        --m_runningTasks;
+        if (!task.m_resource.isEmpty())
+            --m_resourceSlots[task.m_resource].m_running;
+    }
+
+    // the dependents of a canceled task start as well, they see the cancellation and finish
+    for (auto dependent : task.m_dependents)
+        if (--dependent->m_waitingFor == 0)
+            m_readyQueue.insert(dependent);
+    startQueuedTasks();
+
+    if (m_hasDependencies)
+        updateCriticalPath();
+
+    // a widget not created yet is hidden when created, one created by a factory is destroyed
+    if (task.m_autoHide && !task.m_snapshot)
+    {
+        if (task.m_factory)
+            destroyWidget(task);
+        else if (task.m_widget)
+            task.m_widget->hide();
+        else
+            m_listView->setRowHidden(task.m_row, true);
+    }
 
     if (allTasksFinished())
     {
+        if (m_listModel)
+            m_listModel->flushChanges();
+        m_refreshTimer->stop();
         if (m_autoClose)
             closeDialog();
         else
+        {
             m_buttonBox->setStandardButtons(QDialogButtonBox::Close);
+            showDeferred();
+        }
     }
 }
 
 bool AsyncProgressDialog::Impl::allTasksFinished() const
 {
-    return std::all_of(m_tasks.begin(), m_tasks.end(),
-                       [](const auto& task) { return task.m_thread->isFinished(); });
+    return m_activeTasks.empty();
+}
+
+void AsyncProgressDialog::Impl::setGuiCoreReserved(bool reserved)
+{
+    if (!reserved)
+    {
+        m_guiScheduling.restore();
+        m_guiCore = -1;
+        m_taskCpus.clear();
+        return;
+    }
+
+    // reserve the core the GUI thread runs on now, so it doesn't have to migrate
+    auto cpus = ThreadScheduling::availableCpus();
+    auto core = ThreadScheduling::currentCpu();
+    if (cpus.size() < 2 || !cpus.contains(core))
+        return;
+
+    cpus.removeAll(core);
+    m_guiScheduling.setCpuAffinity({ core });
+    m_guiCore = core;
+    m_taskCpus = cpus;
 }
 
 void AsyncProgressDialog::Impl::cancelAllTasks()
 {
     m_wasCanceled = true;
-    for (auto& task : m_tasks)
-        task.m_thread->cancel();
+    for (auto task : m_activeTasks)
+        task->m_thread->cancel();
 
     auto button = m_buttonBox->button(QDialogButtonBox::Cancel);
     assert(button);
@@ -130,6 +859,30 @@ void AsyncProgressDialog::Impl::cancelAllTasks()
     button->setEnabled(false);
 }
 
+void AsyncProgressDialog::Impl::refresh()
+{
+    TraceScope scope(m_traceRecorder.get(), "refresh");
+
+    // tasks announce the updates again as soon as they are flushed
+    auto tasks = std::move(m_pendingTasks);
+    m_pendingTasks.clear();
+    for (auto task : tasks)
+    {
+        task->m_flushPending = false;
+        task->m_thread->flushUpdates();
+    }
+
+    // repaint the rows changed since the last refresh at once
+    if (m_listModel)
+        m_listModel->flushChanges();
+}
+
+void AsyncProgressDialog::Impl::scheduleRefresh()
+{
+    if (!m_refreshTimer->isActive())
+        m_refreshTimer->start();
+}
+
 void AsyncProgressDialog::Impl::closeDialog()
 {
     assert(allTasksFinished());
@@ -140,66 +893,182 @@ void AsyncProgressDialog::Impl::setOverallProgress(bool enabled)
 {
     if (enabled)
     {
-        m_overallProgressBar = ProgressWidgetFactory::createProgressBar(tr("Total progress"));
+        // the label shows the remaining time predicted by the critical path
+        m_overallProgressBar = ProgressWidgetFactory::createProgressBar(tr("Total progress"),
+                m_hasDependencies ? AdditionalWidget::Label : AdditionalWidget::NoWidget);
         m_overallProgressBar->setParent(m_parent);
 
         auto boxLayout = qobject_cast<QVBoxLayout*>(m_parent->layout());
         assert(boxLayout);
         boxLayout->insertWidget(0, m_overallProgressBar);
+
+        m_overallValue = -1;
+        if (m_hasDependencies)
+            updateCriticalPath();
+        else
+            updateOverallProgress();
     }
     else
     {
         m_parent->layout()->removeWidget(m_overallProgressBar);
         delete m_overallProgressBar;
+        m_overallProgressBar = nullptr;
     }
 }
 
-void AsyncProgressDialog::Impl::updateProgressValue(TaskThread* thread, int value)
+void AsyncProgressDialog::Impl::updateProgressValue(TaskData& task, qint64 value)
+{
+    TraceScope scope(m_traceRecorder.get(), "progress value");
+    task.m_value = value;
+    updateTaskProgress(task);
+}
+
+void AsyncProgressDialog::Impl::updateProgressRange(TaskData& task, qint64 minimum, qint64 maximum)
+{
+    TraceScope scope(m_traceRecorder.get(), "progress range");
+    task.m_range = { minimum, maximum };
+    updateTaskProgress(task);
+}
+
+void AsyncProgressDialog::Impl::updateTaskProgress(TaskData& task)
 {
-    if (auto task = findTask(thread))
+    auto denom = task.m_range.second - task.m_range.first;
+    bool hasRange = denom != 0;
+    if (hasRange != task.m_hasRange)
     {
-        task->m_value = value;
-        updateOverallProgress();
+        m_tasksWithoutRange += hasRange ? -1 : 1;
+        task.m_hasRange = hasRange;
     }
+
+    // the fraction is computed in floating point as 64-bit ranges may overflow the fixed point scale
+    qint64 progress = 0;
+    if (hasRange)
+        progress = static_cast<qint64>(s_progressUnit * (static_cast<double>(task.m_value - task.m_range.first) / denom));
+
+    m_progressSum += progress - task.m_progress;
+    task.m_progress = progress;
+
+    updateOverallProgress();
+
+    if (m_showDeferred)
+        showIfPredictedLong();
 }
 
-void AsyncProgressDialog::Impl::updateProgressRange(TaskThread* thread, int minimum, int maximum)
+void AsyncProgressDialog::Impl::updateOverallProgress()
 {
-    if (auto task = findTask(thread))
+    if (!hasOverallProgress() || m_tasks.empty())
+        return;
+
+    // the critical path costs O(tasks + dependencies), so it's recomputed at most every 100 ms
+    if (m_hasDependencies)
     {
-        task->m_range = { minimum, maximum };
-        updateOverallProgress();
+        if (!m_criticalPathTimer->isActive())
+            m_criticalPathTimer->start();
+        return;
     }
+
+    setOverallValue(flatOverallValue());
 }
 
-void AsyncProgressDialog::Impl::updateOverallProgress()
+qint64 AsyncProgressDialog::Impl::flatOverallValue() const
+{
+    // Can't show overall progress if one of the tasks can't report progress, that is marked by -2
+    return m_tasksWithoutRange > 0 ? -2 : (100 * m_progressSum) / (s_progressUnit * static_cast<qint64>(m_tasks.size()));
+}
+
+void AsyncProgressDialog::Impl::updateCriticalPath()
 {
-    if (!hasOverallProgress())
+    m_criticalPathTimer->stop();
+    m_remainingTime = criticalPathLength();
+    if (!hasOverallProgress() || m_tasks.empty())
         return;
 
-    int sumPercent = 0;
-    for (auto& task : m_tasks)
+    // the progress is the part of the time elapsed out of the time predicted by the critical path
+    if (m_remainingTime < 0)
+    {
+        setOverallValue(flatOverallValue());
+        m_overallProgressBar->setText(QString());
+        return;
+    }
+
+    auto elapsed = m_durationTimer.elapsed();
+    setOverallValue(elapsed + m_remainingTime > 0 ? 100 * elapsed / (elapsed + m_remainingTime) : 100);
+    m_overallProgressBar->setText(m_activeTasks.empty() ? QString()
+            : DurationFormatter(std::chrono::milliseconds(m_remainingTime)).approximate());
+}
+
+qint64 AsyncProgressDialog::Impl::criticalPathLength() const
+{
+    auto now = m_durationTimer.elapsed();
+
+    // a task without an estimate is expected to take as long as the estimated tasks on average
+    double durationSum = 0;
+    int durationCount = 0;
+    for (const auto& task : m_tasks)
     {
-        int denom = task.m_range.second - task.m_range.first;
-        if (denom == 0)
+        auto duration = estimatedDuration(*task, now);
+        if (duration >= 0)
         {
-            // Can't show overall progress as one of the tasks can't report progress
-            m_overallProgressBar->setRange(0, 0);
-            return;
+            durationSum += duration;
+            ++durationCount;
+        }
+    }
+
+    if (durationCount == 0)
+        return m_activeTasks.empty() ? 0 : -1;
+    auto typicalDuration = durationSum / durationCount;
+
+    // the tasks are added after their prerequisites, so the order of addition is topological
+    std::vector<double> pathEnd(m_tasks.size());
+    double longest = 0;
+    for (size_t i = 0; i < m_tasks.size(); ++i)
+    {
+        const auto& task = *m_tasks[i];
+        double start = 0;
+        for (auto prerequisite : task.m_prerequisites)
+            start = std::max(start, pathEnd[static_cast<size_t>(prerequisite)]);
+
+        double remaining = 0;
+        if (task.m_activeIndex >= 0)
+        {
+            auto elapsed = task.m_startTime >= 0 ? now - task.m_startTime : 0;
+            auto duration = estimatedDuration(task, now);
+            remaining = std::max(0.0, (duration >= 0 ? duration : typicalDuration) - elapsed);
         }
-        int numer = task.m_value - task.m_range.first;
-        sumPercent += (100 * numer) / denom;
+
+        pathEnd[i] = start + remaining;
+        longest = std::max(longest, pathEnd[i]);
     }
 
-    m_overallProgressBar->setRange(0, 100);
-    m_overallProgressBar->setValue(sumPercent / m_tasks.size(), QVariant(), TimeStamp());
+    return static_cast<qint64>(longest);
 }
 
-AsyncProgressDialog::Impl::TaskData* AsyncProgressDialog::Impl::findTask(TaskThread* thread)
+// the duration of a finished task, or the one predicted by the progress of a running task,
+// -1 if unknown
+qint64 AsyncProgressDialog::Impl::estimatedDuration(const TaskData& task, qint64 now) const
 {
-    auto ptr = std::find_if(m_tasks.begin(), m_tasks.end(),
-                            [thread](const auto& task){ return task.m_thread == thread; });
-    return ptr != m_tasks.end() ? &*ptr : nullptr;
+    if (task.m_startTime < 0)
+        return -1;
+    if (task.m_activeIndex < 0)
+        return task.m_finishTime - task.m_startTime;
+    if (!task.m_hasRange || task.m_progress <= 0)
+        return -1;
+    return static_cast<qint64>(static_cast<double>(now - task.m_startTime) * s_progressUnit / task.m_progress);
+}
+
+void AsyncProgressDialog::Impl::setOverallValue(qint64 value)
+{
+    if (value == m_overallValue)
+        return;
+
+    if (value < 0)
+        m_overallProgressBar->setRange(0, 0);
+    else
+    {
+        m_overallProgressBar->setRange(0, 100);
+        m_overallProgressBar->setValue(value, QVariant(), TimeStamp());
+    }
+    m_overallValue = value;
 }
 
 
@@ -213,6 +1082,29 @@ AsyncProgressDialog::Impl::TaskData* AsyncProgressDialog::Impl::findTask(TaskThr
     then shows progress as reported by the thread. If more than one tasks are added, a progress
     bar indicating overall progress can be shown (see setOverallProgress())
 
+    Each task gets its own progress widget by default. Dialogs with thousands of tasks should
+    use the ListView mode (see setViewMode()), which paints a row with a progress bar, the last
+    text and the remaining time estimate for the visible tasks only.
+
+    By default, each task runs in its own thread. Dialogs with many tasks can execute them
+    on a bounded TaskPool instead (see setTaskPool()).
+
+    Dialogs of tasks, which often finish in a fraction of a second, can set a minimum
+    duration (see setMinimumDuration()). The dialog and the progress widgets are then
+    created and shown only if the tasks run longer. Tasks can also be added with
+    a factory of their widget instead of the widget itself, which is then created
+    only once the task starts.
+
+    The number of tasks running at once can be limited for the whole dialog (see
+    setMaximumConcurrency()) and for a class of resource the tasks use, e.g. the disk
+    (see setResourceLimit()). Tasks beyond the limits wait in the TaskState::Queued state
+    and start in the order of their priority (see setTaskPriority()) as running tasks finish.
+
+    A task can be added with prerequisites, tasks of the dialog it depends on. The task is
+    then started as soon as all its prerequisites finish, so independent steps of a job run
+    in parallel. The dialog with dependencies computes the overall progress and the remaining
+    time (see remainingTime()) along the critical path of the task graph.
+
     There are two addTask() methods, which accept a function instead of a task thread object.
     They can be conveniently combined with lambda expressions, which avoids construction of
     a thread object on the caller side. The return value of the lambda expression can be safely
@@ -226,7 +1118,15 @@ AsyncProgressDialog::Impl::TaskData* AsyncProgressDialog::Impl::findTask(TaskThr
     is scheduled to be deleted as soon as the thread finishes. Life time of thread object with
     different parent is not managed by this dialog.
 
-    \sa TaskThread, ProgressWidget
+    \enum AsyncProgressDialog::ViewMode
+    Specifies how the tasks are displayed.
+
+    \var AsyncProgressDialog::ViewMode AsyncProgressDialog::WidgetView
+    Each task is displayed by its own progress widget.
+    \var AsyncProgressDialog::ViewMode AsyncProgressDialog::ListView
+    The tasks are displayed as rows of a list view, only the visible rows are painted.
+
+    \sa TaskThread, ProgressWidget, TaskPool
 */
 
 
@@ -243,13 +1143,24 @@ AsyncProgressDialog::AsyncProgressDialog(QWidget *parent, Qt::WindowFlags flags)
 
 AsyncProgressDialog::~AsyncProgressDialog()
 {
+    m_impl->setGuiCoreReserved(false);
+
     // Check that threads owned by this class has finished.
     // If not, the thread parent must be reset and the thread object deleted later
+    // A task waiting for its prerequisites or for a free slot never starts, it's deleted
+    // as a child of the dialog.
     for (auto& task : m_impl->m_tasks)
-        if (task.m_thread->parent() == this && !task.m_thread->isFinished())
+        if (task->m_thread->parent() == this && task->m_thread->state() != TaskState::Finished
+                && task->m_started)
         {
-            task.m_thread->setParent(nullptr);
-            connect(task.m_thread, &QThread::finished, task.m_thread, &QObject::deleteLater);
+            auto thread = task->m_thread;
+            thread->setParent(nullptr);
+            connect(thread, &TaskThread::stateChanged, thread,
+                    [thread](TaskState state){ if (state == TaskState::Finished) thread->deleteLater(); });
+
+            // the task might have finished before the connection was made
+            if (thread->state() == TaskState::Finished)
+                thread->deleteLater();
         }
 }
 
@@ -257,7 +1168,10 @@ AsyncProgressDialog::~AsyncProgressDialog()
     Add a task \a thread object and the associated progress \a widget.
     The widget displays the progress as reported by the thread.
 
-    The ownership of \a widget is transferred to the dialog.
+    The ownership of \a widget is transferred to the dialog. If \a widget is nullptr,
+    a default progress bar is created. In the ListView mode, the progress is painted
+    by the list view and \a widget must be nullptr. A widget passed in this mode is ignored
+    with a warning and its ownership stays with the caller.
 
     The ownership of\a thread is not transferred. If the parent of the \a thread
     object is this dialog, the thread object is either deleted in destructor if finished,
@@ -269,6 +1183,78 @@ void AsyncProgressDialog::addTask(TaskThread* thread, ProgressWidget* widget)
     m_impl->addTask(thread, widget);
 }
 
+/*!
+    Add a task \a thread object, whose progress widget is created by \a factory
+    when the task needs it, rather than by the caller right away.
+
+    The factory is called once the task starts running or reports its range, value or
+    text, so tasks waiting in a TaskPool hold no widget. Until then, the dialog keeps
+    only the latest state reported by the task and passes it to the widget when it's
+    created. If the widget is set to be hidden automatically (see setAutoHideWidget()),
+    it's destroyed when the task finishes and the dialog keeps just the final range and
+    value of the task, so the number of widgets follows the number of running tasks.
+    A task which finishes before it has got a widget, and is hidden automatically,
+    never gets one.
+
+    The \a factory is ignored in the ListView mode. The ownership of \a thread is
+    the same as in addTask(TaskThread*, ProgressWidget*).
+
+    \sa widgetAt(), ProgressWidgetFactory
+*/
+void AsyncProgressDialog::addTask(TaskThread* thread, WidgetFactory factory)
+{
+    assert(factory);
+    m_impl->addTask(thread, nullptr, std::move(factory));
+}
+
+/*!
+    Add a task \a thread object, which starts as soon as all its \a prerequisites finish,
+    and the associated progress \a widget. Until then, the widget shows the task as waiting.
+
+    The prerequisites must be tasks added to the dialog before, so the tasks can't depend
+    on each other in a cycle. A prerequisite, which has already finished, is satisfied.
+    When the dialog is canceled, the waiting tasks are canceled too, but they still start
+    after their prerequisites and should return as soon as they see TaskThread::isCanceled().
+
+    A task waiting for its prerequisites, when the dialog is destroyed, is never started.
+    The ownership of \a thread and \a widget is the same as in addTask(TaskThread*, ProgressWidget*).
+
+    \sa remainingTime()
+*/
+void AsyncProgressDialog::addTask(TaskThread* thread, const QVector<TaskThread*>& prerequisites, ProgressWidget* widget)
+{
+    m_impl->addTask(thread, widget, WidgetFactory(), prerequisites);
+}
+
+// a stage of a Pipeline runs as long as the other stages do, so it's started in its
+// own thread right away rather than by the task pool or after the concurrency limits
+void AsyncProgressDialog::addPipelineStage(TaskThread* thread, ProgressWidget* widget)
+{
+    m_impl->addTask(thread, widget, WidgetFactory(), QVector<TaskThread*>(), true);
+}
+
+/*!
+    Reimplemented from QDialog::setVisible().
+
+    If a minimum duration is set, showing the dialog is postponed until the tasks
+    have run for the minimum duration or their progress predicts they will.
+
+    \sa setMinimumDuration()
+*/
+void AsyncProgressDialog::setVisible(bool visible)
+{
+    if (visible)
+    {
+        if (m_impl->deferShow())
+            return;
+        m_impl->createWidgets();
+    }
+    else
+        m_impl->cancelDeferredShow();
+
+    QDialog::setVisible(visible);
+}
+
 /*!
   Reimplemented from QDialog::reject()
 */
@@ -280,6 +1266,19 @@ void AsyncProgressDialog::reject()
         m_impl->cancelAllTasks();
 }
 
+/*!
+    Reimplemented from QWidget::contextMenuEvent(). Shows the menu of a task waiting for
+    a free slot, if the \a event is over its progress widget.
+
+    \sa setTaskPriority()
+*/
+void AsyncProgressDialog::contextMenuEvent(QContextMenuEvent* event)
+{
+    // the progress widgets ignore the event, so it propagates to the dialog
+    if (!m_impl->showTaskMenu(childAt(event->pos()), event->globalPos()))
+        QDialog::contextMenuEvent(event);
+}
+
 /*!
     Set a flag whether the dialog gets hidden
     after all threads has finished.
@@ -304,6 +1303,22 @@ bool AsyncProgressDialog::autoClose() const
     return m_impl->m_autoClose;
 }
 
+/*!
+    Returns the time in milliseconds, which the tasks are predicted to need until all
+    of them finish, or -1 if it can't be predicted yet.
+
+    The prediction follows the critical path, the longest chain of dependent tasks. The
+    duration of a running task is predicted by its progress, the one of a task, which hasn't
+    started yet or hasn't reported its progress, by the average duration of the other tasks.
+    The overall progress bar shows the remaining time, if the tasks have any dependencies.
+
+    \sa addTask(TaskThread*, const QVector<TaskThread*>&, ProgressWidget*), setOverallProgress()
+*/
+qint64 AsyncProgressDialog::remainingTime() const
+{
+    return m_impl->criticalPathLength();
+}
+
 /*!
     Set a flag whether the dialog shows total progress
     of all tasks.
@@ -355,6 +1370,380 @@ QString AsyncProgressDialog::labelText() const
     return m_impl->m_label->text();
 }
 
+/*!
+    Sets the view \a mode, i.e. how the tasks are displayed. The mode must be set
+    before the first task is added.
+
+    In the WidgetView mode, each task is displayed by its progress widget inserted
+    into the dialog's layout. In the ListView mode, the tasks are rows of a list view
+    backed by a model, which keeps a few values per task. Only the visible rows are
+    painted and no widgets are created per task, so the mode scales to tens of thousands
+    of tasks. The rows are repainted at most once per refresh interval.
+
+    \sa viewMode(), setRefreshInterval()
+*/
+void AsyncProgressDialog::setViewMode(ViewMode mode)
+{
+    assert(m_impl->m_tasks.empty());
+    m_impl->m_viewMode = mode;
+}
+
+/*!
+    Returns the view mode.
+
+    The default is WidgetView.
+
+    \sa setViewMode()
+*/
+AsyncProgressDialog::ViewMode AsyncProgressDialog::viewMode() const
+{
+    return m_impl->m_viewMode;
+}
+
+/*!
+    Sets the update \a mode of tasks added to the dialog afterwards.
+
+    If the mode is TaskThread::Coalesced, the tasks store their progress values
+    in a lock-free slot and the dialog picks up the newest value once per refresh
+    interval. This is useful for tasks, which report progress very often, because
+    the GUI thread then processes at most one update per task and refresh no matter
+    how often the task calls TaskThread::setValue(). Tasks with the coalesced mode
+    set explicitly keep it regardless of this setting.
+
+    \sa updateMode(), setRefreshInterval(), TaskThread::setUpdateMode()
+*/
+void AsyncProgressDialog::setUpdateMode(TaskThread::UpdateMode mode)
+{
+    m_impl->m_updateMode = mode;
+}
+
+/*!
+    Returns the update mode of tasks added to the dialog.
+
+    The default is TaskThread::Immediate.
+
+    \sa setUpdateMode()
+*/
+TaskThread::UpdateMode AsyncProgressDialog::updateMode() const
+{
+    return m_impl->m_updateMode;
+}
+
+/*!
+    Sets the interval in milliseconds, in which the dialog delivers
+    progress values of tasks in TaskThread::Coalesced mode and progress
+    counted by TaskThread::advance(). The dialog only refreshes after some task
+    has announced pending updates by TaskThread::updatesPending(), i.e. there are
+    no wakeups while the tasks report nothing.
+
+    \sa refreshInterval(), setUpdateMode()
+*/
+void AsyncProgressDialog::setRefreshInterval(int msec)
+{
+    m_impl->m_refreshTimer->setInterval(msec);
+}
+
+/*!
+    Returns the interval in milliseconds, in which the dialog delivers
+    progress values of tasks in TaskThread::Coalesced mode and progress
+    counted by TaskThread::advance().
+
+    The default is 33 milliseconds, i.e. about 30 refreshes per second.
+
+    \sa setRefreshInterval()
+*/
+int AsyncProgressDialog::refreshInterval() const
+{
+    return m_impl->m_refreshTimer->interval();
+}
+
+/*!
+    Sets the minimum interval between two frames rendering progress widgets
+    to \a msec milliseconds.
+
+    Progress widgets in the dialog only store the data reported by the tasks and
+    render them once per frame, so the time spent painting is bounded by the frame
+    rate rather than by the number of updates. The frames are only rendered while
+    some widget has changed, an idle dialog doesn't wake up.
+
+    \sa frameInterval(), ProgressWidget::requestRender()
+*/
+void AsyncProgressDialog::setFrameInterval(int msec)
+{
+    m_impl->m_renderClock->setInterval(msec);
+}
+
+/*!
+    Returns the minimum interval between two frames rendering progress widgets
+    in milliseconds.
+
+    The default is 33 milliseconds, i.e. at most about 30 frames per second.
+
+    \sa setFrameInterval()
+*/
+int AsyncProgressDialog::frameInterval() const
+{
+    return m_impl->m_renderClock->interval();
+}
+
+/*!
+    Sets the minimum duration of the tasks in milliseconds, for which the dialog
+    is worth showing, to \a msec. The duration must be set before the first task
+    is added.
+
+    Similarly to QProgressDialog, the dialog isn't shown by show() or exec() right
+    away, but only after the tasks have run for \a msec milliseconds since the first
+    task was added, or as soon as their overall progress predicts they will take
+    at least that long. If all tasks finish sooner and autoClose() is set, the dialog
+    is never shown and exec() returns without any flash of the dialog. Note that
+    exec() doesn't block input to other windows until the dialog is shown.
+
+    The progress widgets of the tasks are not created or laid out until the dialog
+    is shown. Until then, the dialog keeps only the latest range, value, text and state
+    reported by each task and passes them to the widget when it's created, so
+    widgets displaying the history of texts, like ProgressOutput, only display the
+    last text reported before the dialog was shown.
+
+    If \a msec is 0, the dialog and the widgets are shown immediately.
+
+    \sa minimumDuration(), widgetAt()
+*/
+void AsyncProgressDialog::setMinimumDuration(int msec)
+{
+    assert(m_impl->m_tasks.empty());
+    m_impl->m_minimumDuration = msec;
+    m_impl->m_widgetsDeferred = msec > 0;
+}
+
+/*!
+    Returns the minimum duration of the tasks in milliseconds, for which the dialog
+    is shown.
+
+    The default is 0, i.e. the dialog is shown immediately.
+
+    \sa setMinimumDuration()
+*/
+int AsyncProgressDialog::minimumDuration() const
+{
+    return m_impl->m_minimumDuration;
+}
+
+RenderClock* AsyncProgressDialog::renderClock() const
+{
+    return m_impl->m_renderClock;
+}
+
+/*!
+    Sets the task \a pool, which executes tasks added to the dialog afterwards.
+    If the pool is nullptr, each task is executed in its own thread started by
+    QThread::start().
+
+    Sharing TaskPool::globalInstance() among dialogs bounds the number of threads
+    running tasks in the whole process. Tasks waiting for a free thread are in the
+    TaskState::Queued state, which progress widgets display as waiting.
+
+    The stages of a Pipeline are not executed by the pool, they run at the same time
+    in their own threads. The ownership of \a pool is not transferred.
+
+    \sa taskPool(), TaskPool
+*/
+void AsyncProgressDialog::setTaskPool(TaskPool* pool)
+{
+    m_impl->m_taskPool = pool;
+}
+
+/*!
+    Returns the task pool, which executes tasks added to the dialog.
+
+    The default is nullptr, i.e. each task is executed in its own thread.
+
+    \sa setTaskPool()
+*/
+TaskPool* AsyncProgressDialog::taskPool() const
+{
+    return m_impl->m_taskPool;
+}
+
+/*!
+    Reserves a CPU core for the GUI thread if \a reserved is true, so rendering
+    the progress stays responsive while the tasks load all other cores.
+
+    The GUI thread is restricted to the core it currently runs on and the tasks
+    added to the dialog afterwards are restricted to the other cores, including
+    tasks bound to a NUMA node (see TaskThread::setNumaNode()). A task restricted
+    to the reserved core alone by TaskThread::setCpuAffinity() keeps running there.
+    The affinity of the GUI thread is restored when the reservation is released by
+    \a reserved set to false or when the dialog is destroyed.
+
+    The reservation is only made on Linux and if the process may run on at least
+    two cores.
+
+    \sa isGuiCoreReserved(), TaskThread::setCpuAffinity()
+*/
+void AsyncProgressDialog::setGuiCoreReserved(bool reserved)
+{
+    if (reserved != isGuiCoreReserved())
+        m_impl->setGuiCoreReserved(reserved);
+}
+
+/*!
+    Returns true if a CPU core is reserved for the GUI thread.
+
+    The default is false.
+
+    \sa setGuiCoreReserved()
+*/
+bool AsyncProgressDialog::isGuiCoreReserved() const
+{
+    return m_impl->m_guiCore >= 0;
+}
+
+/*!
+    Limits the number of tasks of the dialog running at once to \a count, or removes
+    the limit if \a count is 0. The tasks added beyond the limit wait in the TaskState::Queued
+    state and start in the order of their priority as the running tasks finish. Raising
+    the limit starts the waiting tasks right away.
+
+    Unlike a TaskPool, the limit holds back the tasks before they are started, so it applies
+    to coroutine tasks and to tasks executed by a pool as well. The stages of a Pipeline,
+    which wait for each other, are neither limited nor counted.
+
+    \sa maximumConcurrency(), setResourceLimit(), setTaskPriority()
+*/
+void AsyncProgressDialog::setMaximumConcurrency(int count)
+{
+    m_impl->m_maximumConcurrency = std::max(0, count);
+    m_impl->startQueuedTasks();
+}
+
+/*!
+    Returns the maximum number of tasks running at once.
+
+    The default is 0, i.e. no limit.
+
+    \sa setMaximumConcurrency()
+*/
+int AsyncProgressDialog::maximumConcurrency() const
+{
+    return m_impl->m_maximumConcurrency;
+}
+
+/*!
+    Limits the number of running tasks of the \a resource class, e.g. "disk" or "cpu",
+    to \a count, or removes the limit if \a count is 0. The class of a task is set by
+    TaskThread::setResourceClass(). A task of the class waits while the limit is reached,
+    but it doesn't hold back tasks of other classes. The limit applies together with
+    maximumConcurrency().
+
+    \sa resourceLimit(), setMaximumConcurrency()
+*/
+void AsyncProgressDialog::setResourceLimit(const QString& resource, int count)
+{
+    m_impl->m_resourceSlots[resource].m_limit = std::max(0, count);
+    m_impl->startQueuedTasks();
+}
+
+/*!
+    Returns the maximum number of running tasks of the \a resource class.
+
+    The default is 0, i.e. no limit.
+
+    \sa setResourceLimit()
+*/
+int AsyncProgressDialog::resourceLimit(const QString& resource) const
+{
+    return m_impl->m_resourceSlots.value(resource).m_limit;
+}
+
+/*!
+    Sets the \a priority of the task \a thread. When a running task finishes, the waiting
+    task of the highest priority starts first, tasks of the same priority start in the order
+    of addition. The priority of a waiting task can be changed at any time, the tasks are
+    added with the priority 0.
+
+    The user can move a waiting task to the front of the queue by "Start next" in the context
+    menu of its widget or row.
+
+    \sa taskPriority(), setMaximumConcurrency()
+*/
+void AsyncProgressDialog::setTaskPriority(TaskThread* thread, int priority)
+{
+    auto it = m_impl->m_taskIndices.find(thread);
+    if (it == m_impl->m_taskIndices.end())
+    {
+        qWarning("AsyncProgressDialog: cannot set the priority of a task, which isn't added to the dialog");
+        return;
+    }
+    m_impl->setTaskPriority(*m_impl->m_tasks[static_cast<size_t>(it->second)], priority);
+}
+
+/*!
+    Returns the priority of the task \a thread, or 0 if the task isn't added to the dialog.
+
+    \sa setTaskPriority()
+*/
+int AsyncProgressDialog::taskPriority(TaskThread* thread) const
+{
+    auto it = m_impl->m_taskIndices.find(thread);
+    return it == m_impl->m_taskIndices.end() ? 0 : m_impl->m_tasks[static_cast<size_t>(it->second)]->m_priority;
+}
+
+/*!
+    Enables or disables recording of a timeline of tasks added to the dialog afterwards.
+
+    When \a enabled, the dialog creates a TraceRecorder, which records the start and finish
+    of each task, its range, values and texts, cancel requests and the time spent in the slots
+    and frames of the dialog in the GUI thread. Each task gets its own track named after its
+    order in the dialog. The recorded trace can be saved by exportTrace() and opened in
+    Perfetto or chrome://tracing.
+
+    Disabling the tracing doesn't stop the recording of tasks already added, it only
+    detaches the recorder from the dialog.
+
+    \sa isTracingEnabled(), traceRecorder(), exportTrace()
+*/
+void AsyncProgressDialog::setTracingEnabled(bool enabled)
+{
+    if (enabled == isTracingEnabled())
+        return;
+
+    m_impl->m_traceRecorder = enabled ? std::make_shared<TraceRecorder>() : nullptr;
+    m_impl->m_renderClock->setTraceRecorder(m_impl->m_traceRecorder.get());
+}
+
+/*!
+    Returns true if the dialog records a timeline of its tasks.
+
+    The default is false, in which case tracing costs a single branch per update.
+
+    \sa setTracingEnabled()
+*/
+bool AsyncProgressDialog::isTracingEnabled() const
+{
+    return m_impl->m_traceRecorder != nullptr;
+}
+
+/*!
+    Returns the recorder of the timeline, or nullptr if the tracing is disabled.
+
+    \sa setTracingEnabled()
+*/
+TraceRecorder* AsyncProgressDialog::traceRecorder() const
+{
+    return m_impl->m_traceRecorder.get();
+}
+
+/*!
+    Writes the timeline recorded so far to the file \a fileName as Chrome Trace Event JSON.
+    Returns false if the tracing is disabled or the file can't be written.
+
+    \sa setTracingEnabled(), TraceRecorder::exportChromeTrace()
+*/
+bool AsyncProgressDialog::exportTrace(const QString& fileName) const
+{
+    return m_impl->m_traceRecorder && m_impl->m_traceRecorder->exportChromeTrace(fileName);
+}
+
 /*!
     Returns number of threads in this dialog.
 
@@ -363,7 +1752,7 @@ QString AsyncProgressDialog::labelText() const
 */
 int AsyncProgressDialog::threadCount() const
 {
-    return m_impl->m_tasks.count();
+    return static_cast<int>(m_impl->m_tasks.size());
 }
 
 /*!
@@ -374,7 +1763,7 @@ int AsyncProgressDialog::threadCount() const
 */
 TaskThread* AsyncProgressDialog::threadAt(int index) const
 {
-    return m_impl->m_tasks[index].m_thread;
+    return m_impl->m_tasks[index]->m_thread;
 }
 
 /*!
@@ -385,18 +1774,25 @@ TaskThread* AsyncProgressDialog::threadAt(int index) const
 */
 int AsyncProgressDialog::widgetCount() const
 {
-    return m_impl->m_tasks.count();
+    return static_cast<int>(m_impl->m_tasks.size());
 }
 
 /*!
     Returns the progress widget at given \a index.
     The index must be in the range [0, widgetCount())
 
-    \sa widgetCount()
+    In the ListView mode, no widgets are created and nullptr is returned.
+    If the widget of the task hasn't been created yet, because the dialog hasn't
+    been shown yet (see setMinimumDuration()) or because it's created by a factory
+    on demand, the widget is created by this call. A task created by a factory, which
+    has finished and is hidden automatically (see setAutoHideWidget()), has no widget
+    and nullptr is returned.
+
+    \sa widgetCount(), setViewMode(), setMinimumDuration()
 */
 ProgressWidget* AsyncProgressDialog::widgetAt(int index) const
 {
-    return m_impl->m_tasks[index].m_widget;
+    return m_impl->ensureWidget(*m_impl->m_tasks[index]);
 }
 
 /*!
@@ -410,7 +1806,7 @@ ProgressWidget* AsyncProgressDialog::widgetAt(int index) const
 */
 void AsyncProgressDialog::setAutoHideWidget(int index, bool autoHide)
 {
-    m_impl->m_tasks[index].m_autoHide = autoHide;
+    m_impl->m_tasks[index]->m_autoHide = autoHide;
 }
 
 /*!
@@ -423,7 +1819,7 @@ void AsyncProgressDialog::setAutoHideWidget(int index, bool autoHide)
 */
 bool AsyncProgressDialog::autoHideWidget(int index) const
 {
-    return m_impl->m_tasks[index].m_autoHide;
+    return m_impl->m_tasks[index]->m_autoHide;
 }
 
 }
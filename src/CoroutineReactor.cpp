@@ -0,0 +1,372 @@
+#include "CoroutineReactor.h"
+#include "CoroutineTaskThread.h"
+
+#include <QThread>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef Q_OS_LINUX
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+namespace APD
+{
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    // how often waiting tasks are checked for cancellation
+    constexpr std::chrono::milliseconds s_cancelScanInterval(50);
+
+    // the epoll data of the event waking up the workers, waits are numbered from 1
+    constexpr quint64 s_wakeUpId = 0;
+}
+
+class CoroutineReactor::Impl
+{
+public:
+    struct FdWait
+    {
+        CoroutineTaskThread* m_task;
+        int m_fd;
+    };
+
+    void waitForEvents(std::unique_lock<std::mutex>& lock, std::chrono::milliseconds timeout);
+    void wakeUpCanceled();
+    void wakeUp();
+
+    std::mutex m_mutex;
+    std::deque<CoroutineTaskThread*> m_ready;
+    std::multimap<Clock::time_point, CoroutineTaskThread*> m_timers;
+    std::unordered_map<quint64, FdWait> m_fdWaits;
+    quint64 m_nextWaitId = s_wakeUpId + 1;
+    Clock::time_point m_lastCancelScan;
+    bool m_stopping = false;
+
+    std::atomic<int> m_activeTasks = 0;
+    std::vector<std::thread> m_threads;
+
+#ifdef Q_OS_LINUX
+    int m_epoll = -1;
+    int m_wakeUpEvent = -1;
+#else
+    std::condition_variable m_wakeUp;
+#endif
+};
+
+Q_GLOBAL_STATIC(CoroutineReactor, s_globalReactor)
+
+// called with the lock held, returns with the lock held
+void CoroutineReactor::Impl::waitForEvents(std::unique_lock<std::mutex>& lock, std::chrono::milliseconds timeout)
+{
+#ifdef Q_OS_LINUX
+    lock.unlock();
+
+    epoll_event events[16];
+    int count = epoll_wait(m_epoll, events, 16, static_cast<int>(timeout.count()));
+
+    lock.lock();
+    for (int i = 0; i < count; ++i)
+    {
+        auto id = static_cast<quint64>(events[i].data.u64);
+        if (id == s_wakeUpId)
+        {
+            // left signaled when stopping, so it wakes up all the workers
+            quint64 value;
+            if (!m_stopping)
+                (void)::read(m_wakeUpEvent, &value, sizeof(value));
+            continue;
+        }
+
+        // the wait might have been removed by a cancellation meanwhile
+        auto it = m_fdWaits.find(id);
+        if (it == m_fdWaits.end())
+            continue;
+
+        epoll_ctl(m_epoll, EPOLL_CTL_DEL, it->second.m_fd, nullptr);
+        m_ready.push_back(it->second.m_task);
+        m_fdWaits.erase(it);
+    }
+#else
+    m_wakeUp.wait_for(lock, timeout);
+#endif
+}
+
+// called with the lock held
+void CoroutineReactor::Impl::wakeUpCanceled()
+{
+    for (auto it = m_timers.begin(); it != m_timers.end(); )
+    {
+        if (it->second->isCanceled())
+        {
+            m_ready.push_back(it->second);
+            it = m_timers.erase(it);
+        }
+        else
+            ++it;
+    }
+
+    for (auto it = m_fdWaits.begin(); it != m_fdWaits.end(); )
+    {
+        if (it->second.m_task->isCanceled())
+        {
+#ifdef Q_OS_LINUX
+            epoll_ctl(m_epoll, EPOLL_CTL_DEL, it->second.m_fd, nullptr);
+#endif
+            m_ready.push_back(it->second.m_task);
+            it = m_fdWaits.erase(it);
+        }
+        else
+            ++it;
+    }
+}
+
+void CoroutineReactor::Impl::wakeUp()
+{
+#ifdef Q_OS_LINUX
+    quint64 value = 1;
+    (void)::write(m_wakeUpEvent, &value, sizeof(value));
+#else
+    m_wakeUp.notify_one();
+#endif
+}
+
+/*!
+    \class CoroutineReactor
+    \brief A small set of threads, which run the coroutines of many CoroutineTaskThread tasks.
+
+    A coroutine runs on one of the threads until it suspends. A coroutine waiting for
+    a timer or a file descriptor is resumed by the first free thread, after the timer
+    expires or the descriptor becomes ready. Thousands of tasks, which mostly wait, thus
+    share a few threads instead of occupying an OS thread each. File descriptors are
+    waited for by epoll on Linux; on other platforms a coroutine waiting for a file
+    descriptor is resumed immediately, i.e. the descriptor is polled.
+
+    A task is switched to the TaskState::Queued state when started and to the
+    TaskState::Running state when its coroutine runs for the first time. Waiting tasks
+    are checked for cancellation every 50 ms; the coroutine of a canceled task is
+    destroyed at its suspension point instead of being resumed and the task finishes.
+    Its future finishes without a result, see TaskFuture::isCanceled().
+
+    AsyncProgressDialog starts coroutine tasks on globalInstance().
+
+    \sa CoroutineTaskThread, CoroutineThread
+*/
+
+/*!
+    Constructs a reactor running \a threadCount threads. If \a threadCount is zero,
+    QThread::idealThreadCount() threads are used, but at most 4.
+*/
+CoroutineReactor::CoroutineReactor(int threadCount)
+    : m_impl(std::make_unique<Impl>())
+{
+    if (threadCount <= 0)
+        threadCount = qBound(1, QThread::idealThreadCount(), 4);
+
+#ifdef Q_OS_LINUX
+    m_impl->m_epoll = epoll_create1(EPOLL_CLOEXEC);
+    m_impl->m_wakeUpEvent = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+    epoll_event event {};
+    event.events = EPOLLIN;
+    event.data.u64 = s_wakeUpId;
+    if (m_impl->m_epoll < 0 || m_impl->m_wakeUpEvent < 0
+            || epoll_ctl(m_impl->m_epoll, EPOLL_CTL_ADD, m_impl->m_wakeUpEvent, &event) != 0)
+        qFatal("CoroutineReactor: cannot create the epoll instance");
+#endif
+
+    for (int i = 0; i < threadCount; ++i)
+        m_impl->m_threads.emplace_back(&CoroutineReactor::workerLoop, this);
+}
+
+/*!
+    Stops the threads. The coroutines of the tasks, which haven't finished, are destroyed
+    without finishing the tasks, their futures are canceled.
+*/
+CoroutineReactor::~CoroutineReactor()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_impl->m_mutex);
+        m_impl->m_stopping = true;
+    }
+
+#ifdef Q_OS_LINUX
+    m_impl->wakeUp();
+#else
+    m_impl->m_wakeUp.notify_all();
+#endif
+
+    for (auto& thread : m_impl->m_threads)
+        thread.join();
+
+    for (auto task : m_impl->m_ready)
+        task->destroyCoroutine();
+    for (auto& timer : m_impl->m_timers)
+        timer.second->destroyCoroutine();
+    for (auto& wait : m_impl->m_fdWaits)
+        wait.second.m_task->destroyCoroutine();
+
+#ifdef Q_OS_LINUX
+    ::close(m_impl->m_wakeUpEvent);
+    ::close(m_impl->m_epoll);
+#endif
+}
+
+/*!
+    Returns the reactor shared by the whole process.
+*/
+CoroutineReactor* CoroutineReactor::globalInstance()
+{
+    return s_globalReactor();
+}
+
+/*!
+    Returns the number of threads running the coroutines.
+*/
+int CoroutineReactor::threadCount() const
+{
+    return static_cast<int>(m_impl->m_threads.size());
+}
+
+/*!
+    Returns the number of tasks started and not finished yet.
+*/
+int CoroutineReactor::activeTaskCount() const
+{
+    return m_impl->m_activeTasks.load(std::memory_order_relaxed);
+}
+
+void CoroutineReactor::start(CoroutineTaskThread* task)
+{
+    m_impl->m_activeTasks.fetch_add(1, std::memory_order_relaxed);
+    task->setState(TaskState::Queued);
+    post(task);
+}
+
+void CoroutineReactor::post(CoroutineTaskThread* task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_impl->m_mutex);
+        m_impl->m_ready.push_back(task);
+    }
+    m_impl->wakeUp();
+}
+
+void CoroutineReactor::postAfter(CoroutineTaskThread* task, std::chrono::steady_clock::duration delay)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_impl->m_mutex);
+        m_impl->m_timers.emplace(Clock::now() + delay, task);
+    }
+
+    // the waiting workers may sleep past the new timer
+    m_impl->wakeUp();
+}
+
+void CoroutineReactor::postWhenReady(CoroutineTaskThread* task, int fd, bool write)
+{
+#ifdef Q_OS_LINUX
+    {
+        std::lock_guard<std::mutex> lock(m_impl->m_mutex);
+        auto id = m_impl->m_nextWaitId++;
+
+        epoll_event event {};
+        event.events = (write ? EPOLLOUT : EPOLLIN) | EPOLLONESHOT;
+        event.data.u64 = id;
+
+        // inserted before the descriptor is added, an event may arrive in another worker immediately
+        m_impl->m_fdWaits.emplace(id, Impl::FdWait { task, fd });
+        if (epoll_ctl(m_impl->m_epoll, EPOLL_CTL_ADD, fd, &event) == 0)
+            return;
+
+        qWarning("CoroutineReactor: cannot wait for the file descriptor %d", fd);
+        m_impl->m_fdWaits.erase(id);
+    }
+#else
+    Q_UNUSED(write)
+    Q_UNUSED(fd)
+#endif
+
+    post(task);
+}
+
+void CoroutineReactor::finish(CoroutineTaskThread* task)
+{
+    m_impl->m_activeTasks.fetch_sub(1, std::memory_order_relaxed);
+    task->setState(TaskState::Finished);
+}
+
+void CoroutineReactor::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_impl->m_mutex);
+    for (;;)
+    {
+        if (m_impl->m_stopping)
+            break;
+
+        auto now = Clock::now();
+        while (!m_impl->m_timers.empty() && m_impl->m_timers.begin()->first <= now)
+        {
+            m_impl->m_ready.push_back(m_impl->m_timers.begin()->second);
+            m_impl->m_timers.erase(m_impl->m_timers.begin());
+        }
+
+        if (now - m_impl->m_lastCancelScan >= s_cancelScanInterval)
+        {
+            m_impl->m_lastCancelScan = now;
+            m_impl->wakeUpCanceled();
+        }
+
+        if (!m_impl->m_ready.empty())
+        {
+            auto task = m_impl->m_ready.front();
+            m_impl->m_ready.pop_front();
+            bool more = !m_impl->m_ready.empty();
+
+            lock.unlock();
+            if (more)
+                m_impl->wakeUp();
+            resume(task);
+            lock.lock();
+            continue;
+        }
+
+        auto timeout = s_cancelScanInterval;
+        if (!m_impl->m_timers.empty())
+        {
+            auto due = std::chrono::ceil<std::chrono::milliseconds>(m_impl->m_timers.begin()->first - now);
+            timeout = std::min(timeout, due);
+        }
+        m_impl->waitForEvents(lock, timeout);
+    }
+}
+
+void CoroutineReactor::resume(CoroutineTaskThread* task)
+{
+    if (task->state() == TaskState::Queued)
+        task->setState(TaskState::Running);
+
+    // a canceled task is stopped at its suspension point rather than resumed
+    if (task->isCanceled())
+    {
+        task->destroyCoroutine();
+        finish(task);
+        return;
+    }
+
+    // the task may be resumed by another worker, or finished and deleted, before this returns
+    task->resumeCoroutine();
+}
+
+}
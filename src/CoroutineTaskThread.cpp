@@ -0,0 +1,172 @@
+#include "CoroutineTaskThread.h"
+#include "CoroutineReactor.h"
+
+#include <utility>
+
+namespace APD
+{
+
+class CoroutineTaskThread::Impl
+{
+public:
+    CoroutineReactor* m_reactor = nullptr;
+
+    // the frame of the coroutine, owned by this object until the coroutine finishes
+    void* m_coroutine = nullptr;
+    CoroutineFunction m_resume = nullptr;
+    CoroutineFunction m_destroy = nullptr;
+};
+
+/*!
+    \class CoroutineTaskThread
+    \brief Base class of tasks implemented by a coroutine, which are executed by
+    a CoroutineReactor instead of a thread of their own.
+
+    The coroutine runs on one of the few threads of the reactor until it suspends,
+    e.g. waiting for a timer or a file descriptor, and the thread meanwhile runs other
+    coroutines. A task, which mostly waits for I/O, therefore doesn't occupy an OS thread.
+    The coroutine reports its progress by the methods of TaskThread as any other task.
+
+    Use CoroutineThread and Coroutine, defined in Coroutine.h, which implement this
+    class for C++20 coroutines. AsyncProgressDialog::addTask() creates a CoroutineThread
+    for a function returning Coroutine and starts it on CoroutineReactor::globalInstance().
+
+    The task is started by start() with a reactor rather than by QThread::start(), so
+    QThread::isFinished() and QThread::wait() are not applicable, use TaskThread::state()
+    instead. The scheduling attributes of TaskThread are not applied, as the threads of
+    the reactor are shared by all coroutines.
+
+    \sa CoroutineReactor, CoroutineThread
+*/
+
+/*!
+    Constructs a coroutine task with the given \a parent.
+*/
+CoroutineTaskThread::CoroutineTaskThread(QObject* parent)
+    : TaskThread(parent)
+    , m_impl(std::make_unique<Impl>())
+{
+}
+
+/*!
+    Destroys the task. The coroutine of a task, which has not finished, is destroyed
+    too. The task must not be destroyed while the reactor may resume its coroutine.
+*/
+CoroutineTaskThread::~CoroutineTaskThread()
+{
+    destroyCoroutine();
+}
+
+/*!
+    Creates the coroutine and schedules it to be run by \a reactor.
+    The task must not be started yet.
+*/
+void CoroutineTaskThread::start(CoroutineReactor* reactor)
+{
+    assert(reactor && state() == TaskState::NotStarted);
+
+    m_impl->m_reactor = reactor;
+    createCoroutine();
+    reactor->start(this);
+}
+
+/*!
+    Returns the reactor the task runs on, or nullptr if the task hasn't been started.
+*/
+CoroutineReactor* CoroutineTaskThread::reactor() const
+{
+    return m_impl->m_reactor;
+}
+
+/*!
+    Schedules the suspending coroutine to be resumed as soon as a thread of the reactor
+    is available, after coroutines, which are already waiting.
+*/
+void CoroutineTaskThread::resumeSoon()
+{
+    m_impl->m_reactor->post(this);
+}
+
+/*!
+    Schedules the suspending coroutine to be resumed after \a delay. The coroutine
+    of a task canceled meanwhile is destroyed instead.
+*/
+void CoroutineTaskThread::resumeAfter(std::chrono::steady_clock::duration delay)
+{
+    m_impl->m_reactor->postAfter(this, delay);
+}
+
+/*!
+    Schedules the suspending coroutine to be resumed when the file descriptor \a fd
+    is ready for writing if \a write is true, or for reading otherwise. The coroutine
+    of a task canceled meanwhile is destroyed instead.
+*/
+void CoroutineTaskThread::resumeWhenReady(int fd, bool write)
+{
+    m_impl->m_reactor->postWhenReady(this, fd, write);
+}
+
+/*!
+    Finishes the task after its coroutine has returned and its frame has been destroyed.
+*/
+void CoroutineTaskThread::finishCoroutine()
+{
+    m_impl->m_coroutine = nullptr;
+    m_impl->m_reactor->finish(this);
+}
+
+/*!
+    \fn void CoroutineTaskThread::createCoroutine()
+
+    Creates the coroutine suspended at its start and passes it to setCoroutine().
+    Called by start().
+*/
+
+/*!
+    Sets the frame of the \a coroutine created by createCoroutine(), and the functions,
+    which \a resume and \a destroy it. The task takes the ownership of the frame.
+*/
+void CoroutineTaskThread::setCoroutine(void* coroutine, CoroutineFunction resume, CoroutineFunction destroy)
+{
+    m_impl->m_coroutine = coroutine;
+    m_impl->m_resume = resume;
+    m_impl->m_destroy = destroy;
+}
+
+/*!
+    Reimplemented from QThread::run(). A coroutine task isn't run by a thread of its own,
+    it must be started by start().
+*/
+void CoroutineTaskThread::run()
+{
+    qWarning("CoroutineTaskThread: the task must be started by a CoroutineReactor");
+}
+
+void CoroutineTaskThread::resumeCoroutine()
+{
+    m_impl->m_resume(m_impl->m_coroutine);
+}
+
+/*!
+    Destroys the coroutine, which hasn't returned, e.g. when the task has been canceled,
+    and calls coroutineDestroyed(). Called by the reactor and by the destructor;
+    a derived class, which implements coroutineDestroyed(), calls it in its own destructor.
+*/
+void CoroutineTaskThread::destroyCoroutine()
+{
+    if (!m_impl->m_coroutine)
+        return;
+
+    m_impl->m_destroy(std::exchange(m_impl->m_coroutine, nullptr));
+    coroutineDestroyed();
+}
+
+/*!
+    Called after the coroutine has been destroyed before returning. The default
+    implementation does nothing.
+*/
+void CoroutineTaskThread::coroutineDestroyed()
+{
+}
+
+}
@@ -53,6 +53,12 @@ namespace APD
 
   \snippet mainwindow.cpp TaskResultExample
 
+  Instead of waiting for the dialog, follow-up work can be attached to each task by
+  APD::FunctionThread::future(). APD::TaskFuture::then() moves the result into a continuation
+  executed in the thread of a QObject or by an APD::TaskPool as soon as the task returns,
+  APD::TaskFuture::takeResult() moves the result out without copying it, and APD::whenAll()
+  and APD::whenAny() combine the futures of several tasks.
+
   \section task-thread Task thread
 
   APD::AsynchProgressDialog is capable of running mutiple threads. Each thread is associated with
@@ -60,6 +66,21 @@ namespace APD
   from within the thread. User may supply their own implementation of APD::TaskThread or use
   the lambda functions as decribed above.
 
+  A single task can use all cores by means of APD::parallelFor(), which splits a range of iterations
+  among worker threads and reports their combined progress through the task thread.
+
+  \snippet mainwindow.cpp ParallelForExample
+
+  Work streaming through several steps, e.g. parse, transform and write, can run as an APD::Pipeline.
+  Each step is a task with its own progress widget and the steps pass the items through bounded
+  APD::PipelineQueue objects, so a slow step holds back the steps before it. The widgets show
+  the throughput and the utilization of each step and mark the bottleneck.
+
+  To find out which task takes the longest or where the GUI thread stalls, enable
+  APD::AsyncProgressDialog::setTracingEnabled() before adding the tasks and save the timeline by
+  APD::AsyncProgressDialog::exportTrace(). The file is in the Chrome Trace Event format, which can be
+  opened in Perfetto or chrome://tracing.
+
   \section progress-widgets Progress widgets
 
   By default, the dialog displays a simple progress bar (APD::ProgressBar) for each task added to the dialog.
@@ -69,6 +90,14 @@ namespace APD
   widget displaying progress from a single thread in APD::ProgressWidgetContainer. A factory is provided, which
   is capable of creating some popular combinations of progress widgets.
 
+  Besides the progress value, a task can report several quantities at once (e.g. bytes, files and errors)
+  as a plain struct by APD::TaskThread::setMetrics(). The struct is passed to the widgets in a fixed-size
+  APD::ProgressMetrics buffer without allocations and widgets bind to its fields by the names given
+  in APD::MetricsLayout, e.g. APD::ProgressVelocityPlot::setQuantityField().
+
+  Tasks producing large amounts of output can show it in APD::ProgressLogView, which keeps the text in
+  a memory-mapped file, paints only the visible lines and searches the log in a background thread.
+
   \section examples Examples
 
   This section shows a few exmaples of what is the AsyncProgressDialog library capable of.
@@ -110,6 +139,13 @@ namespace APD
 
   \snippet mainwindow.cpp MultiProgressExample
 
+  \subsection example-list-view Many tasks example
+
+  Progress widgets are real widgets, which is too expensive for thousands of tasks. The list view mode
+  displays the tasks as rows of a list, which are painted only when visible.
+
+  \snippet mainwindow.cpp ListViewExample
+
 
   \copyright Copyright 2019 Ondrej Polacek. All rights reserved.
 */
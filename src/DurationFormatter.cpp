@@ -0,0 +1,57 @@
+#include "DurationFormatter.h"
+
+#include <QStringList>
+
+namespace APD
+{
+
+/*!
+    Return approximate representation of time (days to seconds). Lower resolution than seconds is ignored.
+*/
+QString DurationFormatter::approximate() const
+{
+    if (m_days > 0)
+        return QString("About %1 and %2").arg(formatDays(), formatHours());
+    else if (m_hours > 0)
+        return QString("About %1 and %2").arg(formatHours(), formatMinutes());
+    else if (m_minutes > 0)
+    {
+        auto str = QString("About %1").arg(formatMinutes());
+        if (m_minutes < 5 && m_seconds > 30)
+            str += tr(" and 30 seconds");
+        return str;
+    }
+    else
+    {
+        if (m_seconds > 45)
+            return tr("Less than 1 minute");
+        else if (m_seconds > 30)
+            return tr("Less than 45 seconds");
+        else if (m_seconds > 15)
+            return tr("Less than 30 seconds");
+        else if (m_seconds > 10)
+            return tr("Less than 15 seconds");
+        else if (m_seconds > 5)
+            return tr("Less than 10 seconds");
+        else
+            return tr("Less than 5 seconds");
+    }
+}
+
+/*!
+    Return exact time string (days to seconds). Lower resolution than seconds is ignored.
+*/
+QString DurationFormatter::exact() const
+{
+    QStringList str;
+    if (m_days > 0)
+        str << formatDays();
+    if (m_hours > 0)
+        str << formatHours();
+    if (m_minutes > 0)
+        str << formatMinutes();
+    str << formatSeconds();
+    return str.join(", ");
+}
+
+}
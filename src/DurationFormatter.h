@@ -0,0 +1,60 @@
+#pragma once
+
+#include <QCoreApplication>
+#include <QString>
+
+#include <chrono>
+
+namespace APD
+{
+
+/*!
+    \class DurationFormatter
+    \brief Helper class which formats time duration into desired format.
+*/
+
+class DurationFormatter
+{
+    Q_DECLARE_TR_FUNCTIONS(DurationFormatter)
+public:
+
+    /*!
+      Constructs a new duration formatter object.
+    */
+    template<class T>
+    DurationFormatter(T dur)
+    {
+        using namespace std::chrono;
+        using days = duration<long, std::ratio<3600 * 24>>;
+        auto d = duration_cast<days>(dur);
+        auto h = duration_cast<hours>(dur -= d);
+        auto m = duration_cast<minutes>(dur -= h);
+        auto s = duration_cast<seconds>(dur -= m);
+        auto ms = duration_cast<milliseconds>(dur -= s);
+
+        m_days = d.count();
+        m_hours = h.count();
+        m_minutes = m.count();
+        m_seconds = static_cast<int>(s.count());
+        m_milliseconds = static_cast<int>(ms.count());
+    }
+
+    QString approximate() const;
+    QString exact() const;
+
+private:
+    QString fromatQuantity(int q, const QString& s) const { return QString("%1 %2%3").arg(q).arg(s).arg(q != 1 ? "s" : ""); }
+    QString formatDays() const { return fromatQuantity(m_days, "day"); }
+    QString formatHours() const { return fromatQuantity(m_hours, "hour"); }
+    QString formatMinutes() const { return fromatQuantity(m_minutes, "minute"); }
+    QString formatSeconds() const { return fromatQuantity(m_seconds, "second"); }
+    QString formatMilliseconds() const { return fromatQuantity(m_milliseconds, "millisecond"); }
+
+    int m_days = 0;
+    int m_hours = 0;
+    int m_minutes = 0;
+    int m_seconds = 0;
+    int m_milliseconds = 0;
+};
+
+}
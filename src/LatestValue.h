@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <utility>
+
+namespace APD
+{
+
+/*!
+    \class LatestValue
+    \brief A lock-free slot holding the most recent value written by a single producer thread
+    and read by a single consumer thread.
+
+    The producer may overwrite the value as often as it wants using store(), the consumer picks
+    up the newest value using take(). Values overwritten before the consumer took them are dropped.
+
+    Internally, the slot is a triple buffer. The producer and the consumer own one buffer each
+    and the third one is exchanged atomically, so neither side ever waits for the other one.
+*/
+template <class T>
+class LatestValue
+{
+public:
+    /*!
+        Stores \a value as the newest value. Must be called from the producer thread only.
+    */
+    template <class U>
+    void store(U&& value)
+    {
+        m_buffers[m_back] = std::forward<U>(value);
+        m_back = m_middle.exchange(m_back | s_dirty, std::memory_order_acq_rel) & s_indexMask;
+    }
+
+    /*!
+        Moves the newest value into \a value and returns true, or returns false if no value
+        has been stored since the last call. Must be called from the consumer thread only.
+    */
+    bool take(T& value)
+    {
+        if (!(m_middle.load(std::memory_order_relaxed) & s_dirty))
+            return false;
+
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & s_indexMask;
+        value = std::move(m_buffers[m_front]);
+        return true;
+    }
+
+private:
+    static constexpr unsigned s_dirty = 0x4;
+    static constexpr unsigned s_indexMask = 0x3;
+
+    std::array<T, 3> m_buffers;
+    alignas(64) unsigned m_back = 0;                    // owned by the producer
+    alignas(64) std::atomic<unsigned> m_middle { 1 };   // exchanged by both sides
+    alignas(64) unsigned m_front = 2;                   // owned by the consumer
+};
+
+}
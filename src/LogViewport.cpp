@@ -0,0 +1,148 @@
+#include "LogViewport.h"
+#include "MappedLog.h"
+
+#include <QFontDatabase>
+#include <QPainter>
+#include <QScrollBar>
+
+#include <algorithm>
+#include <limits>
+
+namespace APD
+{
+
+/*!
+    \class LogViewport
+    \brief A scroll area painting the visible lines of a MappedLog.
+
+    The vertical scroll bar counts lines, so the cost of scrolling and painting depends
+    only on the height of the viewport, not on the size of the log. The width of the
+    content is estimated from the longest line. Logs with more than INT_MAX lines can
+    only be scrolled up to that line.
+*/
+
+/*!
+    Constructs a viewport with the given \a parent.
+*/
+LogViewport::LogViewport(QWidget* parent)
+    : QAbstractScrollArea(parent)
+{
+    setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    setHorizontalScrollBarPolicy(Qt::ScrollBarAsNeeded);
+    setVerticalScrollBarPolicy(Qt::ScrollBarAsNeeded);
+}
+
+/*!
+    Sets the \a log to be shown. The log isn't owned by the viewport.
+*/
+void LogViewport::setLog(const MappedLog* log)
+{
+    m_log = log;
+    updateScrollBars();
+}
+
+/*!
+    Updates the scroll bars to the size of the log and repaints the viewport. If the
+    view is at the last line, it follows the new lines.
+*/
+void LogViewport::updateScrollBars()
+{
+    auto lineCount = m_log ? m_log->lineCount() : 0;
+    auto visibleLines = visibleLineCount();
+
+    auto vertical = verticalScrollBar();
+    bool atBottom = vertical->value() == vertical->maximum();
+    auto maximum = std::min<qint64>(std::max<qint64>(0, lineCount - visibleLines), std::numeric_limits<int>::max());
+    vertical->setRange(0, static_cast<int>(maximum));
+    vertical->setPageStep(visibleLines);
+    if (atBottom)
+        vertical->setValue(vertical->maximum());
+
+    auto contentWidth = static_cast<qint64>(m_log ? m_log->longestLine() : 0) * fontMetrics().averageCharWidth() + 2 * s_margin;
+    auto horizontal = horizontalScrollBar();
+    horizontal->setRange(0, static_cast<int>(std::min<qint64>(std::max<qint64>(0, contentWidth - viewport()->width()),
+                                                              std::numeric_limits<int>::max())));
+    horizontal->setPageStep(viewport()->width());
+    horizontal->setSingleStep(fontMetrics().averageCharWidth());
+
+    viewport()->update();
+}
+
+/*!
+    Scrolls the view so that the \a line is in the middle, if possible.
+*/
+void LogViewport::scrollToLine(qint64 line)
+{
+    updateScrollBars();
+    auto value = std::min<qint64>(std::max<qint64>(0, line - visibleLineCount() / 2), std::numeric_limits<int>::max());
+    verticalScrollBar()->setValue(static_cast<int>(value));
+}
+
+/*!
+    Highlights the \a line, e.g. a search match. -1 removes the highlight.
+*/
+void LogViewport::setHighlightedLine(qint64 line)
+{
+    m_highlightedLine = line;
+    viewport()->update();
+}
+
+/*!
+    Reimplementation of QAbstractScrollArea::paintEvent(). Only the visible lines
+    are read from the log.
+*/
+void LogViewport::paintEvent(QPaintEvent* /*event*/)
+{
+    QPainter painter(viewport());
+    if (!m_log || m_log->lineCount() == 0)
+        return;
+
+    auto metrics = fontMetrics();
+    auto lineHeight = metrics.height();
+    auto x = s_margin - horizontalScrollBar()->value();
+    auto line = static_cast<qint64>(verticalScrollBar()->value());
+    auto lastLine = std::min(m_log->lineCount(), line + visibleLineCount() + 1);
+
+    painter.setPen(palette().color(QPalette::Text));
+    auto position = m_log->lineStart(line);
+    for (int y = 0; line < lastLine; ++line, y += lineHeight)
+    {
+        if (line == m_highlightedLine)
+        {
+            painter.fillRect(0, y, viewport()->width(), lineHeight, palette().highlight());
+            painter.setPen(palette().color(QPalette::HighlightedText));
+            painter.drawText(x, y + metrics.ascent(), m_log->lineAt(position));
+            painter.setPen(palette().color(QPalette::Text));
+        }
+        else
+            painter.drawText(x, y + metrics.ascent(), m_log->lineAt(position));
+
+        if (line + 1 < lastLine)
+            position = m_log->nextLineStart(position);
+    }
+}
+
+/*!
+    Reimplementation of QAbstractScrollArea::resizeEvent()
+*/
+void LogViewport::resizeEvent(QResizeEvent* event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBars();
+}
+
+/*!
+    Reimplementation of QAbstractScrollArea::scrollContentsBy(). The lines are
+    painted again rather than scrolled, as the vertical scroll bar counts lines.
+*/
+void LogViewport::scrollContentsBy(int /*dx*/, int /*dy*/)
+{
+    viewport()->update();
+}
+
+int LogViewport::visibleLineCount() const
+{
+    return std::max(1, viewport()->height() / fontMetrics().height());
+}
+
+}
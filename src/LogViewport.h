@@ -0,0 +1,38 @@
+#pragma once
+
+#include <QAbstractScrollArea>
+
+namespace APD
+{
+
+class MappedLog;
+
+class LogViewport : public QAbstractScrollArea
+{
+    Q_OBJECT
+public:
+    explicit LogViewport(QWidget* parent = nullptr);
+
+    void setLog(const MappedLog* log);
+    void updateScrollBars();
+
+    void scrollToLine(qint64 line);
+    void setHighlightedLine(qint64 line);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+    void scrollContentsBy(int dx, int dy) override;
+
+private:
+    Q_DISABLE_COPY(LogViewport)
+
+    int visibleLineCount() const;
+
+    static constexpr int s_margin = 4;
+
+    const MappedLog* m_log = nullptr;
+    qint64 m_highlightedLine = -1;
+};
+
+}
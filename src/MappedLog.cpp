@@ -0,0 +1,268 @@
+#include "MappedLog.h"
+#include "TaskThread.h"
+
+#include <QRegularExpression>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+namespace APD
+{
+
+/*!
+    \class MappedLog
+    \brief Append-only storage of UTF-8 text lines in a memory-mapped file.
+
+    The file grows in segments of 64 MiB, each mapped separately, so appending never
+    moves the text already stored and a Snapshot of the segments can be read by another
+    thread while new lines are appended. A line never crosses a segment, the rest of a
+    segment, which can't hold the next line, stays unused. Lines longer than a segment
+    are truncated.
+
+    Each line is stored followed by a line feed. Positions are byte offsets within the
+    file. Only the position of every 64th line is indexed, so the index stays small even
+    for millions of lines; lineStart() scans the remaining lines from the nearest indexed
+    one.
+
+    If the file can't be mapped, the segments are allocated in memory.
+*/
+
+/*!
+    Constructs a log stored in \a fileName, or in a temporary file if \a fileName
+    is empty. The file is truncated.
+*/
+MappedLog::MappedLog(const QString& fileName)
+{
+    if (fileName.isEmpty())
+    {
+        auto temporaryFile = std::make_unique<QTemporaryFile>();
+        temporaryFile->open();
+        m_file = std::move(temporaryFile);
+    }
+    else
+    {
+        m_file = std::make_unique<QFile>(fileName);
+        m_file->open(QIODevice::ReadWrite | QIODevice::Truncate);
+    }
+
+    if (!m_file->isOpen())
+        qWarning("MappedLog: cannot open %s, keeping the log in memory", qPrintable(m_file->fileName()));
+}
+
+/*!
+    Unmaps and closes the file. A temporary file is removed.
+*/
+MappedLog::~MappedLog() = default;
+
+/*!
+    Returns the name of the file.
+*/
+QString MappedLog::fileName() const
+{
+    return m_file->fileName();
+}
+
+/*!
+    Appends \a lines to the log.
+*/
+void MappedLog::append(const QStringList& lines)
+{
+    for (const auto& line : lines)
+    {
+        auto data = line.toUtf8();
+        auto size = std::min<qint64>(data.size(), s_segmentSize - 1);
+
+        char* segment = m_segments.empty() ? nullptr : m_segments.back();
+        if (!segment || m_segmentSizes.back() + size + 1 > s_segmentSize)
+            segment = addSegment();
+
+        auto offset = m_segmentSizes.back();
+        std::memcpy(segment + offset, data.constData(), static_cast<size_t>(size));
+        segment[offset + size] = '\n';
+
+        if (m_lineCount % s_indexStride == 0)
+            m_lineIndex.push_back((static_cast<qint64>(m_segments.size()) - 1) * s_segmentSize + offset);
+
+        m_segmentSizes.back() += size + 1;
+        m_byteCount += size + 1;
+        m_longestLine = std::max(m_longestLine, line.size());
+        ++m_lineCount;
+    }
+}
+
+/*!
+    Returns the position of the first byte of the \a line.
+*/
+qint64 MappedLog::lineStart(qint64 line) const
+{
+    assert(line >= 0 && line < m_lineCount);
+
+    auto position = m_lineIndex[static_cast<size_t>(line / s_indexStride)];
+    for (auto i = line % s_indexStride; i > 0; --i)
+        position = nextLineStart(position);
+    return position;
+}
+
+/*!
+    Returns the position of the line following the line at \a position.
+*/
+qint64 MappedLog::nextLineStart(qint64 position) const
+{
+    auto index = static_cast<size_t>(position / s_segmentSize);
+    auto offset = position % s_segmentSize;
+    auto segment = m_segments[index];
+    auto used = m_segmentSizes[index];
+
+    auto end = static_cast<const char*>(std::memchr(segment + offset, '\n', static_cast<size_t>(used - offset)));
+    auto next = end ? end - segment + 1 : used;
+    if (next >= used && index + 1 < m_segments.size())
+        return static_cast<qint64>(index + 1) * s_segmentSize;
+    return static_cast<qint64>(index) * s_segmentSize + next;
+}
+
+/*!
+    Returns the text of the line at \a position.
+*/
+QString MappedLog::lineAt(qint64 position) const
+{
+    auto index = static_cast<size_t>(position / s_segmentSize);
+    auto offset = position % s_segmentSize;
+    auto begin = m_segments[index] + offset;
+    auto used = m_segmentSizes[index];
+
+    auto end = static_cast<const char*>(std::memchr(begin, '\n', static_cast<size_t>(used - offset)));
+    auto size = end ? end - begin : used - offset;
+    return QString::fromUtf8(begin, static_cast<int>(size));
+}
+
+/*!
+    Returns the segments holding the lines appended so far. The bytes of the snapshot
+    don't change, so they can be read from another thread, as long as the log exists.
+*/
+MappedLog::Snapshot MappedLog::snapshot() const
+{
+    return { { m_segments.begin(), m_segments.end() }, m_segmentSizes };
+}
+
+/*!
+    Searches the lines of \a snapshot for \a pattern and returns the numbers of the
+    matching lines. The pattern is a regular expression if \a regularExpression is
+    true, otherwise a substring matched with \a caseSensitivity.
+
+    The search runs in \a thread, which reports the number of bytes searched as its
+    progress, and stops early when the thread is canceled. A case sensitive substring
+    is searched directly in the UTF-8 bytes, other patterns decode each line.
+*/
+std::vector<qint64> MappedLog::search(const Snapshot& snapshot, const QString& pattern, bool regularExpression,
+                                      Qt::CaseSensitivity caseSensitivity, TaskThread* thread)
+{
+    // the bytes are searched in chunks of whole lines, between which progress is reported
+    static constexpr qint64 chunkSize = 1024 * 1024;
+
+    qint64 total = 0;
+    for (auto size : snapshot.m_segmentSizes)
+        total += size;
+    thread->setRange(0, total);
+
+    QRegularExpression expression;
+    if (regularExpression)
+    {
+        expression.setPattern(pattern);
+        if (caseSensitivity == Qt::CaseInsensitive)
+            expression.setPatternOptions(QRegularExpression::CaseInsensitiveOption);
+    }
+
+    auto bytes = pattern.toUtf8();
+    bool searchBytes = !regularExpression && caseSensitivity == Qt::CaseSensitive;
+    std::boyer_moore_horspool_searcher<const char*> searcher(bytes.constData(), bytes.constData() + bytes.size());
+
+    std::vector<qint64> result;
+    qint64 line = 0;
+    qint64 searched = 0;
+
+    for (size_t index = 0; index < snapshot.m_segments.size(); ++index)
+    {
+        auto segment = snapshot.m_segments[index];
+        auto end = segment + snapshot.m_segmentSizes[index];
+
+        for (auto chunk = segment; chunk < end; )
+        {
+            if (thread->isCanceled())
+                return result;
+
+            auto chunkEnd = end;
+            if (end - chunk > chunkSize)
+            {
+                auto lineEnd = static_cast<const char*>(std::memchr(chunk + chunkSize, '\n', static_cast<size_t>(end - chunk - chunkSize)));
+                chunkEnd = lineEnd ? lineEnd + 1 : end;
+            }
+
+            if (searchBytes)
+            {
+                // count the lines up to each match only
+                for (auto position = chunk; position < chunkEnd; )
+                {
+                    auto match = std::search(position, chunkEnd, searcher);
+                    if (match == chunkEnd)
+                    {
+                        line += std::count(position, chunkEnd, '\n');
+                        break;
+                    }
+
+                    line += std::count(position, match, '\n');
+                    result.push_back(line);
+
+                    auto lineEnd = static_cast<const char*>(std::memchr(match, '\n', static_cast<size_t>(chunkEnd - match)));
+                    position = lineEnd ? lineEnd + 1 : chunkEnd;
+                    ++line;
+                }
+            }
+            else
+            {
+                for (auto position = chunk; position < chunkEnd; ++line)
+                {
+                    auto lineEnd = static_cast<const char*>(std::memchr(position, '\n', static_cast<size_t>(chunkEnd - position)));
+                    if (!lineEnd)
+                        lineEnd = chunkEnd;
+
+                    auto text = QString::fromUtf8(position, static_cast<int>(lineEnd - position));
+                    bool matched = regularExpression ? expression.match(text).hasMatch()
+                                                     : text.contains(pattern, caseSensitivity);
+                    if (matched)
+                        result.push_back(line);
+
+                    position = lineEnd + 1;
+                }
+            }
+
+            searched += chunkEnd - chunk;
+            thread->setValue(searched);
+            chunk = chunkEnd;
+        }
+    }
+
+    return result;
+}
+
+char* MappedLog::addSegment()
+{
+    auto offset = static_cast<qint64>(m_segments.size()) * s_segmentSize;
+
+    char* segment = nullptr;
+    if (m_file->isOpen() && m_file->resize(offset + s_segmentSize))
+        segment = reinterpret_cast<char*>(m_file->map(offset, s_segmentSize));
+
+    if (!segment)
+    {
+        // not value-initialized, untouched pages aren't committed
+        m_fallbackSegments.emplace_back(new char[static_cast<size_t>(s_segmentSize)]);
+        segment = m_fallbackSegments.back().get();
+    }
+
+    m_segments.push_back(segment);
+    m_segmentSizes.push_back(0);
+    return segment;
+}
+
+}
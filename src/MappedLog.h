@@ -0,0 +1,62 @@
+#pragma once
+
+#include <QFile>
+#include <QStringList>
+#include <QTemporaryFile>
+
+#include <memory>
+#include <vector>
+
+namespace APD
+{
+
+class TaskThread;
+
+class MappedLog
+{
+public:
+    struct Snapshot
+    {
+        std::vector<const char*> m_segments;
+        std::vector<qint64> m_segmentSizes;
+    };
+
+    explicit MappedLog(const QString& fileName);
+    ~MappedLog();
+
+    QString fileName() const;
+
+    void append(const QStringList& lines);
+    qint64 lineCount() const { return m_lineCount; }
+    qint64 byteCount() const { return m_byteCount; }
+    int longestLine() const { return m_longestLine; }
+
+    qint64 lineStart(qint64 line) const;
+    qint64 nextLineStart(qint64 position) const;
+    QString lineAt(qint64 position) const;
+
+    Snapshot snapshot() const;
+
+    static std::vector<qint64> search(const Snapshot& snapshot, const QString& pattern, bool regularExpression,
+                                      Qt::CaseSensitivity caseSensitivity, TaskThread* thread);
+
+    static constexpr qint64 s_segmentSize = 64 * 1024 * 1024;
+
+private:
+    Q_DISABLE_COPY(MappedLog)
+
+    char* addSegment();
+
+    static constexpr int s_indexStride = 64;
+
+    std::unique_ptr<QFile> m_file;          // a QTemporaryFile if no file name is given
+    std::vector<char*> m_segments;          // mapped, or allocated if the file can't be mapped
+    std::vector<std::unique_ptr<char[]>> m_fallbackSegments;
+    std::vector<qint64> m_segmentSizes;     // bytes used in each segment
+    std::vector<qint64> m_lineIndex;        // start of every s_indexStride-th line
+    qint64 m_lineCount = 0;
+    qint64 m_byteCount = 0;
+    int m_longestLine = 0;
+};
+
+}
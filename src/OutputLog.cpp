@@ -0,0 +1,267 @@
+#include "OutputLog.h"
+
+#include <QIODevice>
+
+#include <algorithm>
+
+namespace APD
+{
+
+/*!
+    \class OutputLog
+    \brief An append-only log of text lines stored on disk by a background thread.
+
+    ProgressOutput spills its history to the log, so only a bounded window of lines
+    needs to be kept in memory. Lines passed to append() are grouped into blocks of
+    256 lines, which the writer thread encodes to UTF-8, optionally compresses by
+    qCompress() and appends to the file. Only the position of each block is kept in
+    memory. Lines of an incomplete block stay in memory until the block is full or
+    the log is destroyed.
+
+    If the file can't be opened or written, the lines stay in memory, but only the
+    newest 16384 of them. The older ones are dropped and read back as a "log truncated"
+    marker followed by empty lines, so the line numbers don't change.
+
+    An uncompressed log is a plain text file with one line per text line.
+
+    Reading by lines() is done in the calling thread and the last block read is cached,
+    so scrolling within a block doesn't touch the file.
+*/
+
+/*!
+    Constructs a log writing to \a fileName, or to a temporary file if \a fileName
+    is empty. The file is truncated. If \a compressed is true, the blocks are compressed.
+*/
+OutputLog::OutputLog(const QString& fileName, bool compressed)
+    : m_compressed(compressed)
+{
+    if (fileName.isEmpty())
+    {
+        auto temporaryFile = std::make_unique<QTemporaryFile>();
+        temporaryFile->open();
+        m_writeFile = std::move(temporaryFile);
+    }
+    else
+    {
+        m_writeFile = std::make_unique<QFile>(fileName);
+        m_writeFile->open(QIODevice::WriteOnly | QIODevice::Truncate);
+    }
+
+    if (!m_writeFile->isOpen())
+    {
+        qWarning("OutputLog: cannot open %s, keeping only the newest lines",
+                 qPrintable(m_writeFile->fileName()));
+        m_failed = true;
+        return;
+    }
+
+    m_readFile.setFileName(m_writeFile->fileName());
+    m_writer = std::thread(&OutputLog::writeLoop, this);
+}
+
+/*!
+    Writes the remaining lines and closes the log. A temporary file is removed.
+*/
+OutputLog::~OutputLog()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closing = true;
+    }
+    m_wakeUp.notify_one();
+
+    if (m_writer.joinable())
+        m_writer.join();
+}
+
+/*!
+    Returns true if the file has been opened successfully.
+*/
+bool OutputLog::isOpen() const
+{
+    return m_writeFile->isOpen();
+}
+
+/*!
+    Returns the name of the file.
+*/
+QString OutputLog::fileName() const
+{
+    return m_writeFile->fileName();
+}
+
+/*!
+    Appends \a lines to the log. The lines are written to the file asynchronously,
+    but they can be read by lines() immediately.
+*/
+void OutputLog::append(const QStringList& lines)
+{
+    bool blockFull;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_unwritten.append(lines);
+        if (m_failed)
+            dropOldestLines();
+        blockFull = m_unwritten.size() >= s_blockLineCount;
+    }
+
+    if (blockFull)
+        m_wakeUp.notify_one();
+}
+
+/*!
+    Returns the number of lines appended to the log.
+*/
+qint64 OutputLog::lineCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_writtenLines + m_droppedLines + m_unwritten.size();
+}
+
+/*!
+    Returns up to \a count lines starting at the line \a first.
+*/
+QStringList OutputLog::lines(qint64 first, int count) const
+{
+    QStringList result;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto last = std::min(first + count, m_writtenLines + m_droppedLines + m_unwritten.size());
+    while (first < last)
+    {
+        auto unwrittenFirst = m_writtenLines + m_droppedLines;
+        if (first >= unwrittenFirst)
+        {
+            result.append(m_unwritten.mid(static_cast<int>(first - unwrittenFirst), static_cast<int>(last - first)));
+            break;
+        }
+
+        if (first >= m_writtenLines)
+        {
+            // the dropped lines
+            for (; first < std::min(last, unwrittenFirst); ++first)
+            {
+                if (first == m_writtenLines)
+                    result.append(tr("(log truncated, %n line(s) dropped)", nullptr, static_cast<int>(m_droppedLines)));
+                else
+                    result.append(QString());
+            }
+            continue;
+        }
+
+        auto it = std::upper_bound(m_blocks.begin(), m_blocks.end(), first,
+                                   [](qint64 line, const Block& block) { return line < block.m_firstLine; }) - 1;
+        auto index = static_cast<size_t>(it - m_blocks.begin());
+        auto block = *it;
+
+        // written blocks never change, the file can be read without the lock
+        lock.unlock();
+        auto blockLines = readBlock(index);
+        lock.lock();
+
+        auto from = first - block.m_firstLine;
+        auto n = std::min(last - first, block.m_lineCount - from);
+        result.append(blockLines.mid(static_cast<int>(from), static_cast<int>(n)));
+        first += n;
+    }
+
+    return result;
+}
+
+/*!
+    Writes all lines to \a device as UTF-8 text, one line per text line.
+    Returns false if writing fails.
+*/
+bool OutputLog::exportTo(QIODevice* device) const
+{
+    auto count = lineCount();
+    for (qint64 first = 0; first < count; first += s_blockLineCount)
+    {
+        auto data = lines(first, s_blockLineCount).join('\n').toUtf8();
+        data.append('\n');
+        if (device->write(data) != data.size())
+            return false;
+    }
+    return true;
+}
+
+void OutputLog::writeLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        m_wakeUp.wait(lock, [this]() { return m_closing || m_unwritten.size() >= s_blockLineCount; });
+
+        // an incomplete block is only written when closing
+        auto count = std::min(m_unwritten.size(), s_blockLineCount);
+        if (count == 0)
+            break;
+        if (count < s_blockLineCount && !m_closing)
+            continue;
+
+        auto data = m_unwritten.mid(0, count).join('\n').toUtf8();
+        auto offset = m_fileSize;
+        auto firstLine = m_writtenLines;
+
+        lock.unlock();
+        data.append('\n');
+        if (m_compressed)
+            data = qCompress(data);
+        bool written = m_writeFile->write(data) == data.size() && m_writeFile->flush();
+        lock.lock();
+
+        if (!written)
+        {
+            // keep the newest lines in memory, append() drops the older ones from now on
+            qWarning("OutputLog: cannot write to %s, keeping only the newest lines",
+                     qPrintable(m_writeFile->fileName()));
+            m_failed = true;
+            dropOldestLines();
+            m_wakeUp.wait(lock, [this]() { return m_closing; });
+            break;
+        }
+
+        m_blocks.push_back({ offset, firstLine, data.size(), count });
+        m_unwritten.erase(m_unwritten.begin(), m_unwritten.begin() + count);
+        m_writtenLines += count;
+        m_fileSize += data.size();
+    }
+}
+
+// Called with the mutex locked after the file has failed.
+void OutputLog::dropOldestLines()
+{
+    auto excess = m_unwritten.size() - s_maximumUnwrittenLineCount;
+    if (excess <= 0)
+        return;
+
+    m_unwritten.erase(m_unwritten.begin(), m_unwritten.begin() + excess);
+    m_droppedLines += excess;
+}
+
+QStringList OutputLog::readBlock(size_t index) const
+{
+    if (index == m_cachedBlock)
+        return m_cachedLines;
+
+    Block block;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        block = m_blocks[index];
+    }
+
+    if (!m_readFile.isOpen() && !m_readFile.open(QIODevice::ReadOnly))
+        return QStringList();
+
+    m_readFile.seek(block.m_offset);
+    auto data = m_readFile.read(block.m_size);
+    if (m_compressed)
+        data = qUncompress(data);
+    data.chop(1);   // the trailing line feed
+
+    m_cachedLines = QString::fromUtf8(data).split('\n');
+    m_cachedBlock = index;
+    return m_cachedLines;
+}
+
+}
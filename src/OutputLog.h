@@ -0,0 +1,73 @@
+#pragma once
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QStringList>
+#include <QTemporaryFile>
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class QIODevice;
+
+namespace APD
+{
+
+class OutputLog
+{
+    Q_DECLARE_TR_FUNCTIONS(OutputLog)
+public:
+    OutputLog(const QString& fileName, bool compressed);
+    ~OutputLog();
+
+    bool isOpen() const;
+    QString fileName() const;
+
+    void append(const QStringList& lines);
+    qint64 lineCount() const;
+    QStringList lines(qint64 first, int count) const;
+
+    bool exportTo(QIODevice* device) const;
+
+private:
+    Q_DISABLE_COPY(OutputLog)
+
+    struct Block
+    {
+        qint64 m_offset;
+        qint64 m_firstLine;
+        int m_size;
+        int m_lineCount;
+    };
+
+    void writeLoop();
+    QStringList readBlock(size_t index) const;
+    void dropOldestLines();
+
+    static constexpr int s_blockLineCount = 256;
+    static constexpr int s_maximumUnwrittenLineCount = 64 * s_blockLineCount;
+
+    std::unique_ptr<QFile> m_writeFile;    // a QTemporaryFile if no file name is given
+    mutable QFile m_readFile;
+    bool m_compressed;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    std::vector<Block> m_blocks;        // blocks written to the file
+    QStringList m_unwritten;            // lines after the last written block
+    qint64 m_writtenLines = 0;
+    qint64 m_droppedLines = 0;          // lines between the written and unwritten ones
+    qint64 m_fileSize = 0;
+    bool m_failed = false;              // the file cannot be written
+    bool m_closing = false;
+    std::thread m_writer;
+
+    // the last block read from the file, accessed by the reading thread only
+    mutable size_t m_cachedBlock = static_cast<size_t>(-1);
+    mutable QStringList m_cachedLines;
+};
+
+}
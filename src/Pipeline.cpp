@@ -0,0 +1,443 @@
+#include "Pipeline.h"
+#include "ProgressWidget.h"
+#include "ProgressWidgetFactory.h"
+#include "TaskThread.h"
+
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QTimer>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace APD
+{
+
+namespace
+{
+    qint64 nanosecondsOf(std::chrono::steady_clock::time_point time)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+    }
+
+    // the finished waits and the ongoing one, the ongoing wait is published when it
+    // starts, so a stage blocked for a long time shows as waiting before it wakes up
+    qint64 totalWaitTime(const std::atomic<qint64>& waitTime, const std::atomic<qint64>& waitStart)
+    {
+        auto total = waitTime.load(std::memory_order_relaxed);
+        auto start = waitStart.load(std::memory_order_relaxed);
+        if (start != 0)
+            total += std::max<qint64>(0, nanosecondsOf(std::chrono::steady_clock::now()) - start);
+        return total;
+    }
+}
+
+/*!
+    \class PipelineQueueBase
+    \brief The part of PipelineQueue, which doesn't depend on the item type.
+
+    The counters can be read from any thread, Pipeline reads them in the GUI thread
+    to show the fill level and the throughput of the stages.
+*/
+
+/*!
+    Constructs the base of a queue, which holds up to \a capacity items.
+*/
+PipelineQueueBase::PipelineQueueBase(std::size_t capacity)
+    : m_capacity(capacity)
+{
+    assert(capacity > 0);
+}
+
+PipelineQueueBase::~PipelineQueueBase() = default;
+
+/*!
+    Returns the maximum number of items in the queue.
+*/
+std::size_t PipelineQueueBase::capacity() const
+{
+    return m_capacity;
+}
+
+/*!
+    Returns the number of items in the queue. Read from another thread than the producer
+    and the consumer, the number is approximate.
+*/
+std::size_t PipelineQueueBase::size() const
+{
+    auto popped = m_popped.load(std::memory_order_relaxed);
+    auto pushed = m_pushed.load(std::memory_order_relaxed);
+    return static_cast<std::size_t>(qBound<qint64>(0, pushed - popped, static_cast<qint64>(m_capacity)));
+}
+
+/*!
+    Returns the part of the capacity used by the items, in the range [0, 1].
+*/
+double PipelineQueueBase::fillLevel() const
+{
+    return static_cast<double>(size()) / static_cast<double>(m_capacity);
+}
+
+/*!
+    Returns the number of items pushed to the queue so far.
+*/
+qint64 PipelineQueueBase::pushedCount() const
+{
+    return m_pushed.load(std::memory_order_relaxed);
+}
+
+/*!
+    Returns the number of items taken from the queue so far.
+*/
+qint64 PipelineQueueBase::poppedCount() const
+{
+    return m_popped.load(std::memory_order_relaxed);
+}
+
+/*!
+    Returns the total time in nanoseconds, which the producer has spent waiting for
+    a free slot, i.e. held back by the consumer. The time includes the ongoing wait.
+*/
+qint64 PipelineQueueBase::producerWaitTime() const
+{
+    return totalWaitTime(m_producerWaitTime, m_producerWaitStart);
+}
+
+/*!
+    Returns the total time in nanoseconds, which the consumer has spent waiting for
+    an item, i.e. starved by the producer. The time includes the ongoing wait.
+*/
+qint64 PipelineQueueBase::consumerWaitTime() const
+{
+    return totalWaitTime(m_consumerWaitTime, m_consumerWaitStart);
+}
+
+/*!
+    Marks the end of the items. Called by the producer, after the last push.
+*/
+void PipelineQueueBase::close()
+{
+    m_closed.store(true, std::memory_order_release);
+}
+
+/*!
+    Returns true if the producer has closed the queue.
+*/
+bool PipelineQueueBase::isClosed() const
+{
+    return m_closed.load(std::memory_order_acquire);
+}
+
+/*!
+    Marks that no more items are taken. Called by the consumer, when it finishes.
+*/
+void PipelineQueueBase::abandon()
+{
+    m_abandoned.store(true, std::memory_order_release);
+}
+
+/*!
+    Returns true if the consumer has abandoned the queue.
+*/
+bool PipelineQueueBase::isAbandoned() const
+{
+    return m_abandoned.load(std::memory_order_acquire);
+}
+
+/*!
+    Sets the task \a thread of the producer stage, whose cancellation stops waiting in push().
+    Must be set before the task starts.
+*/
+void PipelineQueueBase::setProducer(TaskThread* thread)
+{
+    m_producer = thread;
+}
+
+/*!
+    Sets the task \a thread of the consumer stage, whose cancellation stops waiting in pop().
+    Must be set before the task starts.
+*/
+void PipelineQueueBase::setConsumer(TaskThread* thread)
+{
+    m_consumer = thread;
+}
+
+bool PipelineQueueBase::isProducerCanceled() const
+{
+    return m_producer && m_producer->isCanceled();
+}
+
+bool PipelineQueueBase::isConsumerCanceled() const
+{
+    return m_consumer && m_consumer->isCanceled();
+}
+
+void PipelineQueueBase::backoff(int round)
+{
+    // a short wait is likely to end soon, a long one shouldn't burn a core
+    static constexpr int yieldRounds = 16;
+    if (round < yieldRounds)
+        std::this_thread::yield();
+    else
+        std::this_thread::sleep_for(std::chrono::microseconds(std::min(1000, 10 << std::min(round - yieldRounds, 7))));
+}
+
+PipelineQueueBase::Clock::time_point PipelineQueueBase::beginWait(std::atomic<qint64>& waitStart)
+{
+    auto start = Clock::now();
+    waitStart.store(nanosecondsOf(start), std::memory_order_relaxed);
+    return start;
+}
+
+void PipelineQueueBase::endWait(std::atomic<qint64>& waitStart, std::atomic<qint64>& waitTime, Clock::time_point start)
+{
+    // a reader in between misses the wait until the next reading rather than counting it twice
+    waitStart.store(0, std::memory_order_relaxed);
+    waitTime.fetch_add(nanosecondsOf(Clock::now()) - nanosecondsOf(start), std::memory_order_relaxed);
+}
+
+
+class Pipeline::Impl
+{
+public:
+    struct Stage
+    {
+        TaskThread* m_thread;
+        QPointer<ProgressWidget> m_widget;
+        std::shared_ptr<PipelineQueueBase> m_input;
+        std::shared_ptr<PipelineQueueBase> m_output;
+
+        // counters at the last update of the statistics
+        qint64 m_items = 0;
+        qint64 m_waitTime = 0;
+        double m_throughput = 0;
+        double m_utilization = 0;
+    };
+
+    qint64 items(const Stage& stage) const
+    {
+        return stage.m_input ? stage.m_input->poppedCount() : stage.m_output->pushedCount();
+    }
+
+    qint64 waitTime(const Stage& stage) const
+    {
+        return (stage.m_input ? stage.m_input->consumerWaitTime() : 0)
+               + (stage.m_output ? stage.m_output->producerWaitTime() : 0);
+    }
+
+    AsyncProgressDialog* m_dialog;
+    std::size_t m_queueCapacity;
+    std::vector<Stage> m_stages;
+    int m_bottleneck = -1;
+    QTimer* m_timer;
+    QElapsedTimer m_interval;
+};
+
+/*!
+    \class Pipeline
+    \brief A chain of tasks of AsyncProgressDialog, which pass items to each other
+    through bounded queues.
+
+    Each stage is a task with its own progress widget, running in parallel with the other
+    stages. A stage takes the items of the previous stage from a PipelineQueue and pushes
+    its items to the next one. As the queues are bounded, a slow stage holds back the
+    stages before it, so the memory stays bounded while all stages are kept busy.
+
+    \code
+    Pipeline pipeline(&dialog);
+    auto lines = pipeline.addSource<QString>(tr("Parse"), [](TaskThread*, PipelineQueue<QString>& output) {
+        for (const auto& line : readLines())
+            if (!output.push(line))
+                return;
+    });
+    auto records = pipeline.addStage<Record>(tr("Transform"), lines,
+            [](TaskThread*, PipelineQueue<QString>& input, PipelineQueue<Record>& output) {
+        while (auto line = input.pop())
+            if (!output.push(transform(*line)))
+                return;
+    });
+    pipeline.addSink(tr("Write"), records, [](TaskThread*, PipelineQueue<Record>& input) {
+        while (auto record = input.pop())
+            write(*record);
+    });
+    dialog.exec();
+    \endcode
+
+    The stage functions can report their progress by TaskThread as any task. Four times
+    a second, the pipeline shows the throughput of each stage, the fill level of its input
+    queue and its utilization, the part of time it didn't wait for the neighboring stages,
+    in the label of the stage's widget. The stage with the highest utilization is marked as
+    the bottleneck. The label isn't available in the ListView mode of the dialog; use
+    throughput(), utilization() and bottleneck() instead.
+
+    Canceling the dialog cancels all stages, which stops their waiting in the queues.
+
+    The stages wait for each other, so they must run at the same time. Each stage is
+    therefore started in its own thread as soon as it's added, neither by the task pool
+    of the dialog nor after the limits of AsyncProgressDialog::setMaximumConcurrency()
+    and AsyncProgressDialog::setResourceLimit(). The stages don't count in these limits.
+
+    \sa PipelineQueue, AsyncProgressDialog
+*/
+
+/*!
+    Constructs a pipeline adding its stages to \a dialog, which becomes the parent of the
+    pipeline. The queues between the stages hold up to \a queueCapacity items.
+*/
+Pipeline::Pipeline(AsyncProgressDialog* dialog, std::size_t queueCapacity)
+    : QObject(dialog)
+    , m_impl(std::make_unique<Impl>())
+{
+    assert(dialog);
+    m_impl->m_dialog = dialog;
+    m_impl->m_queueCapacity = queueCapacity;
+
+    m_impl->m_timer = new QTimer(this);
+    m_impl->m_timer->setInterval(250);
+    connect(m_impl->m_timer, &QTimer::timeout, this, &Pipeline::updateStatistics);
+}
+
+Pipeline::~Pipeline() = default;
+
+/*!
+    Returns the capacity of the queues created for the following stages.
+
+    \sa setQueueCapacity()
+*/
+std::size_t Pipeline::queueCapacity() const
+{
+    return m_impl->m_queueCapacity;
+}
+
+/*!
+    Sets the \a capacity of the queues created for the following stages. Larger queues
+    absorb bursts of the stages, smaller ones hold less memory.
+
+    \sa queueCapacity()
+*/
+void Pipeline::setQueueCapacity(std::size_t capacity)
+{
+    m_impl->m_queueCapacity = capacity;
+}
+
+/*!
+    Returns the number of stages.
+*/
+int Pipeline::stageCount() const
+{
+    return static_cast<int>(m_impl->m_stages.size());
+}
+
+/*!
+    Returns the task thread of the \a stage.
+*/
+TaskThread* Pipeline::stageThread(int stage) const
+{
+    return m_impl->m_stages[static_cast<size_t>(stage)].m_thread;
+}
+
+/*!
+    Returns the number of items per second, which the \a stage has taken from its input,
+    or pushed to its output for the first stage, measured over the last quarter of a second.
+*/
+double Pipeline::throughput(int stage) const
+{
+    return m_impl->m_stages[static_cast<size_t>(stage)].m_throughput;
+}
+
+/*!
+    Returns the part of the last quarter of a second, in the range [0, 1], which the \a stage
+    spent working rather than waiting for an item or for a free slot in the queues.
+*/
+double Pipeline::utilization(int stage) const
+{
+    return m_impl->m_stages[static_cast<size_t>(stage)].m_utilization;
+}
+
+/*!
+    Returns the index of the running stage with the highest utilization, which limits
+    the throughput of the pipeline, or -1 if no stage is running.
+*/
+int Pipeline::bottleneck() const
+{
+    return m_impl->m_bottleneck;
+}
+
+AsyncProgressDialog* Pipeline::dialog() const
+{
+    return m_impl->m_dialog;
+}
+
+void Pipeline::addStageThread(const QString& name, TaskThread* thread,
+                              std::shared_ptr<PipelineQueueBase> input, std::shared_ptr<PipelineQueueBase> output)
+{
+    // the rows of the ListView mode have no label for the statistics
+    ProgressWidget* widget = nullptr;
+    if (m_impl->m_dialog->viewMode() == AsyncProgressDialog::WidgetView)
+        widget = ProgressWidgetFactory::createProgressBar(name, AdditionalWidget::Label);
+    m_impl->m_stages.push_back({ thread, widget, std::move(input), std::move(output) });
+    m_impl->m_dialog->addPipelineStage(thread, widget);
+
+    if (!m_impl->m_timer->isActive())
+    {
+        m_impl->m_interval.start();
+        m_impl->m_timer->start();
+    }
+}
+
+void Pipeline::updateStatistics()
+{
+    auto interval = m_impl->m_interval.restart();
+    if (interval <= 0)
+        return;
+
+    bool running = false;
+    double highestUtilization = 0;
+    m_impl->m_bottleneck = -1;
+
+    for (size_t i = 0; i < m_impl->m_stages.size(); ++i)
+    {
+        auto& stage = m_impl->m_stages[i];
+        auto items = m_impl->items(stage);
+        auto waitTime = m_impl->waitTime(stage);
+
+        stage.m_throughput = 1000.0 * static_cast<double>(items - stage.m_items) / static_cast<double>(interval);
+        stage.m_utilization = 0;
+        if (stage.m_thread->state() == TaskState::Running)
+        {
+            running = true;
+            auto waited = static_cast<double>(waitTime - stage.m_waitTime) / 1e6;
+            stage.m_utilization = qBound(0.0, 1.0 - waited / static_cast<double>(interval), 1.0);
+            if (stage.m_utilization > highestUtilization)
+            {
+                highestUtilization = stage.m_utilization;
+                m_impl->m_bottleneck = static_cast<int>(i);
+            }
+        }
+
+        stage.m_items = items;
+        stage.m_waitTime = waitTime;
+    }
+
+    for (size_t i = 0; i < m_impl->m_stages.size(); ++i)
+    {
+        auto& stage = m_impl->m_stages[i];
+        if (!stage.m_widget)
+            continue;
+
+        auto text = tr("%1 items/s").arg(stage.m_throughput, 0, 'f', 0);
+        if (stage.m_input)
+            text += tr(", input %1% full").arg(qRound(100 * stage.m_input->fillLevel()));
+        text += tr(", busy %1%").arg(qRound(100 * stage.m_utilization));
+        if (static_cast<int>(i) == m_impl->m_bottleneck)
+            text += tr(" (bottleneck)");
+        stage.m_widget->setText(text);
+    }
+
+    if (!running && std::all_of(m_impl->m_stages.begin(), m_impl->m_stages.end(),
+                                [](const Impl::Stage& stage) { return stage.m_thread->state() == TaskState::Finished; }))
+        m_impl->m_timer->stop();
+}
+
+}
@@ -3,6 +3,8 @@
 #include <QProgressBar>
 #include <QHBoxLayout>
 
+#include <limits>
+
 namespace APD
 {
 
@@ -13,8 +15,21 @@ class ProgressBar::Impl
 public:
     Impl(ProgressBar* parent);
 
+    void setValue(qint64 value);
+    void setRange(qint64 minimum, qint64 maximum);
+
+private:
+    int toBarValue(qint64 value) const;
+
 private:
+    // QProgressBar is limited to int, larger ranges are mapped to [0, s_scaledMaximum]
+    static constexpr int s_scaledMaximum = 1000000;
+
     QProgressBar* m_progressBar;
+    qint64 m_minimum = 0;
+    qint64 m_maximum = 100;
+    qint64 m_value = 0;
+    bool m_scaled = false;
 };
 
 ProgressBar::Impl::Impl(ProgressBar* parent)
@@ -26,11 +41,43 @@ ProgressBar::Impl::Impl(ProgressBar* parent)
     layout->addWidget(m_progressBar);
 }
 
+void ProgressBar::Impl::setValue(qint64 value)
+{
+    m_value = value;
+}
+
+void ProgressBar::Impl::setRange(qint64 minimum, qint64 maximum)
+{
+    m_minimum = minimum;
+    m_maximum = maximum;
+    m_scaled = minimum < std::numeric_limits<int>::min() || maximum > std::numeric_limits<int>::max();
+    if (m_scaled)
+        m_progressBar->setRange(0, s_scaledMaximum);
+    else
+        m_progressBar->setRange(static_cast<int>(minimum), static_cast<int>(maximum));
+}
+
+int ProgressBar::Impl::toBarValue(qint64 value) const
+{
+    if (!m_scaled)
+        return static_cast<int>(qBound<qint64>(std::numeric_limits<int>::min(), value, std::numeric_limits<int>::max()));
+
+    if (m_maximum <= m_minimum)
+        return 0;
+
+    auto ratio = (static_cast<double>(value) - m_minimum) / (static_cast<double>(m_maximum) - m_minimum);
+    return static_cast<int>(qBound(0.0, ratio, 1.0) * s_scaledMaximum);
+}
+
 /*!
     \class ProgressBar
     \brief A wrapper around QProgressBar, which can be added to AsyncProgressDialog.
 
     The label shows current progress value as set by TaskThread::setValue() method.
+    Ranges, which don't fit into int, are mapped to the internal scale of QProgressBar.
+    The percentage is displayed correctly, however, the \c %v and \c %m format placeholders
+    show the mapped values in such a case.
+    While the task waits for execution, the progress bar shows a waiting text.
 */
 
 /*!
@@ -55,17 +102,42 @@ QProgressBar* ProgressBar::progressBar() const
 /*!
     Reimplementation of ProgressWidget::setValue()
 */
-void ProgressBar::setValue(int value, const QVariant&, const TimeStamp&)
+void ProgressBar::setValue(qint64 value, const QVariant&, const TimeStamp&)
+{
+    m_impl->setValue(value);
+    requestRender();
+}
+
+/*!
+    Reimplementation of ProgressWidget::setRange(). The current value is mapped
+    to the new range in the next frame.
+*/
+void ProgressBar::setRange(qint64 minimum, qint64 maximum)
+{
+    m_impl->setRange(minimum, maximum);
+    requestRender();
+}
+
+/*!
+    Reimplementation of ProgressWidget::setState()
+*/
+void ProgressBar::setState(TaskState state)
 {
-    m_impl->m_progressBar->setValue(value);
+    if (state == TaskState::Queued)
+    {
+        m_impl->m_progressBar->setValue(m_impl->m_progressBar->minimum());
+        m_impl->m_progressBar->setFormat(tr("Waiting..."));
+    }
+    else
+        m_impl->m_progressBar->resetFormat();
 }
 
 /*!
-    Reimplementation of ProgressWidget::setRange()
+    Reimplementation of ProgressWidget::renderPendingState()
 */
-void ProgressBar::setRange(int minimum, int maximum)
+void ProgressBar::renderPendingState()
 {
-    m_impl->m_progressBar->setRange(minimum, maximum);
+    m_impl->m_progressBar->setValue(m_impl->toBarValue(m_impl->m_value));
 }
 
 }
@@ -1,133 +1,34 @@
 #include "ProgressEstimate.h"
+#include "DurationFormatter.h"
 
 #include <QLabel>
 #include <QGridLayout>
-#include <QCoreApplication>
 
 namespace APD
 {
 
-/*!
-    \class DurationFormatter
-    \brief Helper class which formats time duration into desired format.
-*/
-
-class DurationFormatter
-{
-    Q_DECLARE_TR_FUNCTIONS(DurationFormatter)
-public:
-
-    /*!
-      Constructs a new duration formatter object.
-    */
-    template<class T>
-    DurationFormatter(T dur)
-    {
-        using namespace std::chrono;
-        using days = duration<long, std::ratio<3600 * 24>>;
-        auto d = duration_cast<days>(dur);
-        auto h = duration_cast<hours>(dur -= d);
-        auto m = duration_cast<minutes>(dur -= h);
-        auto s = duration_cast<seconds>(dur -= m);
-        auto ms = duration_cast<milliseconds>(dur -= s);
-
-        m_days = d.count();
-        m_hours = h.count();
-        m_minutes = m.count();
-        m_seconds = static_cast<int>(s.count());
-        m_milliseconds = static_cast<int>(ms.count());
-    }
-
-    QString approximate() const;
-    QString exact() const;
-
-private:
-    QString fromatQuantity(int q, const QString& s) const { return QString("%1 %2%3").arg(q).arg(s).arg(q != 1 ? "s" : ""); }
-    QString formatDays() const { return fromatQuantity(m_days, "day"); }
-    QString formatHours() const { return fromatQuantity(m_hours, "hour"); }
-    QString formatMinutes() const { return fromatQuantity(m_minutes, "minute"); }
-    QString formatSeconds() const { return fromatQuantity(m_seconds, "second"); }
-    QString formatMilliseconds() const { return fromatQuantity(m_milliseconds, "millisecond"); }
-
-    int m_days = 0;
-    int m_hours = 0;
-    int m_minutes = 0;
-    int m_seconds = 0;
-    int m_milliseconds = 0;
-};
-
-/*!
-    Return approximate representation of time (days to seconds). Lower resolution than seconds is ignored.
-*/
-QString DurationFormatter::approximate() const
-{
-    if (m_days > 0)
-        return QString("About %1 and %2").arg(formatDays(), formatHours());
-    else if (m_hours > 0)
-        return QString("About %1 and %2").arg(formatHours(), formatMinutes());
-    else if (m_minutes > 0)
-    {
-        auto str = QString("About %1").arg(formatMinutes());
-        if (m_minutes < 5 && m_seconds > 30)
-            str += tr(" and 30 seconds");
-        return str;
-    }
-    else
-    {
-        if (m_seconds > 45)
-            return tr("Less than 1 minute");
-        else if (m_seconds > 30)
-            return tr("Less than 45 seconds");
-        else if (m_seconds > 15)
-            return tr("Less than 30 seconds");
-        else if (m_seconds > 10)
-            return tr("Less than 15 seconds");
-        else if (m_seconds > 5)
-            return tr("Less than 10 seconds");
-        else
-            return tr("Less than 5 seconds");
-    }
-}
-
-/*!
-    Return exact time string (days to seconds). Lower resolution than seconds is ignored.
-*/
-QString DurationFormatter::exact() const
-{
-    QStringList str;
-    if (m_days > 0)
-        str << formatDays();
-    if (m_hours > 0)
-        str << formatHours();
-    if (m_minutes > 0)
-        str << formatMinutes();
-    str << formatSeconds();
-    return str.join(", ");
-}
-
-
 class ProgressEstimate::Impl
 {
     friend class ProgressEstimate;
 public:
     Impl(ProgressEstimate* parent);
 
-    void setValue(int value, const TimeStamp& timeStamp);
-    void setRange(int minimum, int maximum);
+    bool setValue(qint64 value, const TimeStamp& timeStamp);
+    void setRange(qint64 minimum, qint64 maximum);
 
 private:
     void updateWidgets();
 
 private:
     std::chrono::time_point<std::chrono::steady_clock> m_firstTimeStamp;
-    int m_firstValue;
     bool m_initialized = false;
+    std::unique_ptr<RemainingTimeEstimator> m_estimator = std::make_unique<AverageRateEstimator>();
+    std::optional<RemainingTimeEstimator::Estimate> m_estimate;
 
-    int m_minimum = 0;
-    int m_maximum = 0;
+    qint64 m_minimum = 0;
+    qint64 m_maximum = 0;
 
-    std::chrono::milliseconds m_elapsedTime;
-    std::chrono::milliseconds m_remainingTime;
+    std::chrono::milliseconds m_elapsedTime { 0 };
 
     QLabel* m_elapsedTimeLabel;
     QLabel* m_remainingTimeLabel;
@@ -153,33 +54,30 @@ ProgressEstimate::Impl::Impl(ProgressEstimate* parent)
     layout->addWidget(m_remainingTimeText, 1, 1);
 }
 
-void ProgressEstimate::Impl::setValue(int value, const TimeStamp& timeStamp)
+// returns false for the first sample, which the times are measured from
+bool ProgressEstimate::Impl::setValue(qint64 value, const TimeStamp& timeStamp)
 {
     using namespace std::chrono;
 
+    m_estimator->addSample(value, timeStamp);
     if (!m_initialized)
     {
         m_firstTimeStamp = timeStamp;
-        m_firstValue = value;
         m_initialized = true;
-        return;
+        return false;
     }
 
     m_elapsedTime = duration_cast<milliseconds>(timeStamp - m_firstTimeStamp);
     if (m_maximum - m_minimum > 0)
     {
-        auto stepDelta = value - m_firstValue;
-        auto fullRange = m_maximum - m_firstValue;
-        if (fullRange == 0)
-            return;
-
-        auto totalTime = (m_elapsedTime * fullRange) / stepDelta;
-        m_remainingTime = totalTime - m_elapsedTime;
+        // keep the last estimate while the estimator can't tell
+        if (auto estimate = m_estimator->estimate(m_maximum))
+            m_estimate = estimate;
     }
-    updateWidgets();
+    return true;
 }
 
-void ProgressEstimate::Impl::setRange(int minimum, int maximum)
+void ProgressEstimate::Impl::setRange(qint64 minimum, qint64 maximum)
 {
     m_minimum = minimum;
     m_maximum = maximum;
@@ -188,9 +86,18 @@ void ProgressEstimate::Impl::setRange(int minimum, int maximum)
 void ProgressEstimate::Impl::updateWidgets()
 {
     DurationFormatter elapsed(m_elapsedTime);
-    DurationFormatter remaining(m_remainingTime);
+    DurationFormatter remaining(m_estimate ? m_estimate->m_remaining : std::chrono::milliseconds(0));
     m_elapsedTimeText->setText(m_elapsedTimeFormat == Approximate ? elapsed.approximate() : elapsed.exact());
     m_remainingTimeText->setText(m_remainingTimeFormat == Approximate ? remaining.approximate() : remaining.exact());
+
+    if (m_estimate && m_estimate->m_hasConfidence)
+    {
+        DurationFormatter lower(m_estimate->m_lower);
+        DurationFormatter upper(m_estimate->m_upper);
+        m_remainingTimeText->setToolTip(tr("Between %1 and %2").arg(lower.exact(), upper.exact()));
+    }
+    else
+        m_remainingTimeText->setToolTip(QString());
 }
 
 
@@ -210,6 +117,12 @@ void ProgressEstimate::Impl::updateWidgets()
     (e.g. Less than 30 seconds). Default format for elapsed time is TimeFormat::Exact and for remaining
     time it is TimeFormat::Approximate.
 
+    The remaining time is extrapolated by a RemainingTimeEstimator set by setEstimator().
+    The default AverageRateEstimator assumes a constant rate since the first update. Tasks
+    with a slow start or a changing throughput are estimated better by MovingRateEstimator,
+    WindowRegressionEstimator or AlphaBetaEstimator. If the estimator reports a confidence
+    band, it is shown as a tool tip of the remaining time.
+
     \enum ProgressEstimate::TimeFormat
     Specifies how the elapsed and remaining time should be displayed.
 
@@ -372,21 +285,58 @@ void ProgressEstimate::setElapsedTimeFormat(ProgressEstimate::TimeFormat format)
     }
 }
 
+/*!
+    Returns the strategy used to estimate the remaining time.
+
+    The default is AverageRateEstimator.
+
+    \sa setEstimator()
+*/
+RemainingTimeEstimator* ProgressEstimate::estimator() const
+{
+    return m_impl->m_estimator.get();
+}
+
+/*!
+    Sets the strategy used to estimate the remaining time to \a estimator.
+    The estimator should be set before the task starts, as it only gets
+    the progress values reported afterwards.
+
+    The ownership of \a estimator is transferred to the widget.
+
+    \sa estimator()
+*/
+void ProgressEstimate::setEstimator(RemainingTimeEstimator* estimator)
+{
+    assert(estimator);
+    m_impl->m_estimator.reset(estimator);
+    m_impl->m_estimate.reset();
+}
+
 /*!
     Reimplementation of ProgressWidget::setValue()
 */
-void ProgressEstimate::setValue(int value, const QVariant&, const TimeStamp& timeStamp)
+void ProgressEstimate::setValue(qint64 value, const QVariant&, const TimeStamp& timeStamp)
 {
-    m_impl->setValue(value, timeStamp);
+    if (m_impl->setValue(value, timeStamp))
+        requestRender();
 }
 
 /*!
     Reimplementation of ProgressWidget::setRange()
 */
-void ProgressEstimate::setRange(int minimum, int maximum)
+void ProgressEstimate::setRange(qint64 minimum, qint64 maximum)
 {
     m_impl->setRange(minimum, maximum);
 }
 
+/*!
+    Reimplementation of ProgressWidget::renderPendingState()
+*/
+void ProgressEstimate::renderPendingState()
+{
+    m_impl->updateWidgets();
+}
+
 
 };
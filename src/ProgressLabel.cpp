@@ -15,6 +15,7 @@ public:
 
 private:
     QLabel* m_label;
+    QString m_text;
 };
 
 ProgressLabel::Impl::Impl(ProgressLabel* parent)
@@ -57,7 +58,25 @@ QLabel* ProgressLabel::label() const
 */
 void ProgressLabel::setText(const QString& text)
 {
-    m_impl->m_label->setText(text);
+    m_impl->m_text = text;
+    requestRender();
+}
+
+/*!
+    Reimplementation of ProgressWidget::setTextBatch(). Only the last text is shown.
+*/
+void ProgressLabel::setTextBatch(const QStringList& texts)
+{
+    if (!texts.isEmpty())
+        setText(texts.last());
+}
+
+/*!
+    Reimplementation of ProgressWidget::renderPendingState()
+*/
+void ProgressLabel::renderPendingState()
+{
+    m_impl->m_label->setText(m_impl->m_text);
 }
 
 }
@@ -0,0 +1,378 @@
+#include "ProgressLogView.h"
+#include "ProgressBar.h"
+#include "FunctionThread.h"
+#include "MappedLog.h"
+#include "LogViewport.h"
+
+#include <QCheckBox>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QLineEdit>
+#include <QRegularExpression>
+#include <QVBoxLayout>
+
+#include <vector>
+
+namespace APD
+{
+
+class ProgressLogView::Impl
+{
+    friend class ProgressLogView;
+
+public:
+    Impl(ProgressLogView* parent);
+    ~Impl();
+
+    void appendLines(const QStringList& lines);
+    void cancelFind();
+    void findFromEdit();
+    void finishFind();
+    void showMatch(qint64 index);
+
+private:
+    ProgressLogView* m_parent;
+    LogViewport* m_viewport;
+    QLineEdit* m_findEdit;
+    QCheckBox* m_ignoreCaseBox;
+    QCheckBox* m_regularExpressionBox;
+    ProgressBar* m_findProgress;
+    QLabel* m_matchLabel;
+
+    QString m_logFileName;
+    std::unique_ptr<MappedLog> m_log;      // created with the first line
+
+    using FindThread = FunctionThread<std::vector<qint64>>;
+    std::unique_ptr<FindThread> m_findThread;
+    QString m_findPattern;
+    FindOptions m_findOptions;
+    std::vector<qint64> m_matches;
+    qint64 m_currentMatch = -1;
+};
+
+ProgressLogView::Impl::Impl(ProgressLogView* parent)
+    : m_parent(parent)
+{
+    m_viewport = new LogViewport(parent);
+
+    m_findEdit = new QLineEdit(parent);
+    m_findEdit->setPlaceholderText(ProgressLogView::tr("Find"));
+    m_findEdit->setClearButtonEnabled(true);
+    m_ignoreCaseBox = new QCheckBox(ProgressLogView::tr("Ignore case"), parent);
+    m_regularExpressionBox = new QCheckBox(ProgressLogView::tr("Regular expression"), parent);
+    m_findProgress = new ProgressBar(parent);
+    m_findProgress->hide();
+    m_matchLabel = new QLabel(parent);
+
+    auto findLayout = new QHBoxLayout();
+    findLayout->addWidget(m_findEdit, 1);
+    findLayout->addWidget(m_ignoreCaseBox);
+    findLayout->addWidget(m_regularExpressionBox);
+    findLayout->addWidget(m_findProgress);
+    findLayout->addWidget(m_matchLabel);
+
+    auto layout = new QVBoxLayout(parent);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addWidget(m_viewport, 1);
+    layout->addLayout(findLayout);
+
+    QObject::connect(m_findEdit, &QLineEdit::returnPressed, parent, [this]() { findFromEdit(); });
+}
+
+ProgressLogView::Impl::~Impl()
+{
+    // the search reads the mapped log
+    cancelFind();
+}
+
+void ProgressLogView::Impl::appendLines(const QStringList& lines)
+{
+    if (!m_log)
+    {
+        m_log = std::make_unique<MappedLog>(m_logFileName);
+        m_viewport->setLog(m_log.get());
+    }
+    m_log->append(lines);
+}
+
+void ProgressLogView::Impl::cancelFind()
+{
+    if (!m_findThread)
+        return;
+
+    m_findThread->cancel();
+    m_findThread->wait();
+    m_findThread.reset();
+    m_findProgress->hide();
+}
+
+void ProgressLogView::Impl::findFromEdit()
+{
+    FindOptions options = NoFindOption;
+    if (m_ignoreCaseBox->isChecked())
+        options |= CaseInsensitive;
+    if (m_regularExpressionBox->isChecked())
+        options |= RegularExpression;
+
+    // pressing Enter again steps through the matches
+    auto pattern = m_findEdit->text();
+    if (!m_findThread && !m_matches.empty() && pattern == m_findPattern && options == m_findOptions)
+        m_parent->findNext();
+    else
+        m_parent->find(pattern, options);
+}
+
+void ProgressLogView::Impl::finishFind()
+{
+    auto result = m_findThread->takeResult();
+    m_matches = result ? std::move(*result) : std::vector<qint64>();
+
+    // called by a signal of the thread, it can't be deleted right away
+    m_findThread.release()->deleteLater();
+    m_findProgress->hide();
+
+    if (m_matches.empty())
+        m_matchLabel->setText(ProgressLogView::tr("No matches"));
+    else
+        showMatch(0);
+
+    emit m_parent->findFinished(static_cast<qint64>(m_matches.size()));
+}
+
+void ProgressLogView::Impl::showMatch(qint64 index)
+{
+    m_currentMatch = index;
+    auto line = m_matches[static_cast<size_t>(index)];
+    m_viewport->setHighlightedLine(line);
+    m_viewport->scrollToLine(line);
+    m_matchLabel->setText(ProgressLogView::tr("%1 of %2").arg(index + 1).arg(m_matches.size()));
+}
+
+/*!
+    \class ProgressLogView
+    \brief A viewer of large task output, which can be added to AsyncProgressDialog.
+
+    The view shows progress texts as set by TaskThread::setText() method, like ProgressOutput,
+    but it is meant for output too large for a QPlainTextEdit. The texts are stored as UTF-8
+    lines in an append-only memory-mapped file (a temporary file unless setLogFileName() is
+    called) with a sparse index of line positions, which is extended as the text arrives.
+    The view paints only the visible lines, so neither scrolling nor appending gets slower
+    as the log grows, and the memory used is mostly the file cache, which the system can
+    reclaim.
+
+    A find bar below the view searches the log for a substring or a regular expression.
+    The search runs in a separate thread and its progress is shown next to the find bar, so
+    even searching a log of several gigabytes doesn't block the GUI. Lines added during the
+    search aren't searched. Pressing Enter again, or calling findNext() and findPrevious(),
+    steps through the matching lines.
+
+    \sa ProgressOutput
+*/
+
+/*!
+    \enum ProgressLogView::FindOption
+
+    Options of find().
+
+    \var ProgressLogView::NoFindOption
+    A case sensitive substring search, which is done directly in the UTF-8 bytes.
+
+    \var ProgressLogView::CaseInsensitive
+    The case of letters is ignored.
+
+    \var ProgressLogView::RegularExpression
+    The pattern is a QRegularExpression.
+*/
+
+/*!
+    Constructs a log view with the given \a parent.
+*/
+ProgressLogView::ProgressLogView(QWidget *parent)
+    : ProgressWidget(parent)
+    , m_impl(std::make_unique<Impl>(this))
+{
+}
+
+ProgressLogView::~ProgressLogView() = default;
+
+/*!
+    Returns the name of the file the log is stored in, or an empty string if a temporary
+    file is used.
+
+    \sa setLogFileName()
+*/
+QString ProgressLogView::logFileName() const
+{
+    return m_impl->m_logFileName;
+}
+
+/*!
+    Sets the name of the file the log is stored in to \a fileName. The file is overwritten
+    and kept after the view is destroyed. Note that the file is allocated in segments of
+    64 MiB, the unused end of a segment is filled with zero bytes. Must be set before any
+    text is added.
+
+    \sa logFileName()
+*/
+void ProgressLogView::setLogFileName(const QString& fileName)
+{
+    m_impl->m_logFileName = fileName;
+}
+
+/*!
+    Returns the number of lines in the log.
+*/
+qint64 ProgressLogView::lineCount() const
+{
+    return m_impl->m_log ? m_impl->m_log->lineCount() : 0;
+}
+
+/*!
+    Returns the text of the \a line.
+*/
+QString ProgressLogView::line(qint64 line) const
+{
+    if (line < 0 || line >= lineCount())
+        return QString();
+    return m_impl->m_log->lineAt(m_impl->m_log->lineStart(line));
+}
+
+/*!
+    Scrolls the view so that the \a line is visible.
+*/
+void ProgressLogView::scrollToLine(qint64 line)
+{
+    m_impl->m_viewport->scrollToLine(line);
+}
+
+/*!
+    Starts searching the log for lines matching \a pattern according to \a options.
+    A search in progress is canceled. When the search finishes, findFinished() is emitted
+    and the first matching line is shown.
+
+    \sa findNext(), findPrevious(), cancelFind()
+*/
+void ProgressLogView::find(const QString& pattern, FindOptions options)
+{
+    cancelFind();
+    m_impl->m_findPattern = pattern;
+    m_impl->m_findOptions = options;
+    m_impl->m_matches.clear();
+    m_impl->m_currentMatch = -1;
+    m_impl->m_viewport->setHighlightedLine(-1);
+    m_impl->m_matchLabel->clear();
+
+    if (pattern.isEmpty())
+        return;
+
+    bool regularExpression = options.testFlag(RegularExpression);
+    if (regularExpression && !QRegularExpression(pattern).isValid())
+    {
+        m_impl->m_matchLabel->setText(tr("Invalid expression"));
+        return;
+    }
+
+    if (!m_impl->m_log)
+    {
+        m_impl->m_matchLabel->setText(tr("No matches"));
+        emit findFinished(0);
+        return;
+    }
+
+    auto caseSensitivity = options.testFlag(CaseInsensitive) ? Qt::CaseInsensitive : Qt::CaseSensitive;
+    auto snapshot = m_impl->m_log->snapshot();
+    auto thread = new Impl::FindThread([=](TaskThread* task) {
+        return MappedLog::search(snapshot, pattern, regularExpression, caseSensitivity, task);
+    });
+    m_impl->m_findThread.reset(thread);
+
+    // the thread is the context, so no signal is delivered after it is canceled
+    auto progress = m_impl->m_findProgress;
+    connect(thread, &TaskThread::rangeChanged, progress, &ProgressBar::setRange);
+    connect(thread, &TaskThread::valueChanged, progress, &ProgressBar::setValue);
+    connect(thread, &QThread::finished, thread, [this]() { m_impl->finishFind(); });
+
+    progress->setRange(0, 0);
+    progress->show();
+    thread->start();
+}
+
+/*!
+    Cancels the search in progress, if any. findFinished() isn't emitted.
+*/
+void ProgressLogView::cancelFind()
+{
+    m_impl->cancelFind();
+}
+
+/*!
+    Returns true while a search is in progress.
+*/
+bool ProgressLogView::isFinding() const
+{
+    return m_impl->m_findThread != nullptr;
+}
+
+/*!
+    Returns the number of lines matching the last search.
+*/
+qint64 ProgressLogView::matchCount() const
+{
+    return static_cast<qint64>(m_impl->m_matches.size());
+}
+
+/*!
+    Shows the next line matching the last search.
+*/
+void ProgressLogView::findNext()
+{
+    auto count = matchCount();
+    if (count > 0)
+        m_impl->showMatch((m_impl->m_currentMatch + 1) % count);
+}
+
+/*!
+    Shows the previous line matching the last search.
+*/
+void ProgressLogView::findPrevious()
+{
+    auto count = matchCount();
+    if (count > 0)
+        m_impl->showMatch(m_impl->m_currentMatch <= 0 ? count - 1 : m_impl->m_currentMatch - 1);
+}
+
+/*!
+    \fn void ProgressLogView::findFinished(qint64 matchCount)
+
+    This signal is emitted when a search started by find() finishes with \a matchCount
+    matching lines.
+*/
+
+/*!
+    Reimplementation of ProgressWidget::setText(). The text is added to the log right away,
+    the view is updated in the next frame.
+*/
+void ProgressLogView::setText(const QString& text)
+{
+    m_impl->appendLines(text.split('\n'));
+    requestRender();
+}
+
+/*!
+    Reimplementation of ProgressWidget::setTextBatch()
+*/
+void ProgressLogView::setTextBatch(const QStringList& texts)
+{
+    m_impl->appendLines(texts.join('\n').split('\n'));
+    requestRender();
+}
+
+/*!
+    Reimplementation of ProgressWidget::renderPendingState()
+*/
+void ProgressLogView::renderPendingState()
+{
+    m_impl->m_viewport->updateScrollBars();
+}
+
+}
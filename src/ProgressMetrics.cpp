@@ -0,0 +1,90 @@
+#include "ProgressMetrics.h"
+
+#include <algorithm>
+
+namespace APD
+{
+
+/*!
+    \class MetricsLayout
+    \brief Describes the fields of a metrics struct reported by TaskThread::setMetrics().
+
+    A task reporting several quantities at once (e.g. bytes, items and errors) defines
+    a plain struct with arithmetic data members and a layout naming the members:
+
+    \code
+    struct CopyMetrics
+    {
+        qint64 bytes;
+        qint64 files;
+    };
+
+    static const APD::MetricsLayout s_copyLayout {
+        APD::metricsField<&CopyMetrics::bytes>("bytes"),
+        APD::metricsField<&CopyMetrics::files>("files"),
+    };
+    \endcode
+
+    Progress widgets bind to the fields by name, e.g. ProgressVelocityPlot::setQuantityField().
+    The name is resolved to an index once per layout, afterwards a field is read by a single
+    call through a function pointer. The layout must outlive all metrics referring to it,
+    typically it is a static object.
+
+    \sa ProgressMetrics
+*/
+
+/*!
+    Constructs a layout of the given \a fields. All fields must be members of the same struct.
+*/
+MetricsLayout::MetricsLayout(std::initializer_list<Field> fields)
+    : m_fields(fields)
+{
+    if (!m_fields.empty())
+        m_typeTag = m_fields.front().m_typeTag;
+
+    assert(std::all_of(m_fields.begin(), m_fields.end(), [this](const Field& field) { return field.m_typeTag == m_typeTag; }));
+}
+
+/*!
+    Returns the number of fields.
+*/
+int MetricsLayout::fieldCount() const
+{
+    return static_cast<int>(m_fields.size());
+}
+
+/*!
+    Returns the name of the field at \a index.
+*/
+QString MetricsLayout::fieldName(int index) const
+{
+    return m_fields[static_cast<size_t>(index)].m_name;
+}
+
+/*!
+    Returns the index of the field called \a name, or -1 if there is no such field.
+*/
+int MetricsLayout::indexOf(const QString& name) const
+{
+    auto it = std::find_if(m_fields.begin(), m_fields.end(), [&name](const Field& field) { return field.m_name == name; });
+    return it == m_fields.end() ? -1 : static_cast<int>(it - m_fields.begin());
+}
+
+/*!
+    \fn double MetricsLayout::read(int index, const void* data) const
+
+    Returns the field at \a index of the struct at \a data converted to double.
+*/
+
+/*!
+    \class ProgressMetrics
+    \brief A fixed-size copy of a metrics struct passed from TaskThread to progress widgets.
+
+    Unlike the QVariant user value of TaskThread::setValue(), the metrics are stored inline
+    in a fixed buffer together with a pointer to their MetricsLayout. Storing, delivering
+    and reading the metrics neither allocates memory nor looks up a meta type.
+
+    \sa TaskThread::setMetrics(), ProgressWidget::setMetrics()
+*/
+
+}
@@ -1,7 +1,13 @@
 #include "ProgressOutput.h"
+#include "OutputLog.h"
 
 #include <QPlainTextEdit>
+#include <QScrollBar>
+#include <QTextCursor>
 #include <QHBoxLayout>
+#include <QFile>
+
+#include <algorithm>
 
 namespace APD
 {
@@ -13,8 +19,28 @@ class ProgressOutput::Impl
 public:
     Impl(ProgressOutput* parent);
 
+    void addTexts(const QStringList& texts);
+    void pageIfNeeded(int scrollValue);
+
+private:
+    void appendLines(const QStringList& lines);
+    void prependLines(const QStringList& lines);
+    void removeFirstLines(int count);
+    void removeLastLines(int count);
+    void createLog();
+
 private:
     QPlainTextEdit* m_output;
+    QStringList m_pendingTexts;     // texts to be appended in the next frame
+
+    // With a limited scrollback, the document is a window of the lines in m_log
+    int m_maximumLineCount = 0;
+    QString m_spillFileName;
+    bool m_spillCompressed = false;
+    std::unique_ptr<OutputLog> m_log;
+    qint64 m_firstLine = 0;         // line of the log shown as the first line of the document
+    int m_windowLines = 0;          // lines in the document
+    bool m_paging = false;
 };
 
 
@@ -26,6 +52,155 @@ ProgressOutput::Impl::Impl(ProgressOutput* parent)
     auto layout = new QHBoxLayout(parent);
     layout->setContentsMargins(0, 0, 0, 0);
     layout->addWidget(m_output);
+
+    QObject::connect(m_output->verticalScrollBar(), &QScrollBar::valueChanged, parent,
+                     [this](int value) { pageIfNeeded(value); });
+}
+
+void ProgressOutput::Impl::addTexts(const QStringList& texts)
+{
+    auto scrollBar = m_output->verticalScrollBar();
+    bool atBottom = scrollBar->value() == scrollBar->maximum();
+
+    if (m_maximumLineCount <= 0)
+    {
+        QTextCursor cursor(m_output->document());
+        cursor.movePosition(QTextCursor::End);
+        cursor.beginEditBlock();
+        if (!m_output->document()->isEmpty())
+            cursor.insertBlock();
+        cursor.insertText(texts.join('\n'));
+        cursor.endEditBlock();
+    }
+    else
+    {
+        if (!m_log)
+            createLog();
+
+        // the log counts lines, i.e. document blocks
+        auto lines = texts.join('\n').split('\n');
+        bool windowAtEnd = m_firstLine + m_windowLines == m_log->lineCount();
+        m_log->append(lines);
+
+        // while the user browses older lines, the new ones go to the log only
+        if (windowAtEnd)
+        {
+            m_paging = true;
+            appendLines(lines);
+            if (m_windowLines > m_maximumLineCount)
+            {
+                auto excess = m_windowLines - m_maximumLineCount;
+                removeFirstLines(excess);
+                m_firstLine += excess;
+            }
+            m_paging = false;
+        }
+    }
+
+    // keep following the output as appendPlainText() does
+    if (atBottom)
+        scrollBar->setValue(scrollBar->maximum());
+}
+
+void ProgressOutput::Impl::pageIfNeeded(int scrollValue)
+{
+    if (!m_log || m_paging)
+        return;
+
+    auto scrollBar = m_output->verticalScrollBar();
+    auto pageSize = std::max(1, m_maximumLineCount / 4);
+    auto windowEnd = m_firstLine + m_windowLines;
+    m_paging = true;
+
+    if (scrollValue == scrollBar->minimum() && m_firstLine > 0)
+    {
+        // page in older lines and drop the newest ones
+        auto count = static_cast<int>(std::min<qint64>(pageSize, m_firstLine));
+        prependLines(m_log->lines(m_firstLine - count, count));
+        m_firstLine -= count;
+        if (m_windowLines > m_maximumLineCount)
+            removeLastLines(m_windowLines - m_maximumLineCount);
+        scrollBar->setValue(scrollBar->minimum() + count);
+    }
+    else if (scrollValue == scrollBar->maximum() && windowEnd < m_log->lineCount())
+    {
+        // page in newer lines and drop the oldest ones
+        auto count = static_cast<int>(std::min<qint64>(pageSize, m_log->lineCount() - windowEnd));
+        appendLines(m_log->lines(windowEnd, count));
+        if (m_windowLines > m_maximumLineCount)
+        {
+            auto excess = m_windowLines - m_maximumLineCount;
+            removeFirstLines(excess);
+            m_firstLine += excess;
+        }
+        scrollBar->setValue(scrollBar->maximum() - count);
+    }
+
+    m_paging = false;
+}
+
+void ProgressOutput::Impl::appendLines(const QStringList& lines)
+{
+    if (lines.isEmpty())
+        return;
+
+    QTextCursor cursor(m_output->document());
+    cursor.movePosition(QTextCursor::End);
+    cursor.beginEditBlock();
+    if (m_windowLines > 0)
+        cursor.insertBlock();
+    cursor.insertText(lines.join('\n'));
+    cursor.endEditBlock();
+    m_windowLines += lines.size();
+}
+
+void ProgressOutput::Impl::prependLines(const QStringList& lines)
+{
+    if (lines.isEmpty())
+        return;
+
+    QTextCursor cursor(m_output->document());
+    cursor.movePosition(QTextCursor::Start);
+    cursor.beginEditBlock();
+    cursor.insertText(lines.join('\n'));
+    if (m_windowLines > 0)
+        cursor.insertBlock();
+    cursor.endEditBlock();
+    m_windowLines += lines.size();
+}
+
+void ProgressOutput::Impl::removeFirstLines(int count)
+{
+    QTextCursor cursor(m_output->document());
+    cursor.movePosition(QTextCursor::Start);
+    cursor.movePosition(QTextCursor::NextBlock, QTextCursor::KeepAnchor, count);
+    cursor.removeSelectedText();
+    m_windowLines -= count;
+}
+
+void ProgressOutput::Impl::removeLastLines(int count)
+{
+    QTextCursor cursor(m_output->document());
+    cursor.movePosition(QTextCursor::End);
+    cursor.movePosition(QTextCursor::PreviousBlock, QTextCursor::KeepAnchor, count);
+    cursor.movePosition(QTextCursor::EndOfBlock, QTextCursor::KeepAnchor);
+    cursor.removeSelectedText();
+    m_windowLines -= count;
+}
+
+void ProgressOutput::Impl::createLog()
+{
+    m_log = std::make_unique<OutputLog>(m_spillFileName, m_spillCompressed);
+
+    // the text shown so far starts the log
+    auto document = m_output->document();
+    if (!document->isEmpty())
+    {
+        auto lines = document->toPlainText().split('\n');
+        m_log->append(lines);
+        m_windowLines = lines.size();
+    }
+    m_firstLine = 0;
 }
 
 /*!
@@ -35,6 +210,13 @@ ProgressOutput::Impl::Impl(ProgressOutput* parent)
     The plain text edit shows progress text as set by TaskThread::setText() method. It keeps
     the previous texts in the widget and scrolls down as new text is added. The edit is read-only
     by default.
+
+    By default, all lines are kept in memory. Long running tasks producing a lot of output
+    should limit the scrollback by setMaximumLineCount(). The lines are then also written
+    to a spill file by a background thread and only the newest lines are kept in the edit.
+    When the user scrolls to the top of the edit, older lines are paged in from the file and
+    the newest ones are dropped, and vice versa at the bottom. While older lines are shown,
+    new lines are only written to the file. The whole history can be saved by exportText().
 */
 
 /*!
@@ -61,7 +243,122 @@ QPlainTextEdit* ProgressOutput::plainTextEdit() const
 */
 void ProgressOutput::setText(const QString& text)
 {
-    m_impl->m_output->appendPlainText(text);
+    m_impl->m_pendingTexts.append(text);
+    requestRender();
+}
+
+/*!
+    Reimplementation of ProgressWidget::setTextBatch()
+*/
+void ProgressOutput::setTextBatch(const QStringList& texts)
+{
+    m_impl->m_pendingTexts.append(texts);
+    requestRender();
+}
+
+/*!
+    Reimplementation of ProgressWidget::renderPendingState(). All texts received since
+    the last frame are appended by a single edit of the document, i.e. the document
+    is laid out only once.
+*/
+void ProgressOutput::renderPendingState()
+{
+    if (m_impl->m_pendingTexts.isEmpty())
+        return;
+
+    auto texts = std::move(m_impl->m_pendingTexts);
+    m_impl->m_pendingTexts.clear();
+    m_impl->addTexts(texts);
+}
+
+/*!
+    Returns the maximum number of lines kept in memory, or zero if the number
+    is not limited.
+
+    The default is zero.
+
+    \sa setMaximumLineCount()
+*/
+int ProgressOutput::maximumLineCount() const
+{
+    return m_impl->m_maximumLineCount;
+}
+
+/*!
+    Sets the maximum number of lines kept in memory to \a count. Older lines are
+    written to the spill file and paged in when the user scrolls back. Zero means
+    no limit and no spill file. The limit should be set before any text is added.
+
+    \sa maximumLineCount(), setSpillFileName()
+*/
+void ProgressOutput::setMaximumLineCount(int count)
+{
+    m_impl->m_maximumLineCount = std::max(0, count);
+}
+
+/*!
+    Returns the name of the file the lines are spilled to.
+
+    The default is an empty string, i.e. a temporary file, which is removed
+    with the widget.
+
+    \sa setSpillFileName()
+*/
+QString ProgressOutput::spillFileName() const
+{
+    return m_impl->m_spillFileName;
+}
+
+/*!
+    Sets the name of the file the lines are spilled to to \a fileName. The file is
+    overwritten and kept after the widget is destroyed. Must be set before any text
+    is added.
+
+    \sa spillFileName(), setMaximumLineCount()
+*/
+void ProgressOutput::setSpillFileName(const QString& fileName)
+{
+    m_impl->m_spillFileName = fileName;
+}
+
+/*!
+    Returns true if the spill file is compressed.
+
+    The default is false, i.e. the spill file is a plain UTF-8 text file.
+
+    \sa setSpillCompressed()
+*/
+bool ProgressOutput::isSpillCompressed() const
+{
+    return m_impl->m_spillCompressed;
+}
+
+/*!
+    Sets whether the spill file is \a compressed. The lines are compressed in
+    blocks by qCompress(). Must be set before any text is added.
+
+    \sa isSpillCompressed()
+*/
+void ProgressOutput::setSpillCompressed(bool compressed)
+{
+    m_impl->m_spillCompressed = compressed;
+}
+
+/*!
+    Writes all lines shown so far, including the lines spilled to disk, to the file
+    \a fileName as UTF-8 text. Returns false if the file can't be written.
+*/
+bool ProgressOutput::exportText(const QString& fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+        return false;
+
+    if (m_impl->m_log)
+        return m_impl->m_log->exportTo(&file);
+
+    auto data = m_impl->m_output->toPlainText().toUtf8();
+    return file.write(data) == data.size();
 }
 
 }
@@ -7,6 +7,9 @@
 #include <QGraphicsSimpleTextItem>
 #include <QHBoxLayout>
 
+#include <algorithm>
+#include <vector>
+
 namespace APD
 {
 
@@ -17,12 +20,40 @@ class ProgressVelocityPlot::Impl
 public:
     Impl(const QString& quantityUnits, ProgressVelocityPlot* parent);
 
-    void setValue(int value, const QVariant& userData, const TimeStamp& timeStamp);
-    void setRange(int minimum, int maximum);
+    void setValue(qint64 value, double quantity, bool hasQuantity, const TimeStamp& timeStamp);
+    void setTotal(qint64 value, double total, const TimeStamp& timeStamp);
+    int quantityFieldIndex(const ProgressMetrics& metrics);
+    void setRange(qint64 minimum, qint64 maximum);
+
+private:
+    void updatePlot();
+    void setVelocity(qint64 value, double velocity);
+    void addToHistory(qint64 value, double velocity);
+    void updateHistorySeries();
+    int bucketIndex(qint64 value) const;
+    double bucketValue(double index) const;
 
 private:
+    // The velocity history is kept in a fixed number of buckets spread over the progress range.
+    // Each bucket holds the minimum and maximum velocity, so the memory doesn't depend on the
+    // number of updates and spikes are never lost when buckets are merged into pixel columns.
+    static constexpr int s_bucketCount = 1024;
+
+    struct Bucket
+    {
+        double m_minimum = 0;
+        double m_maximum = 0;
+        bool m_used = false;
+    };
+
+    std::vector<Bucket> m_buckets = std::vector<Bucket>(s_bucketCount);
+    bool m_historyChanged = false;
+    int m_columnCount = 0;
+    QVector<QPointF> m_historyPoints;
+
     std::chrono::time_point<std::chrono::steady_clock> m_lastTimeStamp;
     bool m_initialized = false;
+    double m_lastTotal = 0;         // the cumulative quantity of the metrics at m_lastTimeStamp
 
     QtCharts::QChart* m_chart;
     QtCharts::QAreaSeries* m_progressSeries;
@@ -30,10 +61,21 @@ private:
     QtCharts::QLineSeries* m_currentVelocitySeries;
     QGraphicsSimpleTextItem* m_currentVelocity;
     double m_maxVelocity = 0;
+    double m_axisMaxVelocity = 0;
 
-    int m_minimum = 0;
-    int m_maximum = 0;
+    // the newest state, which is plotted by the next renderPendingState()
+    double m_velocity = 0;
+    qint64 m_value = 0;
+    bool m_plotChanged = false;
+
+    qint64 m_minimum = 0;
+    qint64 m_maximum = 0;
     QString m_quantityUnits;
+
+    // the metrics field bound by name, resolved once per layout
+    QString m_quantityField;
+    const MetricsLayout* m_boundLayout = nullptr;
+    int m_quantityFieldIndex = -1;
 };
 
 ProgressVelocityPlot::Impl::Impl(const QString& quantityUnits, ProgressVelocityPlot* parent)
@@ -77,7 +119,7 @@ ProgressVelocityPlot::Impl::Impl(const QString& quantityUnits, ProgressVelocityP
     layout->addWidget(chartView);
 }
 
-void ProgressVelocityPlot::Impl::setValue(int value, const QVariant& userData, const TimeStamp& timeStamp)
+void ProgressVelocityPlot::Impl::setValue(qint64 value, double quantity, bool hasQuantity, const TimeStamp& timeStamp)
 {
     using namespace std::chrono;
 
@@ -88,54 +130,173 @@ void ProgressVelocityPlot::Impl::setValue(int value, const QVariant& userData, c
         return;
     }
 
-    bool ok;
-    auto quantity = userData.toDouble(&ok);
     auto elapsedTime = duration_cast<milliseconds>(timeStamp - m_lastTimeStamp);
-    if (elapsedTime.count() > 0 && ok)
+    if (elapsedTime.count() > 0 && hasQuantity)
     {
         // compute the velocity, multiplied 1000 to convert from milliseconds to seconds
-        auto velocity = (1000 * quantity) / elapsedTime.count();
-        m_velocitySeries->upperSeries()->append(value, velocity);
-        if (velocity > m_maxVelocity)
-        {
-            m_maxVelocity = velocity;
-            m_chart->axes(Qt::Vertical).first()->setRange(0, m_maxVelocity * 1.1);
-        }
+        setVelocity(value, (1000 * quantity) / elapsedTime.count());
+    }
 
-        if (m_velocitySeries->upperSeries()->count() > 1)
-        {
-            // update progress series
-            m_progressSeries->upperSeries()->clear();
-            m_progressSeries->upperSeries()->append(m_minimum, m_maxVelocity * 1.1);
-            m_progressSeries->upperSeries()->append(value, m_maxVelocity * 1.1);
-
-            // update current velocity series
-            m_currentVelocitySeries->clear();
-            m_currentVelocitySeries->append(m_minimum, velocity);
-            m_currentVelocitySeries->append(m_maximum, velocity);
-
-            QString units;
-            if (!m_quantityUnits.isEmpty())
-                units = QString(" %1/s").arg(m_quantityUnits);
-            m_currentVelocity->setText(QString("%1%2").arg(velocity, 0, 'g', 3).arg(units));
-            QFontMetrics fm(m_currentVelocity->font());
-
-            auto point = m_chart->mapToPosition(QPointF(m_maximum, velocity), m_currentVelocitySeries);
-            auto pos = point - QPointF(fm.width(m_currentVelocity->text()) + 3, fm.height());
-            if (pos.y() < 10)
-                pos.ry() += fm.height();
-            m_currentVelocity->setPos(pos);
-        }
+    m_lastTimeStamp = timeStamp;
+}
+
+// the metrics may be coalesced, so the velocity is computed from the difference of the
+// cumulative quantity between the delivered samples rather than from a single update
+void ProgressVelocityPlot::Impl::setTotal(qint64 value, double total, const TimeStamp& timeStamp)
+{
+    using namespace std::chrono;
+
+    if (!m_initialized)
+    {
+        m_lastTimeStamp = timeStamp;
+        m_lastTotal = total;
+        m_initialized = true;
+        return;
     }
 
+    // a sample too close to the previous one is included in the next velocity
+    auto elapsedTime = duration_cast<milliseconds>(timeStamp - m_lastTimeStamp);
+    if (elapsedTime.count() <= 0)
+        return;
+
+    setVelocity(value, (1000 * (total - m_lastTotal)) / elapsedTime.count());
     m_lastTimeStamp = timeStamp;
+    m_lastTotal = total;
+}
+
+void ProgressVelocityPlot::Impl::setVelocity(qint64 value, double velocity)
+{
+    addToHistory(value, velocity);
+    m_maxVelocity = std::max(m_maxVelocity, velocity);
+    m_velocity = velocity;
+    m_value = value;
+    m_plotChanged = true;
+}
+
+int ProgressVelocityPlot::Impl::quantityFieldIndex(const ProgressMetrics& metrics)
+{
+    if (metrics.layout() != m_boundLayout)
+    {
+        m_boundLayout = metrics.layout();
+        m_quantityFieldIndex = m_boundLayout ? m_boundLayout->indexOf(m_quantityField) : -1;
+    }
+    return m_quantityFieldIndex;
 }
 
-void ProgressVelocityPlot::Impl::setRange(int minimum, int maximum)
+void ProgressVelocityPlot::Impl::updatePlot()
+{
+    if (!m_plotChanged)
+        return;
+    m_plotChanged = false;
+
+    auto axisY = m_chart->axes(Qt::Vertical).first();
+    if (m_maxVelocity != m_axisMaxVelocity)
+    {
+        m_axisMaxVelocity = m_maxVelocity;
+        axisY->setRange(0, m_maxVelocity * 1.1);
+    }
+
+    updateHistorySeries();
+    if (!m_historyPoints.isEmpty())
+    {
+        // update progress series
+        m_progressSeries->upperSeries()->replace(QVector<QPointF>{ { static_cast<double>(m_minimum), m_maxVelocity * 1.1 },
+                                                                   { static_cast<double>(m_value), m_maxVelocity * 1.1 } });
+
+        // update current velocity series
+        m_currentVelocitySeries->replace(QVector<QPointF>{ { static_cast<double>(m_minimum), m_velocity },
+                                                           { static_cast<double>(m_maximum), m_velocity } });
+
+        QString units;
+        if (!m_quantityUnits.isEmpty())
+            units = QString(" %1/s").arg(m_quantityUnits);
+        m_currentVelocity->setText(QString("%1%2").arg(m_velocity, 0, 'g', 3).arg(units));
+        QFontMetrics fm(m_currentVelocity->font());
+
+        auto point = m_chart->mapToPosition(QPointF(m_maximum, m_velocity), m_currentVelocitySeries);
+        auto pos = point - QPointF(fm.width(m_currentVelocity->text()) + 3, fm.height());
+        if (pos.y() < 10)
+            pos.ry() += fm.height();
+        m_currentVelocity->setPos(pos);
+    }
+}
+
+void ProgressVelocityPlot::Impl::setRange(qint64 minimum, qint64 maximum)
 {
     m_minimum = minimum;
     m_maximum = maximum;
-    m_chart->axes(Qt::Horizontal).first()->setRange(minimum + 1, maximum - 1);
+    m_chart->axes(Qt::Horizontal).first()->setRange(static_cast<double>(minimum) + 1, static_cast<double>(maximum) - 1);
+
+    // the buckets are bound to the range
+    std::fill(m_buckets.begin(), m_buckets.end(), Bucket());
+    m_historyChanged = true;
+}
+
+void ProgressVelocityPlot::Impl::addToHistory(qint64 value, double velocity)
+{
+    auto& bucket = m_buckets[static_cast<size_t>(bucketIndex(value))];
+    if (!bucket.m_used)
+        bucket = { velocity, velocity, true };
+    else if (velocity < bucket.m_minimum)
+        bucket.m_minimum = velocity;
+    else if (velocity > bucket.m_maximum)
+        bucket.m_maximum = velocity;
+    else
+        return;
+
+    m_historyChanged = true;
+}
+
+void ProgressVelocityPlot::Impl::updateHistorySeries()
+{
+    // at most one column of points per horizontal pixel of the plot
+    auto width = static_cast<int>(m_chart->plotArea().width());
+    auto columnCount = width > 0 ? std::min(width, s_bucketCount) : s_bucketCount;
+    if (!m_historyChanged && columnCount == m_columnCount)
+        return;
+
+    auto bucketsPerColumn = (s_bucketCount + columnCount - 1) / columnCount;
+    m_historyPoints.clear();
+    for (int first = 0; first < s_bucketCount; first += bucketsPerColumn)
+    {
+        auto last = std::min(first + bucketsPerColumn, s_bucketCount);
+        Bucket column;
+        for (auto i = first; i < last; i++)
+        {
+            auto& bucket = m_buckets[static_cast<size_t>(i)];
+            if (!bucket.m_used)
+                continue;
+            column.m_minimum = column.m_used ? std::min(column.m_minimum, bucket.m_minimum) : bucket.m_minimum;
+            column.m_maximum = column.m_used ? std::max(column.m_maximum, bucket.m_maximum) : bucket.m_maximum;
+            column.m_used = true;
+        }
+
+        if (!column.m_used)
+            continue;
+
+        auto x = bucketValue(0.5 * (first + last));
+        m_historyPoints.append(QPointF(x, column.m_minimum));
+        if (column.m_maximum > column.m_minimum)
+            m_historyPoints.append(QPointF(x, column.m_maximum));
+    }
+
+    m_velocitySeries->upperSeries()->replace(m_historyPoints);
+    m_historyChanged = false;
+    m_columnCount = columnCount;
+}
+
+int ProgressVelocityPlot::Impl::bucketIndex(qint64 value) const
+{
+    if (m_maximum <= m_minimum)
+        return 0;
+
+    auto ratio = (static_cast<double>(value) - m_minimum) / (static_cast<double>(m_maximum) - m_minimum);
+    return qBound(0, static_cast<int>(ratio * s_bucketCount), s_bucketCount - 1);
+}
+
+double ProgressVelocityPlot::Impl::bucketValue(double index) const
+{
+    return m_minimum + index * ((static_cast<double>(m_maximum) - m_minimum) / s_bucketCount);
 }
 
 
@@ -149,9 +310,19 @@ void ProgressVelocityPlot::Impl::setRange(int minimum, int maximum)
 
     The velocity is computed from the quantity passed as the second parameter in the
     setValue() method and from the elapsed time between this and the previous call to
-    setValue() method. The velocity unit is displayed in the form numerator/denominator,
+    setValue() method. The velocity history is kept with a fixed resolution over the progress
+    range and plotted with at most one column per pixel, where each column shows the lowest
+    and the highest velocity in it. The memory and the drawing cost are therefore the same
+    for tasks of any length. The velocity unit is displayed in the form numerator/denominator,
     where denominator is always seconds (s) and numerator is set by the quantityUnits()
     method. If quantity units are empty, no velocity unit is shown.
+
+    Tasks reporting ProgressMetrics by TaskThread::setMetrics() pass the quantity as a field
+    of the metrics instead. The field is selected by setQuantityField() and, unlike the
+    quantity of setValue(), it holds the cumulative quantity since the start of the task.
+    The quantity of setValue() is an increment, so it's only correct for a task in the
+    TaskThread::Immediate update mode; TaskThread::Coalesced mode drops the increments
+    of the updates between two refreshes of the dialog.
 */
 
 /*!
@@ -177,19 +348,44 @@ ProgressVelocityPlot::~ProgressVelocityPlot() = default;
 /*!
     Reimplementation of ProgressWidget::setValue()
 */
-void ProgressVelocityPlot::setValue(int value, const QVariant& userData, const TimeStamp& timeStamp)
+void ProgressVelocityPlot::setValue(qint64 value, const QVariant& userData, const TimeStamp& timeStamp)
+{
+    bool ok;
+    auto quantity = userData.toDouble(&ok);
+    m_impl->setValue(value, quantity, ok, timeStamp);
+    requestRender();
+}
+
+/*!
+    Reimplementation of ProgressWidget::setMetrics(). The quantity is read from the field
+    selected by setQuantityField().
+*/
+void ProgressVelocityPlot::setMetrics(qint64 value, const ProgressMetrics& metrics, const TimeStamp& timeStamp)
 {
-    m_impl->setValue(value, userData, timeStamp);
+    auto index = m_impl->quantityFieldIndex(metrics);
+    if (index >= 0)
+        m_impl->setTotal(value, metrics.field(index), timeStamp);
+    else
+        m_impl->setValue(value, 0, false, timeStamp);
+    requestRender();
 }
 
 /*!
     Reimplementation of ProgressWidget::setRange()
 */
-void ProgressVelocityPlot::setRange(int minimum, int maximum)
+void ProgressVelocityPlot::setRange(qint64 minimum, qint64 maximum)
 {
     m_impl->setRange(minimum, maximum);
 }
 
+/*!
+    Reimplementation of ProgressWidget::renderPendingState()
+*/
+void ProgressVelocityPlot::renderPendingState()
+{
+    m_impl->updatePlot();
+}
+
 /*!
     Return quantity units. The velocity units
     are the composed from the quantity units and per second
@@ -215,6 +411,37 @@ void ProgressVelocityPlot::setQuantityUnits(const QString& quantityUnits)
     m_impl->m_quantityUnits = quantityUnits;
 }
 
+/*!
+    Returns the name of the metrics field, from which the velocity is computed.
+
+    The default is an empty string, i.e. no field.
+
+    \sa setQuantityField()
+*/
+QString ProgressVelocityPlot::quantityField() const
+{
+    return m_impl->m_quantityField;
+}
+
+/*!
+    Sets the metrics field, from which the velocity is computed, to the field called
+    \a name in the MetricsLayout of the metrics.
+
+    The field must hold the cumulative quantity since the start of the task, e.g. the bytes
+    copied so far. The velocity is the difference of the field between two consecutive
+    metrics delivered to the widget, divided by the time between them. As the metrics are
+    coalesced (see TaskThread::setMetrics()), the updates dropped in between are still
+    accounted for.
+
+    \sa quantityField(), TaskThread::setMetrics()
+*/
+void ProgressVelocityPlot::setQuantityField(const QString& name)
+{
+    m_impl->m_quantityField = name;
+    m_impl->m_boundLayout = nullptr;
+    m_impl->m_quantityFieldIndex = -1;
+}
+
 /*!
     Return the flag whether the progress visualization should be displayed.
 
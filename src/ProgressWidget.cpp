@@ -1,4 +1,5 @@
 #include "ProgressWidget.h"
+#include "RenderClock.h"
 
 namespace APD
 {
@@ -13,7 +14,15 @@ namespace APD
 
     Progress widgets can be created using ProgressWidgetFactory.
 
-    \sa ProgressBar, ProgressEstimate, ProgressLabel, ProgressOutput, ProgressVelocity, ProgressWidgetContainer
+    Widgets inside AsyncProgressDialog should not update their child widgets directly in the
+    slots, as tasks may report progress much more often than the screen can show it. Instead,
+    the slots store the new state and call requestRender(). The dialog then calls
+    renderPendingState() at most once per frame (see AsyncProgressDialog::setFrameInterval())
+    for all widgets, which requested it. Outside of the dialog, requestRender() calls
+    renderPendingState() right away. The name doesn't hide the QWidget::render() overloads,
+    so a progress widget can still be grabbed into an image.
+
+    \sa ProgressBar, ProgressEstimate, ProgressLabel, ProgressLogView, ProgressOutput, ProgressVelocity, ProgressWidgetContainer
 */
 
 /*!
@@ -23,7 +32,7 @@ namespace APD
 */
 
 /*!
-    \fn void ProgressWidget::setValue(int value, const QVariant& userValue, const TimeStamp& timeStamp)
+    \fn void ProgressWidget::setValue(qint64 value, const QVariant& userValue, const TimeStamp& timeStamp)
 
     A slot called when the progress of associated TaskThread is updated. The \a timeStamp
     value is added by the TaskThread::setValue() method. The time stamp can be used to
@@ -33,7 +42,18 @@ namespace APD
 */
 
 /*!
-    \fn void ProgressWidget::setRange(int minimum, int maximum)
+    \fn void ProgressWidget::setMetrics(qint64 value, const ProgressMetrics& metrics, const TimeStamp& timeStamp)
+
+    A slot called instead of setValue() when the progress of associated TaskThread is updated
+    together with \a metrics. Widgets can bind to fields of the metrics by name. The default
+    implementation calls setValue() with an empty user value, so widgets not interested in
+    metrics show the progress \a value as usual.
+
+    \sa TaskThread::setMetrics(), MetricsLayout
+*/
+
+/*!
+    \fn void ProgressWidget::setRange(qint64 minimum, qint64 maximum)
 
     A slot called when the range of associated TaskThread is updated.
 
@@ -48,4 +68,54 @@ namespace APD
     \sa TaskThread::setText()
 */
 
+/*!
+    \fn void ProgressWidget::setTextBatch(const QStringList& texts)
+
+    A slot called with texts of associated TaskThread, which were buffered in
+    TaskThread::Coalesced mode and delivered at once. The default implementation
+    calls setText() for each text. Widgets can reimplement it to process the whole
+    batch at once.
+
+    \sa TaskThread::textBatchChanged()
+*/
+
+/*!
+    \fn void ProgressWidget::setState(TaskState state)
+
+    A slot called when the execution state of associated TaskThread changes,
+    e.g. when a task waits in TaskPool for a free thread.
+
+    \sa TaskThread::state()
+*/
+
+/*!
+    Requests a call to renderPendingState() in the next frame of the dialog the widget
+    is in. Repeated requests before the frame are merged. If the widget isn't in an
+    AsyncProgressDialog, renderPendingState() is called immediately.
+
+    \sa renderPendingState()
+*/
+void ProgressWidget::requestRender()
+{
+    if (m_renderPending)
+        return;
+
+    if (auto clock = RenderClock::find(this))
+    {
+        m_renderPending = true;
+        clock->schedule(this);
+    }
+    else
+        renderPendingState();
+}
+
+/*!
+    \fn void ProgressWidget::renderPendingState()
+
+    Applies the state stored by the slots to the child widgets. Called in response
+    to requestRender(). The default implementation does nothing.
+
+    \sa requestRender()
+*/
+
 }
@@ -99,16 +99,25 @@ QGridLayout* ProgressWidgetContainer::gridLayout() const
 /*!
   This reimplemented method calls ProgressWidget::setValue() method of all contained progress widgets.
 */
-void ProgressWidgetContainer::setValue(int value, const QVariant& userData, const TimeStamp& timeStamp)
+void ProgressWidgetContainer::setValue(qint64 value, const QVariant& userData, const TimeStamp& timeStamp)
 {
     for (auto& widget : m_impl->m_progressWidgets)
         widget->setValue(value, userData, timeStamp);
 }
 
+/*!
+  This reimplemented method calls ProgressWidget::setMetrics() method of all contained progress widgets.
+*/
+void ProgressWidgetContainer::setMetrics(qint64 value, const ProgressMetrics& metrics, const TimeStamp& timeStamp)
+{
+    for (auto& widget : m_impl->m_progressWidgets)
+        widget->setMetrics(value, metrics, timeStamp);
+}
+
 /*!
   This reimplemented method calls ProgressWidget::setRange() method of all contained progress widgets.
 */
-void ProgressWidgetContainer::setRange(int minimum, int maximum)
+void ProgressWidgetContainer::setRange(qint64 minimum, qint64 maximum)
 {
     for (auto& widget : m_impl->m_progressWidgets)
         widget->setRange(minimum, maximum);
@@ -123,5 +132,23 @@ void ProgressWidgetContainer::setText(const QString& text)
         widget->setText(text);
 }
 
+/*!
+  This reimplemented method calls ProgressWidget::setTextBatch() method of all contained progress widgets.
+*/
+void ProgressWidgetContainer::setTextBatch(const QStringList& texts)
+{
+    for (auto& widget : m_impl->m_progressWidgets)
+        widget->setTextBatch(texts);
+}
+
+/*!
+  This reimplemented method calls ProgressWidget::setState() method of all contained progress widgets.
+*/
+void ProgressWidgetContainer::setState(TaskState state)
+{
+    for (auto& widget : m_impl->m_progressWidgets)
+        widget->setState(state);
+}
+
 
 }
@@ -4,6 +4,7 @@
 #include "ProgressEstimate.h"
 #include "ProgressLabel.h"
 #include "ProgressOutput.h"
+#include "ProgressLogView.h"
 #include "ProgressVelocityPlot.h"
 
 #include <QLabel>
@@ -39,6 +40,9 @@ ProgressWidget* createProgressWidgetImpl(ProgressWidget* bar, const QString& lab
     if (additionalWidgets.testFlag(AdditionalWidget::Output))
         container->addWidget(new ProgressOutput(), row++, 0, 1, colSpan);
 
+    if (additionalWidgets.testFlag(AdditionalWidget::LogView))
+        container->addWidget(new ProgressLogView(), row++, 0, 1, colSpan);
+
     return container;
 }
 
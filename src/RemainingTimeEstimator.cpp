@@ -0,0 +1,364 @@
+#include "RemainingTimeEstimator.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace APD
+{
+
+/*!
+    \class RemainingTimeEstimator
+    \brief Base class of strategies estimating the remaining time of a task.
+
+    The estimator is fed by progress samples using addSample() and extrapolates
+    the remaining time to a given maximum using estimate(). Subclasses estimate
+    the progress rate in updateRate() and rate(). They get the progress relative
+    to the first sample and the time in seconds since the first sample, so they
+    never deal with absolute 64-bit values.
+
+    All built-in strategies update in constant time and use a fixed amount of memory.
+
+    \sa ProgressEstimate::setEstimator()
+*/
+
+/*!
+    \struct RemainingTimeEstimator::Estimate
+    \brief The remaining time returned by RemainingTimeEstimator::estimate().
+
+    The confidence band [m_lower, m_upper] is valid only if m_hasConfidence is set.
+    The band spans two standard deviations of the estimated rate on both sides.
+*/
+
+RemainingTimeEstimator::~RemainingTimeEstimator() = default;
+
+/*!
+    Forgets all samples.
+*/
+void RemainingTimeEstimator::reset()
+{
+    m_started = false;
+    resetRate();
+}
+
+/*!
+    Adds a progress sample with the given \a value reported at \a timeStamp.
+*/
+void RemainingTimeEstimator::addSample(qint64 value, const TimeStamp& timeStamp)
+{
+    using namespace std::chrono;
+
+    if (!m_started)
+    {
+        m_firstTimeStamp = timeStamp;
+        m_firstValue = value;
+        m_started = true;
+    }
+
+    m_lastValue = value;
+    updateRate(static_cast<double>(value - m_firstValue), duration<double>(timeStamp - m_firstTimeStamp).count());
+}
+
+/*!
+    Returns the time needed to get from the last sample to \a maximum,
+    or nothing if the rate isn't known yet.
+*/
+std::optional<RemainingTimeEstimator::Estimate> RemainingTimeEstimator::estimate(qint64 maximum) const
+{
+    using namespace std::chrono;
+
+    double perSecond = 0;
+    double deviation = -1;
+    if (!m_started || !rate(perSecond, deviation) || perSecond <= 0)
+        return std::nullopt;
+
+    auto toMilliseconds = [](double seconds) { return duration_cast<milliseconds>(duration<double>(seconds)); };
+
+    auto remainingSteps = static_cast<double>(maximum - m_lastValue);
+    Estimate result;
+    result.m_remaining = toMilliseconds(remainingSteps / perSecond);
+    if (deviation >= 0 && perSecond - 2 * deviation > 0)
+    {
+        result.m_lower = toMilliseconds(remainingSteps / (perSecond + 2 * deviation));
+        result.m_upper = toMilliseconds(remainingSteps / (perSecond - 2 * deviation));
+        result.m_hasConfidence = true;
+    }
+    return result;
+}
+
+/*!
+    \fn void RemainingTimeEstimator::resetRate()
+    Resets the rate estimate. Called by reset().
+*/
+
+/*!
+    \fn void RemainingTimeEstimator::updateRate(double value, double seconds)
+    Updates the rate estimate by the progress \a value reached \a seconds after the first
+    sample. Both are relative to the first sample, i.e. the first call gets zeros.
+*/
+
+/*!
+    \fn bool RemainingTimeEstimator::rate(double& perSecond, double& deviation) const
+    Sets \a perSecond to the estimated progress per second and \a deviation to its standard
+    deviation, or to a negative value if the strategy can't tell. Returns false if the rate
+    isn't known yet.
+*/
+
+
+/*!
+    \class AverageRateEstimator
+    \brief Estimates the rate as the average since the first sample.
+
+    This is the default strategy of ProgressEstimate. It works well for tasks with
+    a constant throughput, but it reacts slowly to changes and it is biased by a slow
+    start of the task. It doesn't report a confidence band.
+*/
+
+void AverageRateEstimator::resetRate()
+{
+    m_value = 0;
+    m_seconds = 0;
+}
+
+void AverageRateEstimator::updateRate(double value, double seconds)
+{
+    m_value = value;
+    m_seconds = seconds;
+}
+
+bool AverageRateEstimator::rate(double& perSecond, double& deviation) const
+{
+    if (m_seconds <= 0)
+        return false;
+
+    perSecond = m_value / m_seconds;
+    deviation = -1;
+    return true;
+}
+
+
+/*!
+    \class MovingRateEstimator
+    \brief Estimates the rate as an exponentially weighted moving average of the rates
+    between consecutive samples.
+
+    Older rates lose half of their weight every halfLife() seconds, so the estimate follows
+    changes of the throughput regardless of how often the task reports progress. The
+    confidence band is derived from the exponentially weighted variance of the rates.
+*/
+
+/*!
+    Constructs the estimator with the given \a halfLife in seconds.
+*/
+MovingRateEstimator::MovingRateEstimator(double halfLife)
+    : m_halfLife(halfLife)
+{
+    assert(halfLife > 0);
+}
+
+void MovingRateEstimator::resetRate()
+{
+    m_lastValue = 0;
+    m_lastSeconds = 0;
+    m_mean = 0;
+    m_variance = 0;
+    m_initialized = false;
+}
+
+void MovingRateEstimator::updateRate(double value, double seconds)
+{
+    auto dt = seconds - m_lastSeconds;
+    if (dt <= 0)
+        return;
+
+    auto sampleRate = (value - m_lastValue) / dt;
+    m_lastValue = value;
+    m_lastSeconds = seconds;
+
+    if (!m_initialized)
+    {
+        m_mean = sampleRate;
+        m_initialized = true;
+        return;
+    }
+
+    // the weight of a sample grows with the time it covers
+    auto weight = 1 - std::exp2(-dt / m_halfLife);
+    auto diff = sampleRate - m_mean;
+    m_mean += weight * diff;
+    m_variance = (1 - weight) * (m_variance + weight * diff * diff);
+}
+
+bool MovingRateEstimator::rate(double& perSecond, double& deviation) const
+{
+    if (!m_initialized)
+        return false;
+
+    perSecond = m_mean;
+    deviation = std::sqrt(m_variance);
+    return true;
+}
+
+
+/*!
+    \class WindowRegressionEstimator
+    \brief Estimates the rate as the slope of a least-squares line fitted to the last
+    windowSize() samples.
+
+    The samples are kept in a ring buffer and the sums needed by the fit are updated
+    incrementally. The confidence band is derived from the standard error of the slope.
+*/
+
+/*!
+    Constructs the estimator fitting the last \a windowSize samples.
+*/
+WindowRegressionEstimator::WindowRegressionEstimator(int windowSize)
+    : m_window(static_cast<size_t>(windowSize))
+{
+    assert(windowSize >= 2);
+}
+
+void WindowRegressionEstimator::resetRate()
+{
+    m_next = 0;
+    m_count = 0;
+    m_sumT = m_sumV = m_sumTT = m_sumTV = m_sumVV = 0;
+}
+
+void WindowRegressionEstimator::updateRate(double value, double seconds)
+{
+    if (m_count == m_window.size())
+    {
+        auto& old = m_window[m_next];
+        m_sumT -= old.m_seconds;
+        m_sumV -= old.m_value;
+        m_sumTT -= old.m_seconds * old.m_seconds;
+        m_sumTV -= old.m_seconds * old.m_value;
+        m_sumVV -= old.m_value * old.m_value;
+    }
+    else
+        m_count++;
+
+    m_window[m_next] = { seconds, value };
+    m_next = (m_next + 1) % m_window.size();
+
+    m_sumT += seconds;
+    m_sumV += value;
+    m_sumTT += seconds * seconds;
+    m_sumTV += seconds * value;
+    m_sumVV += value * value;
+
+    // recompute the sums once per window to drop the rounding errors of the subtractions,
+    // which keeps the amortized cost constant
+    if (m_next == 0)
+        recomputeSums();
+}
+
+void WindowRegressionEstimator::recomputeSums()
+{
+    m_sumT = m_sumV = m_sumTT = m_sumTV = m_sumVV = 0;
+    for (size_t i = 0; i < m_count; i++)
+    {
+        auto& sample = m_window[i];
+        m_sumT += sample.m_seconds;
+        m_sumV += sample.m_value;
+        m_sumTT += sample.m_seconds * sample.m_seconds;
+        m_sumTV += sample.m_seconds * sample.m_value;
+        m_sumVV += sample.m_value * sample.m_value;
+    }
+}
+
+bool WindowRegressionEstimator::rate(double& perSecond, double& deviation) const
+{
+    if (m_count < 2)
+        return false;
+
+    auto n = static_cast<double>(m_count);
+    auto sxx = m_sumTT - m_sumT * m_sumT / n;
+    auto sxy = m_sumTV - m_sumT * m_sumV / n;
+    auto syy = m_sumVV - m_sumV * m_sumV / n;
+    if (sxx <= 0)
+        return false;
+
+    perSecond = sxy / sxx;
+    deviation = -1;
+    if (m_count > 2)
+    {
+        // the residual sum may get slightly negative due to rounding
+        auto residual = std::max(0.0, syy - perSecond * sxy);
+        deviation = std::sqrt(residual / (n - 2) / sxx);
+    }
+    return true;
+}
+
+
+/*!
+    \class AlphaBetaEstimator
+    \brief Tracks the progress value and the rate by an alpha-beta filter.
+
+    The filter predicts the progress value from the current rate and corrects both
+    by the prediction error weighted by alpha() and beta() respectively. It is a steady
+    state Kalman filter for a constant rate model. Lower weights give smoother but
+    slower estimates. The confidence band is derived from the exponentially weighted
+    variance of the rate errors.
+*/
+
+/*!
+    Constructs the estimator with the given \a alpha and \a beta weights. Both must be
+    in the range (0, 1].
+*/
+AlphaBetaEstimator::AlphaBetaEstimator(double alpha, double beta)
+    : m_alpha(alpha)
+    , m_beta(beta)
+{
+    assert(alpha > 0 && alpha <= 1 && beta > 0 && beta <= 1);
+}
+
+void AlphaBetaEstimator::resetRate()
+{
+    m_value = 0;
+    m_rate = 0;
+    m_variance = 0;
+    m_lastSeconds = 0;
+    m_samples = 0;
+}
+
+void AlphaBetaEstimator::updateRate(double value, double seconds)
+{
+    auto dt = seconds - m_lastSeconds;
+    if (m_samples > 0 && dt <= 0)
+        return;
+
+    if (m_samples == 0)
+        m_value = value;
+    else if (m_samples == 1)
+    {
+        // initialize the rate by the first two samples
+        m_rate = (value - m_value) / dt;
+        m_value = value;
+    }
+    else
+    {
+        auto predicted = m_value + m_rate * dt;
+        auto residual = value - predicted;
+        auto innovation = residual / dt;
+        m_value = predicted + m_alpha * residual;
+        m_rate += m_beta * innovation;
+        m_variance = (1 - m_beta) * (m_variance + m_beta * innovation * innovation);
+    }
+
+    m_lastSeconds = seconds;
+    if (m_samples < 3)
+        m_samples++;
+}
+
+bool AlphaBetaEstimator::rate(double& perSecond, double& deviation) const
+{
+    if (m_samples < 2)
+        return false;
+
+    perSecond = m_rate;
+    deviation = m_samples > 2 ? std::sqrt(m_variance) : -1;
+    return true;
+}
+
+}
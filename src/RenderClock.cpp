@@ -0,0 +1,98 @@
+#include "RenderClock.h"
+#include "ProgressWidget.h"
+#include "AsyncProgressDialog.h"
+#include "TraceRecorder.h"
+
+#include <algorithm>
+
+namespace APD
+{
+
+/*!
+    \class RenderClock
+    \brief Paces rendering of progress widgets in AsyncProgressDialog to frames.
+
+    Progress widgets store new data in their slots and call ProgressWidget::requestRender(),
+    which schedules the widget on the clock of its dialog. The clock then calls
+    ProgressWidget::renderPendingState() for all scheduled widgets in one pass, at most
+    once per interval(). The timer runs only while some widget waits for rendering, an idle
+    dialog gets no timer wakeups.
+*/
+
+/*!
+    Constructs a render clock with the given \a parent.
+*/
+RenderClock::RenderClock(QObject* parent)
+    : QObject(parent)
+{
+    m_timer.setSingleShot(true);
+    connect(&m_timer, &QTimer::timeout, this, &RenderClock::renderFrame);
+}
+
+/*!
+    Returns the minimum interval between two frames in milliseconds.
+*/
+int RenderClock::interval() const
+{
+    return m_interval;
+}
+
+/*!
+    Sets the minimum interval between two frames to \a msec milliseconds.
+*/
+void RenderClock::setInterval(int msec)
+{
+    m_interval = msec;
+}
+
+/*!
+    Schedules \a widget to be rendered in the next frame. If the clock is idle, the frame
+    is rendered as soon as the interval since the previous frame elapses.
+*/
+void RenderClock::schedule(ProgressWidget* widget)
+{
+    m_dirtyWidgets.emplace_back(widget);
+    if (m_timer.isActive())
+        return;
+
+    auto elapsed = m_sinceLastFrame.isValid() ? m_sinceLastFrame.elapsed() : m_interval;
+    m_timer.start(static_cast<int>(std::max<qint64>(0, m_interval - elapsed)));
+}
+
+/*!
+    Sets the \a recorder, which records the time spent rendering each frame,
+    or nullptr to stop recording.
+*/
+void RenderClock::setTraceRecorder(TraceRecorder* recorder)
+{
+    m_traceRecorder = recorder;
+}
+
+/*!
+    Returns the clock of the dialog the \a widget is in, or nullptr if the widget
+    isn't in a dialog.
+*/
+RenderClock* RenderClock::find(const QWidget* widget)
+{
+    auto dialog = qobject_cast<AsyncProgressDialog*>(widget->window());
+    return dialog ? dialog->renderClock() : nullptr;
+}
+
+void RenderClock::renderFrame()
+{
+    TraceScope scope(m_traceRecorder, "render frame");
+    m_sinceLastFrame.start();
+
+    // widgets scheduled while rendering get to the next frame
+    auto widgets = std::move(m_dirtyWidgets);
+    m_dirtyWidgets.clear();
+    for (auto& widget : widgets)
+    {
+        if (!widget)
+            continue;
+        widget->m_renderPending = false;
+        widget->renderPendingState();
+    }
+}
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QElapsedTimer>
+
+#include <vector>
+
+namespace APD
+{
+
+class ProgressWidget;
+class TraceRecorder;
+
+class RenderClock : public QObject
+{
+    Q_OBJECT
+public:
+    explicit RenderClock(QObject* parent = nullptr);
+
+    int interval() const;
+    void setInterval(int msec);
+
+    void schedule(ProgressWidget* widget);
+    void setTraceRecorder(TraceRecorder* recorder);
+
+    static RenderClock* find(const QWidget* widget);
+
+private:
+    Q_DISABLE_COPY(RenderClock)
+
+    void renderFrame();
+
+    QTimer m_timer;
+    QElapsedTimer m_sinceLastFrame;
+    int m_interval = 33;
+    std::vector<QPointer<ProgressWidget>> m_dirtyWidgets;
+    TraceRecorder* m_traceRecorder = nullptr;
+};
+
+}
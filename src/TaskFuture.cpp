@@ -0,0 +1,204 @@
+#include "TaskFuture.h"
+#include "TaskPool.h"
+
+#include <QMetaObject>
+#include <QPointer>
+
+namespace APD
+{
+
+/*!
+    Returns true if the task has finished, i.e. its result is available.
+*/
+bool TaskFutureState::isFinished() const
+{
+    std::lock_guard<std::mutex> lck (m_mutex);
+    return m_finished;
+}
+
+/*!
+    Returns true if the state has been finished by cancel(), i.e. without a result.
+*/
+bool TaskFutureState::isCanceled() const
+{
+    std::lock_guard<std::mutex> lck (m_mutex);
+    return m_canceled;
+}
+
+/*!
+    Finishes the state and calls the continuations added so far.
+*/
+void TaskFutureState::finish()
+{
+    std::vector<std::function<void()>> continuations;
+    {
+        std::lock_guard<std::mutex> lck (m_mutex);
+        m_finished = true;
+        continuations.swap(m_continuations);
+    }
+
+    // called without the lock, a continuation may access the result
+    for (auto& continuation : continuations)
+        continuation();
+}
+
+/*!
+    Finishes the state without a result, e.g. when the task has been canceled before
+    returning it, and calls the continuations added so far.
+*/
+void TaskFutureState::cancel()
+{
+    {
+        std::lock_guard<std::mutex> lck (m_mutex);
+        m_canceled = true;
+    }
+    finish();
+}
+
+/*!
+    Adds \a continuation called when the state finishes, or calls it right away
+    if the state has already finished.
+*/
+void TaskFutureState::onFinished(std::function<void()> continuation)
+{
+    {
+        std::lock_guard<std::mutex> lck (m_mutex);
+        if (!m_finished)
+        {
+            m_continuations.push_back(std::move(continuation));
+            return;
+        }
+    }
+
+    continuation();
+}
+
+/*!
+    Constructs an executor, which calls the work by a queued call in the thread
+    of \a context. The work is dropped if \a context is deleted before.
+*/
+TaskExecutor::TaskExecutor(QObject* context)
+    : TaskExecutor([context = QPointer<QObject>(context)](Work work) {
+          if (context)
+              QMetaObject::invokeMethod(context, std::move(work), Qt::QueuedConnection);
+      })
+{
+}
+
+/*!
+    Constructs an executor, which runs the work by a thread of \a pool.
+*/
+TaskExecutor::TaskExecutor(TaskPool* pool)
+    : TaskExecutor([pool](Work work) { pool->run(std::move(work)); })
+{
+}
+
+TaskExecutor::TaskExecutor(std::function<void(Work)> execute)
+    : m_execute(std::move(execute))
+{
+}
+
+/*!
+    Returns an executor, which calls the work directly in the thread finishing the task.
+    It suits short continuations only, as it delays the following work of the thread.
+*/
+TaskExecutor TaskExecutor::immediate()
+{
+    return TaskExecutor([](Work work) { work(); });
+}
+
+/*!
+    Executes \a work.
+*/
+void TaskExecutor::execute(Work work) const
+{
+    m_execute(std::move(work));
+}
+
+/*!
+    Constructs a future referring to the shared \a state.
+*/
+TaskFutureBase::TaskFutureBase(std::shared_ptr<TaskFutureState> state)
+    : m_state(std::move(state))
+{
+}
+
+/*!
+    Returns true if the future refers to a task. A default constructed future is invalid.
+*/
+bool TaskFutureBase::isValid() const
+{
+    return m_state != nullptr;
+}
+
+/*!
+    Returns true if the task has finished, i.e. its function has returned.
+*/
+bool TaskFutureBase::isFinished() const
+{
+    return m_state && m_state->isFinished();
+}
+
+/*!
+    Returns true if the task has finished without a result, because it has been canceled.
+*/
+bool TaskFutureBase::isCanceled() const
+{
+    return m_state && m_state->isCanceled();
+}
+
+/*!
+    Calls \a continuation by \a executor as soon as the task finishes. Unlike
+    TaskFuture::then(), the result is left in the future.
+*/
+void TaskFutureBase::onFinished(TaskExecutor executor, std::function<void()> continuation) const
+{
+    assert(m_state);
+    m_state->onFinished([executor = std::move(executor), continuation = std::move(continuation)]() {
+        executor.execute(continuation);
+    });
+}
+
+/*!
+    \relates TaskFuture
+
+    Returns a future, which finishes when all the \a futures have finished. The results
+    stay in the futures. The future of an empty list is finished.
+*/
+TaskFuture<void> whenAll(const std::vector<TaskFutureBase>& futures)
+{
+    auto state = std::make_shared<TaskResultState<void>>();
+    auto remaining = std::make_shared<std::atomic<size_t>>(futures.size());
+    if (futures.empty())
+        state->finish();
+
+    for (const auto& future : futures)
+        future.onFinished(TaskExecutor::immediate(), [state, remaining]() {
+            if (remaining->fetch_sub(1, std::memory_order_acq_rel) == 1)
+                state->finish();
+        });
+
+    return TaskFuture<void>(state);
+}
+
+/*!
+    \relates TaskFuture
+
+    Returns a future, whose result is the index of the first of \a futures to finish.
+    The results stay in the futures. The future of an empty list never finishes.
+*/
+TaskFuture<int> whenAny(const std::vector<TaskFutureBase>& futures)
+{
+    auto state = std::make_shared<TaskResultState<int>>();
+    auto done = std::make_shared<std::atomic<bool>>(false);
+
+    for (size_t i = 0; i < futures.size(); ++i)
+        futures[i].onFinished(TaskExecutor::immediate(), [state, done, index = static_cast<int>(i)]() {
+            if (!done->exchange(true, std::memory_order_acq_rel))
+                state->setResult(index);
+        });
+
+    return TaskFuture<int>(state);
+}
+
+}
@@ -0,0 +1,112 @@
+#include "TaskItemDelegate.h"
+#include "TaskListModel.h"
+#include "DurationFormatter.h"
+
+#include <QApplication>
+#include <QPainter>
+#include <QStyle>
+#include <QStyleOptionProgressBar>
+
+#include <limits>
+
+namespace APD
+{
+
+/*!
+    \class TaskItemDelegate
+    \brief An item delegate painting a row of TaskListModel.
+
+    Each row consists of the last text of the task with the remaining time estimate
+    aligned to the right and a progress bar below. Everything is painted by QStyle,
+    so only the visible rows cost any rendering time.
+*/
+
+/*!
+    Constructs a delegate with the given \a parent.
+*/
+TaskItemDelegate::TaskItemDelegate(QObject* parent)
+    : QStyledItemDelegate(parent)
+{
+}
+
+/*!
+    Reimplementation of QStyledItemDelegate::paint()
+*/
+void TaskItemDelegate::paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const
+{
+    auto widget = option.widget;
+    auto style = widget ? widget->style() : QApplication::style();
+
+    // background only, the text is painted below
+    QStyleOptionViewItem itemOption = option;
+    initStyleOption(&itemOption, index);
+    itemOption.text.clear();
+    style->drawControl(QStyle::CE_ItemViewItem, &itemOption, painter, widget);
+
+    auto rect = option.rect.adjusted(s_margin, s_margin, -s_margin, -s_margin);
+    auto lineHeight = option.fontMetrics.height();
+    QRect textRect(rect.left(), rect.top(), rect.width(), lineHeight);
+    QRect barRect(rect.left(), textRect.bottom() + 1 + s_spacing, rect.width(), rect.bottom() - textRect.bottom() - s_spacing);
+
+    auto state = static_cast<TaskState>(index.data(TaskListModel::StateRole).toInt());
+    auto remaining = index.data(TaskListModel::RemainingTimeRole).toLongLong();
+    QString estimate;
+    if (state == TaskState::Running && remaining >= 0)
+        estimate = DurationFormatter(std::chrono::milliseconds(remaining)).approximate();
+
+    bool enabled = option.state & QStyle::State_Enabled;
+    auto estimateWidth = estimate.isEmpty() ? 0 : option.fontMetrics.horizontalAdvance(estimate) + s_margin;
+    auto text = option.fontMetrics.elidedText(index.data(Qt::DisplayRole).toString(), Qt::ElideRight, textRect.width() - estimateWidth);
+    style->drawItemText(painter, textRect, Qt::AlignLeft | Qt::AlignVCenter, option.palette, enabled, text, QPalette::Text);
+    if (!estimate.isEmpty())
+        style->drawItemText(painter, textRect, Qt::AlignRight | Qt::AlignVCenter, option.palette, enabled, estimate, QPalette::Text);
+
+    // QStyleOptionProgressBar is limited to int, larger ranges are painted as per mille
+    auto minimum = index.data(TaskListModel::MinimumRole).toLongLong();
+    auto maximum = index.data(TaskListModel::MaximumRole).toLongLong();
+    auto value = qBound(minimum, index.data(TaskListModel::ValueRole).toLongLong(), maximum);
+
+    QStyleOptionProgressBar bar;
+    bar.direction = option.direction;
+    bar.palette = option.palette;
+    bar.fontMetrics = option.fontMetrics;
+    bar.rect = barRect;
+    bar.state = (option.state & QStyle::State_Enabled) | QStyle::State_Horizontal;
+    bar.textAlignment = Qt::AlignCenter;
+    bar.textVisible = true;
+    if (minimum < std::numeric_limits<int>::min() || maximum > std::numeric_limits<int>::max())
+    {
+        bar.minimum = 0;
+        bar.maximum = 1000;
+        if (maximum > minimum)
+            bar.progress = static_cast<int>(1000 * ((static_cast<double>(value) - minimum) / (static_cast<double>(maximum) - minimum)));
+    }
+    else
+    {
+        bar.minimum = static_cast<int>(minimum);
+        bar.maximum = static_cast<int>(maximum);
+        bar.progress = static_cast<int>(value);
+    }
+
+    if (state == TaskState::Queued || state == TaskState::NotStarted)
+    {
+        bar.progress = bar.minimum;
+        bar.text = tr("Waiting...");
+    }
+    else if (bar.maximum > bar.minimum)
+        bar.text = QString("%1%").arg(static_cast<int>(100 * (static_cast<double>(bar.progress) - bar.minimum) / (static_cast<double>(bar.maximum) - bar.minimum)));
+
+    style->drawControl(QStyle::CE_ProgressBar, &bar, painter, widget);
+}
+
+/*!
+    Reimplementation of QStyledItemDelegate::sizeHint()
+*/
+QSize TaskItemDelegate::sizeHint(const QStyleOptionViewItem& option, const QModelIndex&) const
+{
+    // a text line and a progress bar of about the height of QProgressBar
+    auto lineHeight = option.fontMetrics.height();
+    return QSize(200, 2 * s_margin + lineHeight + s_spacing + lineHeight + 6);
+}
+
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <QStyledItemDelegate>
+
+namespace APD
+{
+
+class TaskItemDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+public:
+    explicit TaskItemDelegate(QObject* parent = nullptr);
+
+    void paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const override;
+    QSize sizeHint(const QStyleOptionViewItem& option, const QModelIndex& index) const override;
+
+private:
+    Q_DISABLE_COPY(TaskItemDelegate)
+
+    static constexpr int s_margin = 4;
+    static constexpr int s_spacing = 2;
+};
+
+}
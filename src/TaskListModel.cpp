@@ -0,0 +1,162 @@
+#include "TaskListModel.h"
+
+#include <algorithm>
+
+namespace APD
+{
+
+/*!
+    \class TaskListModel
+    \brief A list model holding the progress state of tasks shown by AsyncProgressDialog
+    in the AsyncProgressDialog::ListView mode.
+
+    Each row keeps only the values painted by TaskItemDelegate, i.e. the progress value
+    and range, the last text, the task state and the remaining time estimate. No widgets
+    are created per task, so the memory cost per task is constant and small.
+
+    The setters only record changed rows. The view is notified by flushChanges(), which
+    emits a single dataChanged() signal for all rows changed since the previous call.
+    The first change after flushChanges() emits changesPending().
+*/
+
+/*!
+    Constructs an empty model with the given \a parent.
+*/
+TaskListModel::TaskListModel(QObject* parent)
+    : QAbstractListModel(parent)
+{
+}
+
+TaskListModel::~TaskListModel() = default;
+
+/*!
+    Reimplementation of QAbstractItemModel::rowCount()
+*/
+int TaskListModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : static_cast<int>(m_rows.size());
+}
+
+/*!
+    Reimplementation of QAbstractItemModel::data()
+*/
+QVariant TaskListModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= static_cast<int>(m_rows.size()))
+        return QVariant();
+
+    auto& row = m_rows[static_cast<size_t>(index.row())];
+    switch (role)
+    {
+    case Qt::DisplayRole:
+        return row.m_text;
+    case ValueRole:
+        return row.m_value;
+    case MinimumRole:
+        return row.m_minimum;
+    case MaximumRole:
+        return row.m_maximum;
+    case StateRole:
+        return static_cast<int>(row.m_state);
+    case RemainingTimeRole:
+        return row.m_remainingTime;
+    default:
+        return QVariant();
+    }
+}
+
+/*!
+    Appends a row for a new task and returns its index.
+*/
+int TaskListModel::appendTask()
+{
+    auto row = static_cast<int>(m_rows.size());
+    beginInsertRows(QModelIndex(), row, row);
+    m_rows.emplace_back();
+    endInsertRows();
+    return row;
+}
+
+/*!
+    Sets the progress \a value of the task in \a row reported at \a timeStamp
+    and updates the remaining time estimate.
+*/
+void TaskListModel::setValue(int row, qint64 value, const TimeStamp& timeStamp)
+{
+    using namespace std::chrono;
+
+    auto& data = m_rows[static_cast<size_t>(row)];
+    data.m_value = value;
+    if (data.m_firstTimeStamp == TimeStamp())
+    {
+        data.m_firstTimeStamp = timeStamp;
+        data.m_firstValue = value;
+    }
+    else if (data.m_maximum > data.m_minimum && value > data.m_firstValue)
+    {
+        // the same extrapolation as ProgressEstimate, in floating point for large ranges
+        auto elapsed = duration<double, std::milli>(timeStamp - data.m_firstTimeStamp);
+        auto total = elapsed * (static_cast<double>(data.m_maximum - data.m_firstValue) / (value - data.m_firstValue));
+        data.m_remainingTime = std::max<qint64>(0, static_cast<qint64>((total - elapsed).count()));
+    }
+    markChanged(row);
+}
+
+/*!
+    Sets the progress range of the task in \a row to [\a minimum, \a maximum].
+*/
+void TaskListModel::setRange(int row, qint64 minimum, qint64 maximum)
+{
+    auto& data = m_rows[static_cast<size_t>(row)];
+    data.m_minimum = minimum;
+    data.m_maximum = maximum;
+    markChanged(row);
+}
+
+/*!
+    Sets the \a text displayed for the task in \a row.
+*/
+void TaskListModel::setText(int row, const QString& text)
+{
+    m_rows[static_cast<size_t>(row)].m_text = text;
+    markChanged(row);
+}
+
+/*!
+    Sets the \a state of the task in \a row.
+*/
+void TaskListModel::setState(int row, TaskState state)
+{
+    m_rows[static_cast<size_t>(row)].m_state = state;
+    markChanged(row);
+}
+
+/*!
+    Emits dataChanged() for the rows changed since the last call.
+*/
+void TaskListModel::flushChanges()
+{
+    if (m_firstChanged < 0)
+        return;
+
+    emit dataChanged(index(m_firstChanged), index(m_lastChanged));
+    m_firstChanged = -1;
+    m_lastChanged = -1;
+}
+
+void TaskListModel::markChanged(int row)
+{
+    if (m_firstChanged < 0)
+    {
+        m_firstChanged = row;
+        m_lastChanged = row;
+        emit changesPending();
+    }
+    else
+    {
+        m_firstChanged = std::min(m_firstChanged, row);
+        m_lastChanged = std::max(m_lastChanged, row);
+    }
+}
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "TaskState.h"
+#include "TimeStamp.h"
+
+#include <QAbstractListModel>
+
+#include <vector>
+
+namespace APD
+{
+
+class TaskListModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    enum Role
+    {
+        ValueRole = Qt::UserRole,
+        MinimumRole,
+        MaximumRole,
+        StateRole,
+        RemainingTimeRole,
+    };
+
+    explicit TaskListModel(QObject* parent = nullptr);
+    ~TaskListModel() override;
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+    int appendTask();
+
+    void setValue(int row, qint64 value, const TimeStamp& timeStamp);
+    void setRange(int row, qint64 minimum, qint64 maximum);
+    void setText(int row, const QString& text);
+    void setState(int row, TaskState state);
+
+    void flushChanges();
+
+signals:
+    void changesPending();
+
+private:
+    Q_DISABLE_COPY(TaskListModel)
+
+    void markChanged(int row);
+
+    struct Row
+    {
+        qint64 m_value = 0;
+        qint64 m_minimum = 0;
+        qint64 m_maximum = 0;
+        qint64 m_firstValue = 0;
+        TimeStamp m_firstTimeStamp;
+        qint64 m_remainingTime = -1;    // in milliseconds, -1 if unknown
+        QString m_text;
+        TaskState m_state = TaskState::NotStarted;
+    };
+
+    std::vector<Row> m_rows;
+
+    // rows changed since the last flushChanges()
+    int m_firstChanged = -1;
+    int m_lastChanged = -1;
+};
+
+}
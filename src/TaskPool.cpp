@@ -0,0 +1,208 @@
+#include "TaskPool.h"
+#include "TaskThread.h"
+
+#include <QThreadPool>
+#include <QRunnable>
+
+#include <atomic>
+
+namespace APD
+{
+
+class TaskPool::Impl
+{
+    friend class TaskPool;
+
+private:
+    QThreadPool m_threadPool;
+    std::atomic<int> m_queuedTasks = 0;
+};
+
+class TaskPool::Runnable : public QRunnable
+{
+public:
+    Runnable(TaskPool* pool, TaskThread* thread)
+        : m_pool(pool)
+        , m_thread(thread)
+    {}
+
+    void run() override
+    {
+        m_pool->runTask(m_thread);
+    }
+
+private:
+    TaskPool* m_pool;
+    TaskThread* m_thread;
+};
+
+class TaskPool::FunctionRunnable : public QRunnable
+{
+public:
+    FunctionRunnable(std::function<void()> function)
+        : m_function(std::move(function))
+    {}
+
+    void run() override
+    {
+        m_function();
+    }
+
+private:
+    std::function<void()> m_function;
+};
+
+Q_GLOBAL_STATIC(TaskPool, s_globalTaskPool)
+
+
+/*!
+    \class TaskPool
+    \brief A bounded pool of threads, which executes task threads without starting
+    a new OS thread for each of them.
+
+    A task thread started by start() is queued and its TaskThread::run() method is executed
+    by one of the pool threads as soon as a thread becomes available. Tasks are executed in
+    the first-in first-out order. While queued, the task is in the TaskState::Queued state,
+    which progress widgets display as waiting.
+
+    AsyncProgressDialog uses the pool for its tasks if set by AsyncProgressDialog::setTaskPool().
+    All dialogs can share the pool returned by globalInstance(). Its size defaults to
+    QThread::idealThreadCount(), i.e. the number of hardware threads.
+
+    Note that pooled tasks never start their QThread, i.e. QThread::isFinished() and QThread::wait()
+    are not applicable to them. Use TaskThread::state() instead. The TaskThread::run() reimplementation
+    must not rely on the thread's own event loop.
+
+    \sa AsyncProgressDialog::setTaskPool(), TaskThread::state()
+*/
+
+/*!
+    Constructs a task pool with the given \a parent.
+*/
+TaskPool::TaskPool(QObject* parent)
+    : QObject(parent)
+    , m_impl(std::make_unique<Impl>())
+{
+}
+
+/*!
+    Destroys the pool. The destructor waits until all queued tasks finish.
+*/
+TaskPool::~TaskPool()
+{
+    m_impl->m_threadPool.waitForDone();
+}
+
+/*!
+    Returns the pool shared by the whole process.
+*/
+TaskPool* TaskPool::globalInstance()
+{
+    return s_globalTaskPool();
+}
+
+/*!
+    Returns the maximum number of threads used by the pool.
+
+    The default is QThread::idealThreadCount().
+
+    \sa setMaxThreadCount()
+*/
+int TaskPool::maxThreadCount() const
+{
+    return m_impl->m_threadPool.maxThreadCount();
+}
+
+/*!
+    Sets the maximum number of threads used by the pool to \a maxThreadCount.
+
+    \sa maxThreadCount()
+*/
+void TaskPool::setMaxThreadCount(int maxThreadCount)
+{
+    m_impl->m_threadPool.setMaxThreadCount(maxThreadCount);
+}
+
+/*!
+    Returns the stack size of the pool threads in bytes. Zero means the default
+    stack size of the operating system.
+
+    \sa setStackSize()
+*/
+uint TaskPool::stackSize() const
+{
+    return m_impl->m_threadPool.stackSize();
+}
+
+/*!
+    Sets the stack size of newly created pool threads to \a stackSize bytes.
+
+    \sa stackSize()
+*/
+void TaskPool::setStackSize(uint stackSize)
+{
+    m_impl->m_threadPool.setStackSize(stackSize);
+}
+
+/*!
+    Returns the number of threads currently executing a task.
+*/
+int TaskPool::activeThreadCount() const
+{
+    return m_impl->m_threadPool.activeThreadCount();
+}
+
+/*!
+    Returns the number of tasks waiting for a free thread.
+*/
+int TaskPool::queuedTaskCount() const
+{
+    return m_impl->m_queuedTasks.load(std::memory_order_relaxed);
+}
+
+/*!
+    Queues the task \a thread for execution. The task is switched to the TaskState::Queued
+    state immediately and to the TaskState::Running state when a pool thread picks it up.
+
+    The ownership of \a thread is not transferred, the object must be kept alive
+    until the task finishes.
+*/
+void TaskPool::start(TaskThread* thread)
+{
+    assert(thread && thread->state() == TaskState::NotStarted);
+
+    m_impl->m_queuedTasks.fetch_add(1, std::memory_order_relaxed);
+    thread->setState(TaskState::Queued);
+    m_impl->m_threadPool.start(new Runnable(this, thread));
+}
+
+/*!
+    Runs \a function by one of the pool threads, in the same first-in first-out order
+    as the tasks. The function isn't a task, it has no progress and isn't counted by
+    queuedTaskCount(). Used for the continuations of TaskFuture::then().
+*/
+void TaskPool::run(std::function<void()> function)
+{
+    m_impl->m_threadPool.start(new FunctionRunnable(std::move(function)));
+}
+
+/*!
+    Waits up to \a msecs milliseconds for all tasks to finish. Returns true if all
+    tasks have finished. A negative value waits without a timeout.
+*/
+bool TaskPool::waitForDone(int msecs)
+{
+    return m_impl->m_threadPool.waitForDone(msecs);
+}
+
+void TaskPool::runTask(TaskThread* thread)
+{
+    m_impl->m_queuedTasks.fetch_sub(1, std::memory_order_relaxed);
+    thread->applyScheduling(true);
+    thread->setState(TaskState::Running);
+    thread->run();
+    thread->restoreScheduling();
+    thread->setState(TaskState::Finished);
+}
+
+}
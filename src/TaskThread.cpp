@@ -1,15 +1,124 @@
 #include "TaskThread.h"
+#include "LatestValue.h"
+#include "SpscQueue.h"
+#include "TraceRecorder.h"
+#include "ThreadScheduling.h"
+
 #include <QWidget>
 #include <QComboBox>
 
+#include <mutex>
+#include <utility>
+
 namespace APD
 {
 
+namespace
+{
+    // each thread calling TaskThread::advance() gets its own counter shard (modulo the shard count)
+    std::atomic<unsigned> s_nextCounterShard { 0 };
+    thread_local const unsigned s_counterShard = s_nextCounterShard.fetch_add(1, std::memory_order_relaxed);
+}
+
 struct TaskThread::Impl
 {
+    struct ValueUpdate
+    {
+        qint64 m_value = 0;
+        QVariant m_userValue;
+        TimeStamp m_timeStamp;
+        ProgressMetrics m_metrics;
+    };
+
+    struct alignas(64) CounterShard
+    {
+        std::atomic<qint64> m_count { 0 };
+    };
+    static constexpr unsigned s_counterShardCount = 64;
+
+    ~Impl() { delete[] m_counterShards.load(); }
+
+    CounterShard* counterShards();
+    qint64 counterSum() const;
+    void notifyPending(TaskThread* thread);
+
     std::atomic<bool> m_canceled = false;
+    std::atomic<TaskState> m_state = TaskState::NotStarted;
+    std::atomic<UpdateMode> m_updateMode = Immediate;
+    LatestValue<ValueUpdate> m_latestValue;
+
+    // texts set in coalesced mode, created on demand as the capacity may be large
+    std::unique_ptr<SpscQueue<QString>> m_textQueue;
+    int m_textBufferCapacity = 1024;
+    bool m_textOverflow = false;        // set once setText() has waited for the full buffer
+
+    // texts set while the buffer was full, delivered after the buffered ones, see setText()
+    std::mutex m_overflowMutex;
+    QStringList m_overflowTexts;
+    int m_droppedTexts = 0;
+    std::atomic<bool> m_hasOverflowTexts = false;
+
+    // progress counted by advance(), created on the first call
+    std::atomic<CounterShard*> m_counterShards = nullptr;
+    std::atomic<qint64> m_counterBase = 0;
+    qint64 m_flushedCounter = 0;
+
+    // set by the first update stored after flushUpdates(), which emits updatesPending()
+    alignas(64) std::atomic<bool> m_updatesPending = false;
+
+    // set before the thread starts, so the updates read it without synchronization
+    std::shared_ptr<TraceRecorder> m_traceRecorder;
+    int m_traceTrack = 0;
+
+    // set before the thread starts, applied by the thread executing the task
+    Priority m_threadPriority = InheritPriority;
+    SchedulingPolicy m_schedulingPolicy = DefaultScheduling;
+    int m_niceValue = 0;
+    QVector<int> m_cpuAffinity;
+    int m_numaNode = -1;
+    ThreadScheduling m_scheduling;
+
+    // set before the task is added to a dialog
+    QString m_resourceClass;
 };
 
+TaskThread::Impl::CounterShard* TaskThread::Impl::counterShards()
+{
+    auto shards = m_counterShards.load(std::memory_order_acquire);
+    if (shards)
+        return shards;
+
+    auto created = new CounterShard[s_counterShardCount];
+    if (m_counterShards.compare_exchange_strong(shards, created, std::memory_order_acq_rel))
+        return created;
+
+    // another thread has been faster
+    delete[] created;
+    return shards;
+}
+
+qint64 TaskThread::Impl::counterSum() const
+{
+    auto shards = m_counterShards.load(std::memory_order_acquire);
+    if (!shards)
+        return 0;
+
+    qint64 sum = 0;
+    for (unsigned i = 0; i < s_counterShardCount; ++i)
+        sum += shards[i].m_count.load(std::memory_order_relaxed);
+    return sum;
+}
+
+void TaskThread::Impl::notifyPending(TaskThread* thread)
+{
+    // The flag is written once per flush only, so the updating threads mostly just read it.
+    // A thread reading the flag just as flushUpdates() clears it may skip the notification,
+    // the flush then announces one more flush, which takes the update (see flushUpdates()).
+    if (!m_updatesPending.load(std::memory_order_relaxed)
+            && !m_updatesPending.exchange(true, std::memory_order_relaxed))
+        emit thread->updatesPending();
+}
+
 /*!
     \class TaskThread
     \brief Base class for all threads capable of reporting progress and cancelling the progress when requested.
@@ -17,11 +126,59 @@ struct TaskThread::Impl
     Task thread can be added to AsyncProgressDialog and associated with a progress widget,
     which displays its progress. Typically, a thread first sets range using setRange() method,
     and then sets progress values within this range as it runs using setValue() method.
-    Alternatively, the thread may set a progress text using setText() method.
+    Progress values are 64-bit integers, so large quantities (e.g. bytes of huge files) can be
+    reported without rescaling. Alternatively, the thread may set a progress text using setText() method.
+
+    By default, every call to setValue() emits valueChanged() signal, which is delivered to the GUI
+    thread as a queued event. Threads reporting progress very often (e.g. once per processed item) can
+    switch to TaskThread::Coalesced update mode. In this mode, setValue() only stores the latest value
+    into a lock-free slot and the owner of the thread (typically AsyncProgressDialog) periodically calls
+    flushUpdates() to deliver the newest value. Each refresh then delivers at most one update no matter
+    how often the thread reports. The user values of the updates in between are dropped with them, so
+    a per-update quantity, e.g. the one ProgressVelocityPlot computes the velocity from, is lost. Such
+    a quantity should be reported as a cumulative metrics field by setMetrics() instead, see
+    ProgressVelocityPlot::setQuantityField(). Texts set by setText() are not dropped in this mode. They are passed
+    through a bounded lock-free queue and flushUpdates() delivers all pending texts at once by the
+    textBatchChanged() signal.
+
+    Progress of work split among several threads (e.g. a parallel loop inside the task) can be
+    reported by advance() from all of them. Each thread increments its own counter shard and no
+    signal is emitted, the shards are summed up by flushUpdates().
+
+    Updates, which wait for flushUpdates(), are announced by a single updatesPending() signal.
+    The owner therefore needs to flush only when something has changed and it can stay idle
+    otherwise.
+
+    The thread executing the task, either this thread or a TaskPool thread, can be given
+    scheduling attributes: a QThread priority (see setThreadPriority()), a scheduling policy,
+    a nice value, CPU affinity and a NUMA node. They are applied when the task starts
+    and the previous attributes of the thread are restored when it finishes. Without
+    the CAP_SYS_NICE capability, a TaskPool thread can't restore a raised nice value
+    or leave IdleScheduling, so these attributes are then not applied to pooled tasks
+    and a warning is reported.
+
+    \enum TaskThread::UpdateMode
+    Specifies how progress values set by setValue() are delivered.
+
+    \var TaskThread::UpdateMode TaskThread::Immediate
+    Each call to setValue() emits valueChanged() signal.
+    \var TaskThread::UpdateMode TaskThread::Coalesced
+    The latest value is stored and valueChanged() is emitted by flushUpdates(). The user
+    values of the updates in between are dropped, so they mustn't be increments.
+
+    \enum TaskThread::SchedulingPolicy
+    Specifies the Linux scheduling policy of the thread executing the task.
+
+    \var TaskThread::SchedulingPolicy TaskThread::DefaultScheduling
+    The thread keeps its policy, normally SCHED_OTHER.
+    \var TaskThread::SchedulingPolicy TaskThread::BatchScheduling
+    SCHED_BATCH, for CPU-bound tasks, which are preempted less often and yield to interactive threads.
+    \var TaskThread::SchedulingPolicy TaskThread::IdleScheduling
+    SCHED_IDLE, the task only runs on otherwise idle CPUs.
 */
 
 /*!
-    \fn void TaskThread::valueChanged(int value, const QVariant& userValue, const TimeStamp& timeStamp)
+    \fn void TaskThread::valueChanged(qint64 value, const QVariant& userValue, const TimeStamp& timeStamp)
 
     This signal is emitted whenever progress value changes. Current time stamp is added to this signal.
     Time step must be acquired within the asynchronous thread in order to avoid possible lags in
@@ -29,7 +186,18 @@ struct TaskThread::Impl
 */
 
 /*!
-    \fn void TaskThread::rangeChanged(int minimum, int maximum)
+    \fn void TaskThread::metricsChanged(qint64 value, const ProgressMetrics& metrics, const TimeStamp& timeStamp)
+
+    This signal is emitted by flushUpdates() instead of valueChanged(), if the latest value
+    has been set by setMetrics(). As flushUpdates() is called in the thread this object
+    lives in, the signal is delivered to progress widgets by a direct connection and the
+    metrics are passed by reference.
+
+    \sa setMetrics()
+*/
+
+/*!
+    \fn void TaskThread::rangeChanged(qint64 minimum, qint64 maximum)
 
     This signal is emitted when progress range changes.
 */
@@ -40,6 +208,37 @@ struct TaskThread::Impl
     This signal is emitted whenever progress text changes.
 */
 
+/*!
+    \fn void TaskThread::textBatchChanged(const QStringList& texts)
+
+    This signal is emitted by flushUpdates() in TaskThread::Coalesced mode with all texts
+    set by setText() since the previous call, the oldest text first.
+*/
+
+/*!
+    \fn void TaskThread::updatesPending()
+
+    This signal is emitted when an update waiting for flushUpdates() has been stored
+    by setValue() or setText() in TaskThread::Coalesced mode, or by setMetrics() or advance().
+    The signal is emitted once per call to flushUpdates(), i.e. only by the first update stored
+    after the call. It is emitted from within the thread, which stored the update.
+
+    A call to flushUpdates(), which has found updates announced, emits the signal once more
+    from within the flushing thread, so an update stored concurrently with the flush is taken
+    by the next one. The announcing threads therefore need no memory fence.
+
+    \sa flushUpdates()
+*/
+
+/*!
+    \fn void TaskThread::stateChanged(TaskState state)
+
+    This signal is emitted whenever the execution state of the task changes. Except for
+    TaskState::Queued, the signal is emitted from within the task's thread.
+
+    \sa state()
+*/
+
 
 /*!
     Constructs a task thread with the given \a parent.
@@ -49,10 +248,72 @@ TaskThread::TaskThread(QObject* parent)
  , m_impl(std::make_unique<TaskThread::Impl>())
 {
     qRegisterMetaType<TimeStamp>("TimeStamp");
+    qRegisterMetaType<TaskState>("TaskState");
+
+    connect(this, &QThread::started, this, [this](){
+        applyScheduling(false);
+        setState(TaskState::Running);
+    }, Qt::DirectConnection);
+    connect(this, &QThread::finished, this, [this](){
+        restoreScheduling();
+        setState(TaskState::Finished);
+    }, Qt::DirectConnection);
 }
 
 TaskThread::~TaskThread() = default;
 
+/*!
+    Returns the update mode of progress values.
+
+    The default is TaskThread::Immediate.
+
+    \sa setUpdateMode()
+*/
+TaskThread::UpdateMode TaskThread::updateMode() const
+{
+    return m_impl->m_updateMode.load(std::memory_order_relaxed);
+}
+
+/*!
+    Sets the update \a mode of progress values. The mode should be set
+    before the thread is started.
+
+    \sa updateMode(), flushUpdates()
+*/
+void TaskThread::setUpdateMode(UpdateMode mode)
+{
+    m_impl->m_updateMode.store(mode, std::memory_order_relaxed);
+    if (mode == Coalesced && !m_impl->m_textQueue)
+        m_impl->m_textQueue = std::make_unique<SpscQueue<QString>>(m_impl->m_textBufferCapacity);
+}
+
+/*!
+    Returns the maximum number of texts buffered in TaskThread::Coalesced mode.
+
+    The default is 1024.
+
+    \sa setTextBufferCapacity()
+*/
+int TaskThread::textBufferCapacity() const
+{
+    return m_impl->m_textBufferCapacity;
+}
+
+/*!
+    Sets the maximum number of texts buffered in TaskThread::Coalesced mode to \a capacity.
+    If the buffer is full, setText() waits for a while until flushUpdates() drains it. The
+    capacity should be set before the thread is started.
+
+    \sa textBufferCapacity(), setText()
+*/
+void TaskThread::setTextBufferCapacity(int capacity)
+{
+    assert(capacity > 0);
+    m_impl->m_textBufferCapacity = capacity;
+    if (m_impl->m_textQueue)
+        m_impl->m_textQueue = std::make_unique<SpscQueue<QString>>(capacity);
+}
+
 /*!
     Sets minimum and maximum progress values to \a minimum and
     \a maximum respectively. This method can be used from within
@@ -61,8 +322,11 @@ TaskThread::~TaskThread() = default;
 
     The method emits rangeChanged() signal.
 */
-void TaskThread::setRange(int minimum, int maximum)
+void TaskThread::setRange(qint64 minimum, qint64 maximum)
 {
+    if (m_impl->m_traceRecorder)
+        m_impl->m_traceRecorder->counter(m_impl->m_traceTrack, "maximum", maximum);
+
     emit rangeChanged(minimum, maximum);
 }
 
@@ -73,22 +337,121 @@ void TaskThread::setRange(int minimum, int maximum)
     passed to the correpsonding ProgresWidget. This method can
     be used from within asynchronous computation.
 
-    The method emits valueChanged() signal.
+    The method emits valueChanged() signal. In TaskThread::Coalesced mode, the value
+    is only stored and the signal is emitted later by flushUpdates(), with the latest
+    \a userValue only. A quantity added up by the widget, as the velocity quantity of
+    ProgressVelocityPlot, is then undercounted; report it by setMetrics() as a total.
+*/
+void TaskThread::setValue(qint64 value, const QVariant& userValue)
+{
+    if (m_impl->m_traceRecorder)
+        m_impl->m_traceRecorder->counter(m_impl->m_traceTrack, "value", value);
+
+    m_impl->m_counterBase.store(value - m_impl->counterSum(), std::memory_order_relaxed);
+
+    if (m_impl->m_updateMode.load(std::memory_order_relaxed) == Coalesced)
+    {
+        m_impl->m_latestValue.store(Impl::ValueUpdate{ value, userValue, std::chrono::steady_clock::now() });
+        m_impl->notifyPending(this);
+    }
+    else
+        emit valueChanged(value, userValue, std::chrono::steady_clock::now());
+}
+
+void TaskThread::storeMetrics(qint64 value, const ProgressMetrics& metrics)
+{
+    if (m_impl->m_traceRecorder)
+        m_impl->m_traceRecorder->counter(m_impl->m_traceTrack, "value", value);
+
+    m_impl->m_counterBase.store(value - m_impl->counterSum(), std::memory_order_relaxed);
+    m_impl->m_latestValue.store(Impl::ValueUpdate{ value, QVariant(), std::chrono::steady_clock::now(), metrics });
+    m_impl->notifyPending(this);
+}
+
+/*!
+    Advances the progress value by \a steps. Unlike setValue(), this method can be called
+    from any number of threads concurrently, e.g. from workers of a parallel loop running
+    inside the task. The progress value is then the value set by the last call to setValue()
+    (or zero) plus all the steps advanced since.
+
+    The method costs a single relaxed atomic increment of a counter shard owned by the calling
+    thread and a relaxed load of a flag shared by all threads, which is written once per flush
+    only. It emits no signal except for updatesPending() once per flush. The shards are summed
+    up and reported as valueChanged() by flushUpdates(), which AsyncProgressDialog calls
+    periodically in all update modes.
+
+    \note Calls to setValue() must not run concurrently with calls to advance().
+
+    \sa setValue(), flushUpdates()
 */
-void TaskThread::setValue(int value, const QVariant& userValue)
+void TaskThread::advance(qint64 steps)
 {
-    emit valueChanged(value, userValue, std::chrono::steady_clock::now());
+    auto shards = m_impl->counterShards();
+    shards[s_counterShard % Impl::s_counterShardCount].m_count.fetch_add(steps, std::memory_order_relaxed);
+    m_impl->notifyPending(this);
 }
 
 /*!
     Sets current progress text to \a text. This method can
     be used from within asynchronous computation.
 
-    The method emits textChanged() signal.
+    The method emits textChanged() signal. In TaskThread::Coalesced mode, the text
+    is appended to a bounded buffer and flushUpdates() emits all buffered texts
+    at once. If the buffer is full, the method waits until the buffer is drained
+    or the thread is canceled, in which case the text is dropped. The method doesn't
+    wait longer than 100 ms, as the owner may never call flushUpdates(). The text is
+    then appended to an overflow list, and so are the following texts until the next
+    flushUpdates(), which delivers them after the buffered ones, so the order of the
+    texts is kept. The overflow list holds up to textBufferCapacity() texts as well,
+    further texts are dropped and replaced by a single note of their count.
 */
 void TaskThread::setText(const QString& text)
 {
-    emit textChanged(text);
+    if (m_impl->m_traceRecorder)
+        m_impl->m_traceRecorder->instant(m_impl->m_traceTrack, "text", text);
+
+    if (m_impl->m_updateMode.load(std::memory_order_relaxed) != Coalesced)
+    {
+        emit textChanged(text);
+        return;
+    }
+
+    // once a text has overflowed, the following ones go after it until it's delivered
+    bool overflowing = m_impl->m_hasOverflowTexts.load(std::memory_order_acquire);
+    if (!overflowing && m_impl->m_textQueue->tryPush(text))
+    {
+        m_impl->m_textOverflow = false;
+        m_impl->notifyPending(this);
+        return;
+    }
+
+    // a task whose owner has stopped flushing must not block, it waits only once per overflow
+    if (!overflowing && !m_impl->m_textOverflow)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+        while (std::chrono::steady_clock::now() < deadline)
+        {
+            if (isCanceled())
+                return;
+            QThread::msleep(1);
+            if (m_impl->m_textQueue->tryPush(text))
+            {
+                m_impl->notifyPending(this);
+                return;
+            }
+        }
+        m_impl->m_textOverflow = true;
+    }
+
+    {
+        std::lock_guard<std::mutex> lck(m_impl->m_overflowMutex);
+        if (m_impl->m_overflowTexts.size() < m_impl->m_textBufferCapacity)
+            m_impl->m_overflowTexts.push_back(text);
+        else
+            ++m_impl->m_droppedTexts;
+        m_impl->m_hasOverflowTexts.store(true, std::memory_order_release);
+    }
+    m_impl->notifyPending(this);
 }
 
 /*!
@@ -101,6 +464,63 @@ bool TaskThread::isCanceled() const
     return m_impl->m_canceled;
 }
 
+/*!
+    Returns the execution state of the task. Unlike QThread::isRunning() and
+    QThread::isFinished(), the state is valid also for tasks executed by TaskPool.
+
+    This method is thread-safe.
+
+    \sa stateChanged()
+*/
+TaskState TaskThread::state() const
+{
+    return m_impl->m_state.load(std::memory_order_acquire);
+}
+
+void TaskThread::setState(TaskState state)
+{
+    if (auto recorder = m_impl->m_traceRecorder.get())
+    {
+        if (state == TaskState::Queued)
+            recorder->instant(m_impl->m_traceTrack, "queued");
+        else if (state == TaskState::Running)
+            recorder->begin(m_impl->m_traceTrack, "running");
+        else if (state == TaskState::Finished)
+            recorder->end(m_impl->m_traceTrack, "running");
+    }
+
+    m_impl->m_state.store(state, std::memory_order_release);
+    emit stateChanged(state);
+}
+
+// called in the thread executing the task, before it starts running, a reused thread
+// executes other tasks afterwards
+void TaskThread::applyScheduling(bool reusedThread)
+{
+    auto& scheduling = m_impl->m_scheduling;
+    scheduling.setThreadReused(reusedThread);
+    if (m_impl->m_threadPriority != InheritPriority)
+        scheduling.setPriority(m_impl->m_threadPriority);
+    if (m_impl->m_schedulingPolicy != DefaultScheduling)
+        scheduling.setPolicy(m_impl->m_schedulingPolicy);
+    if (m_impl->m_niceValue != 0)
+        scheduling.setNiceValue(m_impl->m_niceValue);
+
+    // a task bound to a NUMA node runs on the CPUs of the node, unless given other ones
+    auto cpus = m_impl->m_cpuAffinity;
+    if (cpus.isEmpty() && m_impl->m_numaNode >= 0)
+        cpus = ThreadScheduling::numaNodeCpus(m_impl->m_numaNode);
+    if (!cpus.isEmpty())
+        scheduling.setCpuAffinity(cpus);
+    if (m_impl->m_numaNode >= 0)
+        scheduling.setPreferredNumaNode(m_impl->m_numaNode);
+}
+
+void TaskThread::restoreScheduling()
+{
+    m_impl->m_scheduling.restore();
+}
+
 /*!
     Registers cancel request. It is up to thread implementer to
     check for cancel request using isCanceled() method in
@@ -111,7 +531,274 @@ bool TaskThread::isCanceled() const
 */
 void TaskThread::cancel()
 {
+    if (m_impl->m_traceRecorder)
+        m_impl->m_traceRecorder->instant(m_impl->m_traceTrack, "cancel requested");
+
     m_impl->m_canceled = true;
 }
 
+/*!
+    Records the timeline of this task on the \a track of \a recorder: the start and finish,
+    range, values, texts and cancel requests. The recorder is shared by the thread, so it's
+    kept alive as long as the thread may record into it. Must be called before the thread
+    is started. A nullptr \a recorder stops the recording.
+
+    While no recorder is set, each update costs a single branch.
+
+    \sa traceRecorder(), AsyncProgressDialog::setTracingEnabled()
+*/
+void TaskThread::setTraceRecorder(std::shared_ptr<TraceRecorder> recorder, int track)
+{
+    m_impl->m_traceRecorder = std::move(recorder);
+    m_impl->m_traceTrack = track;
+}
+
+/*!
+    Returns the recorder the timeline of this task is recorded into, or nullptr.
+
+    \sa setTraceRecorder()
+*/
+TraceRecorder* TaskThread::traceRecorder() const
+{
+    return m_impl->m_traceRecorder.get();
+}
+
+/*!
+    Returns the QThread priority of the thread executing the task.
+
+    The default is QThread::InheritPriority, i.e. the priority is not changed.
+
+    \sa setThreadPriority()
+*/
+QThread::Priority TaskThread::threadPriority() const
+{
+    return m_impl->m_threadPriority;
+}
+
+/*!
+    Sets the QThread \a priority of the thread executing the task. Unlike
+    QThread::setPriority(), the priority is applied when the task starts, so it can
+    be set before the thread is started and it applies to TaskPool threads too.
+    Must be called before the thread is started.
+
+    \sa threadPriority()
+*/
+void TaskThread::setThreadPriority(Priority priority)
+{
+    m_impl->m_threadPriority = priority;
+}
+
+/*!
+    Returns the scheduling policy of the thread executing the task.
+
+    The default is DefaultScheduling.
+
+    \sa setSchedulingPolicy()
+*/
+TaskThread::SchedulingPolicy TaskThread::schedulingPolicy() const
+{
+    return m_impl->m_schedulingPolicy;
+}
+
+/*!
+    Sets the Linux scheduling \a policy of the thread executing the task. Background
+    tasks running with BatchScheduling or IdleScheduling don't compete with the GUI
+    thread for the CPU. The policy is ignored on other platforms. Must be called
+    before the thread is started. A task run by a TaskPool stays in its previous policy
+    when IdleScheduling couldn't be left again without the CAP_SYS_NICE capability.
+
+    \sa schedulingPolicy(), setNiceValue()
+*/
+void TaskThread::setSchedulingPolicy(SchedulingPolicy policy)
+{
+    m_impl->m_schedulingPolicy = policy;
+}
+
+/*!
+    Returns the nice value of the thread executing the task.
+
+    The default is 0, i.e. the thread keeps the nice value of the process.
+
+    \sa setNiceValue()
+*/
+int TaskThread::niceValue() const
+{
+    return m_impl->m_niceValue;
+}
+
+/*!
+    Sets the Linux \a nice value of the thread executing the task, from -20 (the highest
+    priority) to 19 (the lowest priority). Values lower than the nice value of the process
+    require the CAP_SYS_NICE capability. The value is ignored on other platforms. Must be
+    called before the thread is started. A task run by a TaskPool keeps the previous nice
+    value when a higher one couldn't be lowered back, see RLIMIT_NICE.
+
+    \sa niceValue(), setSchedulingPolicy()
+*/
+void TaskThread::setNiceValue(int nice)
+{
+    m_impl->m_niceValue = nice;
+}
+
+/*!
+    Returns the CPUs the thread executing the task is restricted to.
+
+    The default is an empty list, i.e. the thread may run on any CPU available to the process.
+
+    \sa setCpuAffinity()
+*/
+QVector<int> TaskThread::cpuAffinity() const
+{
+    return m_impl->m_cpuAffinity;
+}
+
+/*!
+    Restricts the thread executing the task to run on the \a cpus, numbered from 0.
+    An empty list removes the restriction. The affinity is ignored on other platforms
+    than Linux. Must be called before the thread is started.
+
+    \sa cpuAffinity(), setNumaNode(), AsyncProgressDialog::setGuiCoreReserved()
+*/
+void TaskThread::setCpuAffinity(const QVector<int>& cpus)
+{
+    m_impl->m_cpuAffinity = cpus;
+}
+
+/*!
+    Returns the NUMA node the task is bound to, or -1 if it's not bound to any node.
+
+    The default is -1.
+
+    \sa setNumaNode()
+*/
+int TaskThread::numaNode() const
+{
+    return m_impl->m_numaNode;
+}
+
+/*!
+    Binds the task to the NUMA \a node, or unbinds it if \a node is -1. The thread
+    executing the task then allocates its memory on the node, as long as the node has
+    free memory, and unless cpuAffinity() is set, it runs on the CPUs of the node only,
+    so the task doesn't migrate away from its memory. The binding is ignored on other
+    platforms than Linux. Must be called before the thread is started.
+
+    \sa numaNode(), setCpuAffinity()
+*/
+void TaskThread::setNumaNode(int node)
+{
+    m_impl->m_numaNode = node;
+}
+
+/*!
+    Returns the class of the resource the task mostly uses, e.g. "disk" or "cpu".
+
+    The default is an empty string, which is no class.
+
+    \sa setResourceClass()
+*/
+QString TaskThread::resourceClass() const
+{
+    return m_impl->m_resourceClass;
+}
+
+/*!
+    Sets the class of the \a resource the task mostly uses. AsyncProgressDialog limits
+    the number of running tasks of the class to AsyncProgressDialog::resourceLimit().
+    Must be called before the task is added to the dialog.
+
+    \sa resourceClass(), AsyncProgressDialog::setResourceLimit()
+*/
+void TaskThread::setResourceClass(const QString& resource)
+{
+    m_impl->m_resourceClass = resource;
+}
+
+/*!
+    Emits valueChanged() signal with the latest value stored by setValue() (or metricsChanged()
+    with the latest metrics stored by setMetrics()) and textBatchChanged() signal with texts
+    buffered by setText() in TaskThread::Coalesced mode. In all modes, valueChanged() is also
+    emitted if the progress has been advanced by advance() since the last call. Returns true
+    if any signal has been emitted, or false if nothing has been set since the last call.
+
+    The next stored update emits updatesPending() again. If updates have been announced since
+    the last call, the method emits updatesPending() once more before it returns, as an update
+    stored while the announcement is being cleared may be left unannounced. The owner then
+    flushes once more, which takes such an update.
+
+    This method must be always called from the same thread, typically the thread
+    this object lives in. AsyncProgressDialog calls it automatically.
+
+    \sa setUpdateMode()
+*/
+bool TaskThread::flushUpdates()
+{
+    bool flushed = false;
+
+    // clear the flag before taking the updates, the updating threads see it cleared in time
+    // for the next flush at the latest
+    bool announced = m_impl->m_updatesPending.exchange(false, std::memory_order_acq_rel);
+
+    Impl::ValueUpdate update;
+    bool hasValue = m_impl->m_latestValue.take(update);
+
+    // the counting threads never emit, the progress counted by advance() is reported here
+    auto counter = m_impl->counterSum();
+    if (counter != m_impl->m_flushedCounter)
+    {
+        m_impl->m_flushedCounter = counter;
+        if (!hasValue)
+            update.m_timeStamp = std::chrono::steady_clock::now();
+        update.m_value = m_impl->m_counterBase.load(std::memory_order_relaxed) + counter;
+        hasValue = true;
+
+        if (m_impl->m_traceRecorder)
+            m_impl->m_traceRecorder->counter(m_impl->m_traceTrack, "value", update.m_value);
+    }
+
+    if (hasValue)
+    {
+        if (update.m_metrics.isNull())
+            emit valueChanged(update.m_value, update.m_userValue, update.m_timeStamp);
+        else
+            emit metricsChanged(update.m_value, update.m_metrics, update.m_timeStamp);
+        flushed = true;
+    }
+
+    if (m_impl->m_textQueue)
+    {
+        QStringList texts;
+        QString text;
+        while (m_impl->m_textQueue->tryPop(text))
+            texts.push_back(std::move(text));
+
+        if (m_impl->m_hasOverflowTexts.load(std::memory_order_acquire))
+        {
+            // the producer doesn't push to the buffer meanwhile, what's left in it
+            // precedes the overflow texts
+            std::lock_guard<std::mutex> lck(m_impl->m_overflowMutex);
+            while (m_impl->m_textQueue->tryPop(text))
+                texts.push_back(std::move(text));
+
+            texts += m_impl->m_overflowTexts;
+            m_impl->m_overflowTexts.clear();
+            if (m_impl->m_droppedTexts > 0)
+                texts.push_back(tr("(%n text(s) dropped)", nullptr, std::exchange(m_impl->m_droppedTexts, 0)));
+            m_impl->m_hasOverflowTexts.store(false, std::memory_order_release);
+        }
+
+        if (!texts.isEmpty())
+        {
+            emit textBatchChanged(texts);
+            flushed = true;
+        }
+    }
+
+    // the updating threads don't fence, one more flush takes an update stored just now
+    if (announced)
+        emit updatesPending();
+
+    return flushed;
+}
+
 }
@@ -0,0 +1,339 @@
+#include "ThreadScheduling.h"
+
+#include <QFile>
+#include <QStringList>
+
+#ifdef Q_OS_LINUX
+#include <cerrno>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace APD
+{
+
+#ifdef Q_OS_LINUX
+namespace
+{
+    // the modes of set_mempolicy() from linux/mempolicy.h, called directly so libnuma isn't needed
+    constexpr int s_memoryPolicyDefault = 0;
+    constexpr int s_memoryPolicyPreferred = 1;
+    constexpr int s_maximumNumaNodes = 1024;
+
+    pid_t currentThreadId()
+    {
+        return static_cast<pid_t>(syscall(SYS_gettid));
+    }
+
+    QVector<int> cpusOf(const cpu_set_t& set)
+    {
+        QVector<int> cpus;
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            if (CPU_ISSET(cpu, &set))
+                cpus.append(cpu);
+        return cpus;
+    }
+
+    bool setCurrentAffinity(const QVector<int>& cpus)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (auto cpu : cpus)
+            if (cpu >= 0 && cpu < CPU_SETSIZE)
+                CPU_SET(cpu, &set);
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+    }
+
+    bool setMemoryPolicy(int mode, int node)
+    {
+        unsigned long mask[s_maximumNumaNodes / (8 * sizeof(unsigned long))] = {};
+        unsigned long maxNode = 0;
+        if (node >= 0)
+        {
+            if (node >= s_maximumNumaNodes)
+                return false;
+            mask[node / (8 * sizeof(unsigned long))] = 1UL << (node % (8 * sizeof(unsigned long)));
+            maxNode = s_maximumNumaNodes + 1;
+        }
+        return syscall(SYS_set_mempolicy, mode, node >= 0 ? mask : nullptr, maxNode) == 0;
+    }
+
+    bool hasNiceCapability()
+    {
+        constexpr int capSysNice = 23;
+
+        // the effective capabilities have the form of "CapEff:\t000001ffffffffff"
+        QFile file("/proc/self/status");
+        if (!file.open(QIODevice::ReadOnly))
+            return false;
+        for (const auto& line : QString::fromLatin1(file.readAll()).split('\n'))
+            if (line.startsWith("CapEff:"))
+                return (line.mid(7).trimmed().toULongLong(nullptr, 16) >> capSysNice) & 1;
+        return false;
+    }
+
+    // Without CAP_SYS_NICE, a thread can't lower its nice value below the limit of RLIMIT_NICE,
+    // which is 0 by default, i.e. it can only raise the value. The same limit holds for leaving
+    // SCHED_IDLE, which needs the nice value of the thread to be within the limit.
+    bool canSetNiceValue(int nice)
+    {
+        rlimit limit {};
+        if (getrlimit(RLIMIT_NICE, &limit) == 0
+                && (limit.rlim_cur == RLIM_INFINITY || nice >= 20 - static_cast<int>(limit.rlim_cur)))
+            return true;
+        return hasNiceCapability();
+    }
+
+    int currentNiceValue()
+    {
+        errno = 0;
+        auto nice = getpriority(PRIO_PROCESS, static_cast<id_t>(currentThreadId()));
+        return nice == -1 && errno != 0 ? 0 : nice;
+    }
+}
+#endif
+
+/*!
+    \class ThreadScheduling
+    \brief Changes the scheduling attributes of the calling thread and restores them.
+
+    TaskThread applies its scheduling attributes by this class when the task starts and
+    restores the previous ones when it finishes, so a TaskPool thread, which executes
+    tasks one after another, doesn't keep the attributes of a previous task. Each attribute
+    is saved before its first change only, restore() then sets back all changed attributes.
+
+    Except for the QThread priority, the attributes are implemented on Linux only and
+    ignored elsewhere. Failures, e.g. lowering the nice value without the CAP_SYS_NICE
+    capability, are reported as warnings and the thread keeps running with the attribute
+    unchanged.
+
+    Some changes can't be undone by an unprivileged thread: without CAP_SYS_NICE, a raised
+    nice value can't be lowered back below the limit of RLIMIT_NICE, which is the nice
+    value 0 by default, and SCHED_IDLE can't be left under the same limit. A thread
+    executing more tasks, e.g. a TaskPool thread, is marked by setThreadReused(). Such
+    changes are then refused with a warning, so the following tasks don't inherit them.
+*/
+
+/*!
+    Marks the calling thread as \a reused by other tasks after restore(). The changes, which
+    restore() couldn't undo, are then refused and the failures of restore() are reported.
+    Otherwise the thread is expected to end after restore().
+*/
+void ThreadScheduling::setThreadReused(bool reused)
+{
+    m_threadReused = reused;
+}
+
+/*!
+    Sets the QThread \a priority of the calling thread.
+*/
+void ThreadScheduling::setPriority(QThread::Priority priority)
+{
+    auto thread = QThread::currentThread();
+    if (!m_priorityChanged)
+    {
+        m_priority = thread->priority();
+        m_priorityChanged = true;
+    }
+    thread->setPriority(priority);
+}
+
+/*!
+    Sets the scheduling \a policy of the calling thread.
+*/
+void ThreadScheduling::setPolicy(TaskThread::SchedulingPolicy policy)
+{
+#ifdef Q_OS_LINUX
+    sched_param parameter {};
+    if (!m_policyChanged)
+    {
+        if (pthread_getschedparam(pthread_self(), &m_policy, &parameter) != 0)
+            return;
+        m_policyPriority = parameter.sched_priority;
+        m_policyChanged = true;
+    }
+
+    parameter.sched_priority = 0;
+    auto linuxPolicy = policy == TaskThread::BatchScheduling ? SCHED_BATCH
+                     : policy == TaskThread::IdleScheduling ? SCHED_IDLE : SCHED_OTHER;
+
+    // restore() sets the nice value back before leaving SCHED_IDLE
+    if (m_threadReused && linuxPolicy == SCHED_IDLE && m_policy != SCHED_IDLE
+            && !canSetNiceValue(m_niceValueChanged ? m_niceValue : currentNiceValue()))
+    {
+        qWarning("ThreadScheduling: cannot set SCHED_IDLE on a reused thread, it couldn't be restored");
+        return;
+    }
+    if (pthread_setschedparam(pthread_self(), linuxPolicy, &parameter) != 0)
+        qWarning("ThreadScheduling: cannot set the scheduling policy %d", linuxPolicy);
+#else
+    Q_UNUSED(policy)
+#endif
+}
+
+/*!
+    Sets the \a nice value of the calling thread.
+*/
+void ThreadScheduling::setNiceValue(int nice)
+{
+#ifdef Q_OS_LINUX
+    // Linux keeps the nice value per thread, the process id of setpriority() can be a thread id
+    auto id = static_cast<id_t>(currentThreadId());
+    if (!m_niceValueChanged)
+    {
+        errno = 0;
+        auto previous = getpriority(PRIO_PROCESS, id);
+        if (previous == -1 && errno != 0)
+            return;
+        m_niceValue = previous;
+        m_niceValueChanged = true;
+    }
+
+    if (m_threadReused && nice > m_niceValue && !canSetNiceValue(m_niceValue))
+    {
+        qWarning("ThreadScheduling: cannot set the nice value %d on a reused thread, it couldn't be restored", nice);
+        return;
+    }
+
+    if (setpriority(PRIO_PROCESS, id, nice) != 0)
+        qWarning("ThreadScheduling: cannot set the nice value %d", nice);
+#else
+    Q_UNUSED(nice)
+#endif
+}
+
+/*!
+    Restricts the calling thread to run on the \a cpus.
+*/
+void ThreadScheduling::setCpuAffinity(const QVector<int>& cpus)
+{
+#ifdef Q_OS_LINUX
+    if (!m_cpuAffinityChanged)
+    {
+        cpu_set_t set;
+        if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+            return;
+        m_cpuAffinity = cpusOf(set);
+        m_cpuAffinityChanged = true;
+    }
+
+    if (!setCurrentAffinity(cpus))
+        qWarning("ThreadScheduling: cannot set the CPU affinity");
+#else
+    Q_UNUSED(cpus)
+#endif
+}
+
+/*!
+    Makes the calling thread allocate memory on the NUMA \a node, as long as the node
+    has free memory.
+*/
+void ThreadScheduling::setPreferredNumaNode(int node)
+{
+#ifdef Q_OS_LINUX
+    // threads of a process start with the default policy, which is restored afterwards
+    m_numaNodeChanged = true;
+    if (!setMemoryPolicy(s_memoryPolicyPreferred, node))
+        qWarning("ThreadScheduling: cannot prefer the memory of NUMA node %d", node);
+#else
+    Q_UNUSED(node)
+#endif
+}
+
+/*!
+    Restores the attributes of the calling thread changed since the construction
+    or the previous call. On a reused thread, the attributes, which can't be restored,
+    are reported as warnings.
+
+    \sa setThreadReused()
+*/
+void ThreadScheduling::restore()
+{
+#ifdef Q_OS_LINUX
+    // a thread, which ends after the task, doesn't care about the failures
+    if (m_numaNodeChanged && !setMemoryPolicy(s_memoryPolicyDefault, -1) && m_threadReused)
+        qWarning("ThreadScheduling: cannot restore the memory policy");
+    if (m_cpuAffinityChanged && !setCurrentAffinity(m_cpuAffinity) && m_threadReused)
+        qWarning("ThreadScheduling: cannot restore the CPU affinity");
+    if (m_niceValueChanged && setpriority(PRIO_PROCESS, static_cast<id_t>(currentThreadId()), m_niceValue) != 0
+            && m_threadReused)
+        qWarning("ThreadScheduling: cannot restore the nice value %d", m_niceValue);
+#endif
+
+    // QThread can't set the inherited priority back, a thread started with it runs normally
+    if (m_priorityChanged)
+        QThread::currentThread()->setPriority(m_priority == QThread::InheritPriority ? QThread::NormalPriority : m_priority);
+
+#ifdef Q_OS_LINUX
+    // after the priority, which may change the policy too
+    if (m_policyChanged)
+    {
+        sched_param parameter {};
+        parameter.sched_priority = m_policyPriority;
+        if (pthread_setschedparam(pthread_self(), m_policy, &parameter) != 0 && m_threadReused)
+            qWarning("ThreadScheduling: cannot restore the scheduling policy %d", m_policy);
+    }
+#endif
+
+    m_priorityChanged = false;
+    m_policyChanged = false;
+    m_niceValueChanged = false;
+    m_cpuAffinityChanged = false;
+    m_numaNodeChanged = false;
+}
+
+/*!
+    Returns the CPUs the calling thread may run on, or an empty list if unknown.
+*/
+QVector<int> ThreadScheduling::availableCpus()
+{
+#ifdef Q_OS_LINUX
+    cpu_set_t set;
+    if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0)
+        return cpusOf(set);
+#endif
+    return QVector<int>();
+}
+
+/*!
+    Returns the CPUs of the NUMA \a node, or an empty list if unknown.
+*/
+QVector<int> ThreadScheduling::numaNodeCpus(int node)
+{
+    QVector<int> cpus;
+
+    // the list has the form of "0-7,16-23"
+    QFile file(QString("/sys/devices/system/node/node%1/cpulist").arg(node));
+    if (!file.open(QIODevice::ReadOnly))
+        return cpus;
+
+    for (const auto& range : QString::fromLatin1(file.readAll()).trimmed().split(','))
+    {
+        if (range.isEmpty())
+            continue;
+
+        auto bounds = range.split('-');
+        auto first = bounds.first().toInt();
+        auto last = bounds.last().toInt();
+        for (auto cpu = first; cpu <= last; ++cpu)
+            cpus.append(cpu);
+    }
+    return cpus;
+}
+
+/*!
+    Returns the CPU the calling thread runs on, or -1 if unknown.
+*/
+int ThreadScheduling::currentCpu()
+{
+#ifdef Q_OS_LINUX
+    return sched_getcpu();
+#else
+    return -1;
+#endif
+}
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "TaskThread.h"
+
+#include <QVector>
+
+namespace APD
+{
+
+class ThreadScheduling
+{
+public:
+    ThreadScheduling() = default;
+
+    void setThreadReused(bool reused);
+
+    void setPriority(QThread::Priority priority);
+    void setPolicy(TaskThread::SchedulingPolicy policy);
+    void setNiceValue(int nice);
+    void setCpuAffinity(const QVector<int>& cpus);
+    void setPreferredNumaNode(int node);
+    void restore();
+
+    static QVector<int> availableCpus();
+    static QVector<int> numaNodeCpus(int node);
+    static int currentCpu();
+
+private:
+    Q_DISABLE_COPY(ThreadScheduling)
+
+    // the attributes of the thread before the first change, restored by restore()
+    bool m_priorityChanged = false;
+    QThread::Priority m_priority = QThread::InheritPriority;
+    bool m_policyChanged = false;
+    int m_policy = 0;
+    int m_policyPriority = 0;
+    bool m_niceValueChanged = false;
+    int m_niceValue = 0;
+    bool m_cpuAffinityChanged = false;
+    QVector<int> m_cpuAffinity;
+    bool m_numaNodeChanged = false;
+    bool m_threadReused = false;
+};
+
+}
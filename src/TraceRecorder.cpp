@@ -0,0 +1,324 @@
+#include "TraceRecorder.h"
+
+#include <QFile>
+#include <QIODevice>
+
+#include <algorithm>
+
+namespace APD
+{
+
+namespace
+{
+    std::atomic<quint64> s_nextRecorderId { 1 };
+
+    // the buffer of the last recorder the thread has recorded into
+    struct CachedBuffer
+    {
+        quint64 m_recorderId = 0;
+        void* m_buffer = nullptr;
+    };
+    thread_local CachedBuffer t_cachedBuffer;
+
+    void appendJsonString(QByteArray& json, const char* text, int size = -1)
+    {
+        json.append('"');
+        for (int i = 0; size < 0 ? text[i] != '\0' : i < size; ++i)
+        {
+            auto c = text[i];
+            if (c == '"' || c == '\\')
+                json.append('\\').append(c);
+            else if (static_cast<unsigned char>(c) < 0x20)
+                json.append(QByteArray("\\u00") + QByteArray::number(static_cast<int>(c), 16).rightJustified(2, '0'));
+            else
+                json.append(c);
+        }
+        json.append('"');
+    }
+}
+
+/*!
+    \class TraceRecorder
+    \brief Records a timeline of tasks and exports it in the Chrome Trace Event format.
+
+    AsyncProgressDialog records the start and finish of each task, range, value and text
+    updates, cancel requests and the time spent in its slots in the GUI thread, when tracing
+    is enabled by AsyncProgressDialog::setTracingEnabled(). The trace, which can be opened
+    in Perfetto or chrome://tracing, shows each task on its own track, so it's easy to see
+    which task was the long pole and where the GUI thread stalled.
+
+    Each thread records into its own buffer of eventsPerThread() events, allocated when the
+    thread records its first event. Recording then neither allocates nor locks. When the
+    buffer of a thread is full, further events of the thread are dropped and counted by
+    droppedEventCount(). Texts are truncated to 26 characters.
+
+    Events are recorded to tracks added by addTrack(), typically one per task. Track
+    s_guiTrack is the GUI thread.
+
+    \sa TaskThread::setTraceRecorder(), TraceScope
+*/
+
+/*!
+    Constructs a recorder keeping at most \a eventsPerThread events of each thread.
+*/
+TraceRecorder::TraceRecorder(int eventsPerThread)
+    : m_id(s_nextRecorderId.fetch_add(1, std::memory_order_relaxed))
+    , m_eventsPerThread(eventsPerThread)
+    , m_start(std::chrono::steady_clock::now())
+{
+    assert(eventsPerThread > 0);
+    m_tracks.append(QStringLiteral("GUI thread"));
+}
+
+/*!
+    Destroys the recorder. No thread may record into the recorder anymore.
+*/
+TraceRecorder::~TraceRecorder() = default;
+
+/*!
+    Returns the maximum number of events recorded by each thread.
+*/
+int TraceRecorder::eventsPerThread() const
+{
+    return m_eventsPerThread;
+}
+
+/*!
+    Adds a track called \a name and returns its index. This method is thread-safe.
+*/
+int TraceRecorder::addTrack(const QString& name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tracks.append(name);
+    return m_tracks.size() - 1;
+}
+
+/*!
+    Returns the name of the \a track.
+*/
+QString TraceRecorder::trackName(int track) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_tracks.value(track);
+}
+
+/*!
+    Records the beginning of a slice called \a name on the \a track.
+    The slice is ended by end() with the same name.
+*/
+void TraceRecorder::begin(int track, const char* name)
+{
+    record('B', track, name, sinceStart(std::chrono::steady_clock::now()));
+}
+
+/*!
+    Records the end of a slice called \a name on the \a track.
+*/
+void TraceRecorder::end(int track, const char* name)
+{
+    record('E', track, name, sinceStart(std::chrono::steady_clock::now()));
+}
+
+/*!
+    Records an instant event called \a name with an optional \a text on the \a track.
+*/
+void TraceRecorder::instant(int track, const char* name, const QString& text)
+{
+    record('i', track, name, sinceStart(std::chrono::steady_clock::now()), 0, 0, text);
+}
+
+/*!
+    Records the \a value of a counter called \a name of the \a track.
+*/
+void TraceRecorder::counter(int track, const char* name, qint64 value)
+{
+    record('C', track, name, sinceStart(std::chrono::steady_clock::now()), 0, value);
+}
+
+/*!
+    Records a slice called \a name on the \a track, which lasted from \a start to \a end.
+*/
+void TraceRecorder::complete(int track, const char* name, const TimeStamp& start, const TimeStamp& end)
+{
+    auto time = sinceStart(start);
+    record('X', track, name, time, sinceStart(end) - time);
+}
+
+/*!
+    Returns the number of events recorded so far.
+*/
+qint64 TraceRecorder::eventCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    qint64 count = 0;
+    for (auto& buffer : m_buffers)
+        count += buffer->m_size.load(std::memory_order_acquire);
+    return count;
+}
+
+/*!
+    Returns the number of events dropped, because the buffer of the recording
+    thread was full.
+*/
+qint64 TraceRecorder::droppedEventCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    qint64 count = 0;
+    for (auto& buffer : m_buffers)
+        count += buffer->m_dropped.load(std::memory_order_relaxed);
+    return count;
+}
+
+/*!
+    Writes the events recorded so far to \a device as Chrome Trace Event JSON. The recording
+    may go on while exporting, events recorded meanwhile may be missing. Returns false if
+    writing fails.
+*/
+bool TraceRecorder::exportChromeTrace(QIODevice* device) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    QByteArray json("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+
+    for (int track = 0; track < m_tracks.size(); ++track)
+    {
+        if (!first)
+            json.append(",\n");
+        first = false;
+
+        json.append("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":").append(QByteArray::number(track));
+        json.append(",\"args\":{\"name\":");
+        auto name = m_tracks[track].toUtf8();
+        appendJsonString(json, name.constData(), name.size());
+        json.append("}}");
+    }
+
+    for (auto& buffer : m_buffers)
+    {
+        auto size = buffer->m_size.load(std::memory_order_acquire);
+        for (int i = 0; i < size; ++i)
+        {
+            const auto& event = buffer->m_events[static_cast<size_t>(i)];
+            json.append(",\n{\"name\":");
+            if (event.m_phase == 'C')
+            {
+                // counters are global in the trace format, so they are named after the track
+                auto name = (m_tracks.value(event.m_track) + ' ' + event.m_name).toUtf8();
+                appendJsonString(json, name.constData(), name.size());
+            }
+            else
+                appendJsonString(json, event.m_name);
+
+            json.append(",\"ph\":\"").append(event.m_phase).append("\",\"pid\":1,\"tid\":").append(QByteArray::number(event.m_track));
+            json.append(",\"ts\":").append(QByteArray::number(event.m_time / 1000.0, 'f', 3));
+
+            switch (event.m_phase)
+            {
+            case 'X':
+                json.append(",\"dur\":").append(QByteArray::number(event.m_duration / 1000.0, 'f', 3));
+                break;
+            case 'C':
+                json.append(",\"args\":{\"value\":").append(QByteArray::number(event.m_value)).append('}');
+                break;
+            case 'i':
+                json.append(",\"s\":\"t\"");
+                if (event.m_text[0] != '\0')
+                {
+                    json.append(",\"args\":{\"text\":");
+                    appendJsonString(json, event.m_text);
+                    json.append('}');
+                }
+                break;
+            }
+            json.append('}');
+
+            // keep the memory used by the export bounded
+            if (json.size() > 1024 * 1024)
+            {
+                if (device->write(json) != json.size())
+                    return false;
+                json.clear();
+            }
+        }
+    }
+
+    json.append("\n]}\n");
+    return device->write(json) == json.size();
+}
+
+/*!
+    Writes the events recorded so far to the file \a fileName as Chrome Trace Event JSON.
+    Returns false if the file can't be written.
+*/
+bool TraceRecorder::exportChromeTrace(const QString& fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    return exportChromeTrace(&file);
+}
+
+TraceRecorder::ThreadBuffer* TraceRecorder::threadBuffer()
+{
+    if (t_cachedBuffer.m_recorderId == m_id)
+        return static_cast<ThreadBuffer*>(t_cachedBuffer.m_buffer);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto& buffer = m_threadBuffers[std::this_thread::get_id()];
+    if (!buffer)
+    {
+        m_buffers.push_back(std::make_unique<ThreadBuffer>(m_eventsPerThread));
+        buffer = m_buffers.back().get();
+    }
+
+    t_cachedBuffer = { m_id, buffer };
+    return buffer;
+}
+
+void TraceRecorder::record(char phase, int track, const char* name, qint64 time, qint64 duration, qint64 value, const QString& text)
+{
+    auto buffer = threadBuffer();
+
+    // only this thread appends to the buffer
+    auto size = buffer->m_size.load(std::memory_order_relaxed);
+    if (size == m_eventsPerThread)
+    {
+        buffer->m_dropped.store(buffer->m_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+
+    auto& event = buffer->m_events[static_cast<size_t>(size)];
+    event.m_name = name;
+    event.m_time = time;
+    event.m_duration = duration;
+    event.m_value = value;
+    event.m_track = track;
+    event.m_phase = phase;
+
+    // converted without allocation, characters out of ASCII become '?'
+    auto length = std::min(text.size(), static_cast<int>(sizeof(event.m_text)) - 1);
+    for (int i = 0; i < length; ++i)
+    {
+        auto c = text[i].unicode();
+        event.m_text[i] = c > 0 && c < 0x80 ? static_cast<char>(c) : '?';
+    }
+    event.m_text[length] = '\0';
+
+    buffer->m_size.store(size + 1, std::memory_order_release);
+}
+
+qint64 TraceRecorder::sinceStart(const TimeStamp& timeStamp) const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(timeStamp - m_start).count();
+}
+
+/*!
+    \class TraceScope
+    \brief Records the time spent in a scope of the GUI thread into a TraceRecorder.
+
+    The scope costs a single branch if no recorder is given, so it can stay in the slots
+    of AsyncProgressDialog also when tracing is disabled.
+*/
+
+}